@@ -81,6 +81,28 @@ const entityStates = {
     'switch.wifi_breaker_t_switch_8': 'OFF',
 };
 
+// Numeric attributes, published retained on ha/attr/<entity_id> as
+// "key=value;..." (same format as the bootstrap ATTRIBUTES column). In a
+// real install the HA automation in docs/ha_mqtt_publish.yaml does this.
+const ATTR_DRIFT_MS = Number(getStr('ATTR_DRIFT_MS', '30000'));
+entityStates['climate.spalnia_thermostat'] = 'heat';
+const entityAttributes = {
+    'climate.spalnia_thermostat': { temperature: 22, current_temperature: 21.4 },
+};
+
+function formatAttributes(attrs) {
+    return Object.entries(attrs || {}).map(([k, v]) => `${k}=${v};`).join('');
+}
+
+function publishAttributes(id) {
+    aedes.publish({
+        topic: `ha/attr/${id}`,
+        payload: Buffer.from(formatAttributes(entityAttributes[id]), 'utf8'),
+        qos: 1,
+        retain: true,
+    });
+}
+
 function toggleState(id) {
     const cur = entityStates[id] || 'OFF';
     const next = cur === 'ON' ? 'OFF' : 'ON';
@@ -137,7 +159,7 @@ aedes.on('publish', (packet, client) => {
     // Handle toggle command from device: topic "ha/cmd/toggle", payload = entity_id
     if (client && packet.topic === 'ha/cmd/toggle') {
         const entityId = plBuf.toString('utf8').trim();
-        if (entityStates[entityId] !== undefined) {
+        if (entityStates[entityId] !== undefined && entityAttributes[entityId] === undefined) {
             const prev = entityStates[entityId];
             const next = toggleState(entityId);
             const stateTopic = `ha/state/${entityId}`;
@@ -163,8 +185,22 @@ server.listen(BROKER_PORT, BROKER_HOST, () => {
         port: BROKER_PORT,
         auth: !!(BROKER_USERNAME || BROKER_PASSWORD),
     });
+
+    // Retained, so a panel connecting later still gets them.
+    for (const id of Object.keys(entityAttributes)) publishAttributes(id);
 });
 
+// Room temperature drifts around the setpoint, like a real thermostat.
+const attrDriftTimer = ATTR_DRIFT_MS > 0 ? setInterval(() => {
+    for (const [id, attrs] of Object.entries(entityAttributes)) {
+        if (typeof attrs.current_temperature !== 'number') continue;
+        const step = attrs.current_temperature < attrs.temperature ? 0.1 : -0.1;
+        attrs.current_temperature = Math.round((attrs.current_temperature + step) * 10) / 10;
+        console.log('[logic] attributes', { id, attrs: formatAttributes(attrs) });
+        publishAttributes(id);
+    }
+}, ATTR_DRIFT_MS) : null;
+
 // Simple HTTP endpoint emulating HA /api/template
 const httpServer = http.createServer((req, res) => {
     if (req.method === 'POST' && req.url === '/api/template') {
@@ -199,7 +235,7 @@ const httpServer = http.createServer((req, res) => {
             } else {
                 // Default bootstrap CSV with areas/entities, using current in-memory states
                 res.end(
-                    'AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE\n' +
+                    'AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n' +
                     '\n' +
                     `kukhnia,Кухня,switch.wifi_breaker_t_switch_1,Освещение,${entityStates['switch.wifi_breaker_t_switch_1']}\n` +
                     `kukhnia,Кухня,switch.wifi_breaker_t_switch_2,Розетки_кухня,${entityStates['switch.wifi_breaker_t_switch_2']}\n` +
@@ -208,7 +244,8 @@ const httpServer = http.createServer((req, res) => {
                     `koridor,Коридор,switch.wifi_breaker_t_switch_5,Освещение,${entityStates['switch.wifi_breaker_t_switch_5']}\n` +
                     `spalnia,Спальня,switch.wifi_breaker_t_switch_6,Освещение,${entityStates['switch.wifi_breaker_t_switch_6']}\n` +
                     `spalnia,Спальня,switch.wifi_breaker_t_switch_7,Посудомойка,${entityStates['switch.wifi_breaker_t_switch_7']}\n` +
-                    `spalnia,Спальня,switch.wifi_breaker_t_switch_8,Розетки_спальня,${entityStates['switch.wifi_breaker_t_switch_8']}\n`
+                    `spalnia,Спальня,switch.wifi_breaker_t_switch_8,Розетки_спальня,${entityStates['switch.wifi_breaker_t_switch_8']}\n` +
+                    `spalnia,Спальня,climate.spalnia_thermostat,Термостат,${entityStates['climate.spalnia_thermostat']},${formatAttributes(entityAttributes['climate.spalnia_thermostat'])}\n`
                 );
             }
         });
@@ -226,6 +263,7 @@ httpServer.listen(HTTP_PORT, BROKER_HOST, () => {
 
 function shutdown() {
     console.log('\n[broker] shutting down...');
+    if (attrDriftTimer) clearInterval(attrDriftTimer);
     try { server.close(); } catch (_) { }
     try { httpServer.close(); } catch (_) { }
     try { aedes.close(() => process.exit(0)); } catch (_) { process.exit(0); }
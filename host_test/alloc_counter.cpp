@@ -0,0 +1,80 @@
+#include "alloc_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local int t_depth = 0;
+    thread_local std::size_t t_count = 0;
+    thread_local std::size_t t_bytes = 0;
+
+    void *counted_alloc(std::size_t size)
+    {
+        if (t_depth > 0)
+        {
+            ++t_count;
+            t_bytes += size;
+        }
+        void *p = std::malloc(size ? size : 1);
+        if (!p)
+            std::abort();
+        return p;
+    }
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace host_test
+{
+
+    AllocScope::AllocScope()
+        : start_count_(t_count), start_bytes_(t_bytes)
+    {
+        ++t_depth;
+    }
+
+    AllocScope::~AllocScope()
+    {
+        --t_depth;
+    }
+
+    std::size_t AllocScope::count() const
+    {
+        return t_count - start_count_;
+    }
+
+    std::size_t AllocScope::bytes() const
+    {
+        return t_bytes - start_bytes_;
+    }
+
+} // namespace host_test
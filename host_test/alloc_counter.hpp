@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts global operator new calls (link alloc_counter.cpp into the test).
+// Only the thread that opened a scope is counted.
+namespace host_test
+{
+
+    class AllocScope
+    {
+    public:
+        AllocScope();
+        ~AllocScope();
+
+        AllocScope(const AllocScope &) = delete;
+        AllocScope &operator=(const AllocScope &) = delete;
+
+        std::size_t count() const;
+        std::size_t bytes() const;
+
+    private:
+        std::size_t start_count_;
+        std::size_t start_bytes_;
+    };
+
+} // namespace host_test
@@ -0,0 +1,138 @@
+#include "app_events_host.hpp"
+
+#include <atomic>
+#include <cstring>
+
+ESP_EVENT_DEFINE_BASE(APP_EVENTS);
+
+namespace
+{
+
+    std::size_t s_posted[app_events::kEventCount] = {};
+
+    struct MergeSlot
+    {
+        bool queued = false;
+        alignas(8) unsigned char payload[app_events::kMaxMergedPayloadSize];
+    };
+
+    MergeSlot s_merge[app_events::kEventCount];
+    std::atomic<app_events::PostHookFn> s_post_hook{nullptr};
+
+    void count_post(app_events::Id id, const void *payload, std::size_t size)
+    {
+        const app_events::PostHookFn hook = s_post_hook.load(std::memory_order_acquire);
+        if (hook)
+            hook(id, payload, size);
+        const std::size_t slot = app_events::slot_of(id);
+        if (slot != app_events::kNoSlot)
+            ++s_posted[slot];
+    }
+
+} // namespace
+
+namespace app_events
+{
+
+    namespace detail
+    {
+
+        esp_err_t add_subscriber(std::size_t /*slot*/, ErasedFn /*fn*/, Invoker /*invoker*/)
+        {
+            return ESP_OK;
+        }
+
+        esp_err_t post_raw(Lane /*lane*/, Id id, const void *payload, std::size_t size, bool /*from_isr*/)
+        {
+            count_post(id, payload, size);
+            return ESP_OK;
+        }
+
+        esp_err_t post_merged(Lane /*lane*/, Id id, const void *payload, std::size_t size, Merger merger, bool /*from_isr*/)
+        {
+            const std::size_t slot = slot_of(id);
+            if (slot == kNoSlot || size > kMaxMergedPayloadSize)
+                return ESP_ERR_INVALID_ARG;
+            count_post(id, payload, size);
+
+            MergeSlot &m = s_merge[slot];
+            if (m.queued)
+            {
+                merger(m.payload, payload);
+            }
+            else
+            {
+                std::memcpy(m.payload, payload, size);
+                m.queued = true;
+            }
+            return ESP_OK;
+        }
+
+    } // namespace detail
+
+    esp_err_t add_monitor(MonitorFn /*fn*/)
+    {
+        return ESP_OK;
+    }
+
+    void set_post_hook(PostHookFn fn)
+    {
+        s_post_hook.store(fn, std::memory_order_release);
+    }
+
+    esp_err_t init()
+    {
+        return ESP_OK;
+    }
+
+    const char *id_to_string(int32_t /*id*/)
+    {
+        return "APP_EVENT";
+    }
+
+    // Same as the device version.
+    esp_err_t post_entities_changed(const std::uint16_t *entities, std::size_t count, std::int64_t timestamp_us)
+    {
+        if (!entities || count == 0)
+            return ESP_ERR_INVALID_ARG;
+
+        EntitiesChangedPayload payload{};
+        payload.overflow = count > kMaxEntitiesPerChange;
+        payload.count = static_cast<std::uint16_t>(payload.overflow ? kMaxEntitiesPerChange : count);
+        for (std::size_t i = 0; i < payload.count; ++i)
+            payload.entities[i] = entities[i];
+        payload.timestamp_us = timestamp_us;
+
+        return post<ENTITIES_CHANGED>(payload);
+    }
+
+} // namespace app_events
+
+namespace host_test
+{
+
+    std::size_t posted(app_events::Id id)
+    {
+        const std::size_t slot = app_events::slot_of(id);
+        return slot == app_events::kNoSlot ? 0 : s_posted[slot];
+    }
+
+    bool take_entities_changed(app_events::EntitiesChangedPayload &out)
+    {
+        MergeSlot &m = s_merge[app_events::slot_of(app_events::ENTITIES_CHANGED)];
+        if (!m.queued)
+            return false;
+        std::memcpy(&out, m.payload, sizeof(out));
+        m.queued = false;
+        return true;
+    }
+
+    void reset_events()
+    {
+        for (std::size_t &n : s_posted)
+            n = 0;
+        for (MergeSlot &m : s_merge)
+            m.queued = false;
+    }
+
+} // namespace host_test
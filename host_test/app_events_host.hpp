@@ -0,0 +1,23 @@
+#pragma once
+
+#include "app_events.hpp"
+
+#include <cstddef>
+
+// Host stand-in for the app event lanes (app_events_host.cpp): posts are
+// counted instead of queued, ENTITIES_CHANGED posts merge the way the
+// lane's merge slot does. Nothing is dispatched; tests read what was
+// posted. Does not allocate.
+namespace host_test
+{
+
+    // Posts of `id` since the last reset_events().
+    std::size_t posted(app_events::Id id);
+
+    // The merged ENTITIES_CHANGED payload the lane would dispatch next;
+    // false if none is pending. Clears it.
+    bool take_entities_changed(app_events::EntitiesChangedPayload &out);
+
+    void reset_events();
+
+} // namespace host_test
@@ -0,0 +1,184 @@
+// Bootstrap CSV parser on a generated 5k+ row response: parse time and
+// heap allocations, next to the copying line/field split it replaced.
+// Fails if the streaming parser allocates per row.
+
+#include "bootstrap_csv.hpp"
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr std::size_t kRows = 6000;
+    constexpr int kRuns = 20;
+    // Roughly what esp_http_client hands over per read.
+    constexpr std::size_t kChunk = 1024;
+
+    std::string make_csv(std::size_t rows)
+    {
+        static const char *const kDomains[] = {"switch", "light", "sensor", "climate", "cover", "input_boolean"};
+        static const char *const kStates[] = {"on", "on", "21.5", "heat", "closed", "off"};
+        std::string csv = "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n";
+        char line[256];
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            const std::size_t d = i % 6;
+            const std::size_t area = i / 40;
+            const char *attrs = d == 1 ? "brightness=128;color_temp=370" : (d == 3 ? "temperature=22;current_temperature=21.5" : "");
+            std::snprintf(line, sizeof(line), "area_%zu,Area %zu,%s.device_%zu,Device number %zu,%s,%s\n",
+                          area, area, kDomains[d], i, i, kStates[d], attrs);
+            csv += line;
+        }
+        return csv;
+    }
+
+    struct Sink
+    {
+        std::size_t rows = 0;
+        std::size_t bytes = 0;
+    };
+
+    void on_row(const BootstrapCsvParser::Row &row, void *ctx)
+    {
+        Sink &sink = *static_cast<Sink *>(ctx);
+        ++sink.rows;
+        for (const std::string_view &f : row)
+            sink.bytes += f.size();
+    }
+
+    // The previous init_from_csv() split: one std::string per line, then
+    // one per trimmed field.
+    void trim_copy(std::string &s)
+    {
+        std::size_t start = 0;
+        while (start < s.size() && (s[start] == ' ' || s[start] == '\t' || s[start] == '\r'))
+            ++start;
+        std::size_t end = s.size();
+        while (end > start && (s[end - 1] == ' ' || s[end - 1] == '\t' || s[end - 1] == '\r'))
+            --end;
+        s.assign(s.begin() + static_cast<long>(start), s.begin() + static_cast<long>(end));
+    }
+
+    void copying_parse(const std::string &csv, Sink &sink)
+    {
+        std::vector<std::string> lines;
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < csv.size(); ++i)
+        {
+            if (csv[i] == '\n')
+            {
+                if (i > start)
+                    lines.emplace_back(csv.data() + start, i - start);
+                start = i + 1;
+            }
+        }
+        for (std::size_t l = 1; l < lines.size(); ++l)
+        {
+            std::array<std::string, 6> fields;
+            std::size_t idx = 0;
+            std::size_t begin = 0;
+            const std::string &line = lines[l];
+            for (std::size_t i = 0; i <= line.size() && idx < fields.size(); ++i)
+            {
+                if (i == line.size() || line[i] == ',')
+                {
+                    std::string f = line.substr(begin, i - begin);
+                    trim_copy(f);
+                    fields[idx++] = std::move(f);
+                    begin = i + 1;
+                }
+            }
+            ++sink.rows;
+            for (const std::string &f : fields)
+                sink.bytes += f.size();
+        }
+    }
+
+    struct Result
+    {
+        double best_us = 0.0;
+        std::size_t allocs = 0;
+        std::size_t alloc_bytes = 0;
+        Sink sink;
+    };
+
+    template <typename Fn>
+    Result measure(Fn &&fn)
+    {
+        Result r;
+        r.best_us = 1e12;
+        for (int run = 0; run < kRuns; ++run)
+        {
+            Sink sink;
+            host_test::AllocScope allocs;
+            const auto t0 = std::chrono::steady_clock::now();
+            fn(sink);
+            const auto t1 = std::chrono::steady_clock::now();
+            r.best_us = std::min(r.best_us, std::chrono::duration<double, std::micro>(t1 - t0).count());
+            r.allocs = allocs.count();
+            r.alloc_bytes = allocs.bytes();
+            r.sink = sink;
+        }
+        return r;
+    }
+
+    void report(const char *name, const Result &r)
+    {
+        std::printf("  %-26s %9.1f us  %6.1f ns/row  %7zu allocs (%.2f/row, %zu B)\n",
+                    name,
+                    r.best_us,
+                    r.best_us * 1000.0 / static_cast<double>(kRows),
+                    r.allocs,
+                    static_cast<double>(r.allocs) / static_cast<double>(kRows),
+                    r.alloc_bytes);
+    }
+
+} // namespace
+
+int main()
+{
+    const std::string csv = make_csv(kRows);
+    std::printf("bootstrap CSV: %zu rows, %zu bytes, fed in %zu B chunks, best of %d\n",
+                kRows, csv.size(), kChunk, kRuns);
+
+    const Result streaming = measure([&](Sink &sink)
+                                     {
+                                         BootstrapCsvParser parser(&on_row, &sink);
+                                         for (std::size_t pos = 0; pos < csv.size(); pos += kChunk)
+                                             parser.feed(csv.data() + pos, std::min(kChunk, csv.size() - pos));
+                                         CHECK(parser.finish());
+                                         CHECK(parser.skipped() == 0);
+                                     });
+    const Result whole = measure([&](Sink &sink)
+                                 {
+                                     BootstrapCsvParser parser(&on_row, &sink);
+                                     parser.feed(csv.data(), csv.size());
+                                     CHECK(parser.finish());
+                                 });
+    const Result copying = measure([&](Sink &sink)
+                                   { copying_parse(csv, sink); });
+
+    report("streaming, chunked", streaming);
+    report("streaming, one buffer", whole);
+    report("copying split (previous)", copying);
+
+    CHECK(streaming.sink.rows == kRows);
+    CHECK(whole.sink.rows == kRows);
+    CHECK(streaming.sink.bytes == whole.sink.bytes);
+    CHECK(copying.sink.bytes == whole.sink.bytes);
+    // Only the carry buffer for lines split across chunks may allocate,
+    // and it stops growing at the longest line.
+    CHECK(whole.allocs == 0);
+    CHECK(streaming.allocs <= 4);
+
+    return host_test::finish("bootstrap_csv_bench");
+}
@@ -0,0 +1,173 @@
+// App event dispatch: the slot table with typed invokers (event_table.hpp,
+// what on_app_event runs) against the layout it replaced, one esp_event
+// handler per id registered for any id of the base, each called for every
+// event and filtering on base and id. The handler list is walked the way
+// esp_event walks it (a singly linked list of nodes). Queueing is left
+// out: both layouts post through the same esp_event queue.
+
+#include "event_table.hpp"
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+ESP_EVENT_DEFINE_BASE(APP_EVENTS);
+
+using namespace app_events;
+
+namespace
+{
+
+    constexpr int kRounds = 20;
+    constexpr std::size_t kEventsPerRound = 4096;
+
+    std::size_t g_calls = 0;
+
+    template <Id E>
+    void count_call(const PayloadOf<E> &p)
+    {
+        g_calls += 1 + static_cast<std::size_t>(p.timestamp_us & 0);
+    }
+
+    // ---- slot table ------------------------------------------------------
+
+    template <std::size_t... I>
+    void subscribe_all(detail::SubscriberTable &table, std::index_sequence<I...>)
+    {
+        const bool added[] = {table.add(I, detail::Subscriber{reinterpret_cast<detail::ErasedFn>(&count_call<kEventIds[I]>),
+                                                              &detail::invoke<kEventIds[I]>})...};
+        for (bool ok : added)
+            CHECK(ok);
+    }
+
+    // on_app_event without the metrics.
+    void table_dispatch(const detail::SubscriberTable &table, esp_event_base_t base, int32_t id, const void *data)
+    {
+        if (base != APP_EVENTS || id < 0 || id > detail::kMaxId)
+            return;
+        const std::size_t slot = detail::kSlotById.slot[id];
+        if (slot == kNoSlot || !data)
+            return;
+        table.dispatch_slot(slot, data);
+    }
+
+    // ---- per-id handlers -------------------------------------------------
+
+    using EventHandler = void (*)(void *arg, esp_event_base_t base, int32_t id, void *data);
+
+    template <Id E>
+    void legacy_handler(void * /*arg*/, esp_event_base_t base, int32_t id, void *data)
+    {
+        if (base != APP_EVENTS || id != E || !data)
+            return;
+        count_call<E>(*static_cast<const PayloadOf<E> *>(data));
+    }
+
+    struct HandlerNode
+    {
+        EventHandler fn;
+        void *arg;
+        HandlerNode *next;
+    };
+
+    template <std::size_t... I>
+    std::vector<HandlerNode> make_handlers(std::index_sequence<I...>)
+    {
+        std::vector<HandlerNode> nodes = {HandlerNode{&legacy_handler<kEventIds[I]>, nullptr, nullptr}...};
+        for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+            nodes[i].next = &nodes[i + 1];
+        return nodes;
+    }
+
+    void legacy_dispatch(const HandlerNode *head, esp_event_base_t base, int32_t id, void *data)
+    {
+        for (const HandlerNode *n = head; n; n = n->next)
+            n->fn(n->arg, base, id, data);
+    }
+
+    // ---- driver ----------------------------------------------------------
+
+    // Mostly input and state traffic, every id at least once per cycle.
+    std::vector<Id> make_stream()
+    {
+        const Id hot[] = {KNOB, KNOB, ENTITIES_CHANGED, KNOB, CLOCK_UPDATED, BUTTON, ENTITIES_CHANGED, GESTURE};
+        std::vector<Id> stream;
+        stream.reserve(kEventsPerRound);
+        std::size_t cold = 0;
+        while (stream.size() < kEventsPerRound)
+        {
+            stream.insert(stream.end(), std::begin(hot), std::end(hot));
+            stream.push_back(kEventIds[cold++ % kEventCount]);
+        }
+        stream.resize(kEventsPerRound);
+        return stream;
+    }
+
+    template <typename Fn>
+    double best_ns_per_event(const std::vector<Id> &stream, void *payload, Fn &&dispatch)
+    {
+        double best = 1e12;
+        for (int round = 0; round < kRounds; ++round)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (Id id : stream)
+                dispatch(id, payload);
+            const auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                                      static_cast<double>(stream.size()));
+        }
+        return best;
+    }
+
+} // namespace
+
+int main()
+{
+    static detail::SubscriberTable table;
+    subscribe_all(table, std::make_index_sequence<kEventCount>{});
+    std::vector<HandlerNode> handlers = make_handlers(std::make_index_sequence<kEventCount>{});
+
+    // Large enough for every payload type; all of them are zero-initialised PODs.
+    alignas(8) unsigned char payload[kMaxMergedPayloadSize] = {};
+    const std::vector<Id> stream = make_stream();
+
+    auto run_table = [&](Id id, void *data)
+    { table_dispatch(table, APP_EVENTS, id, data); };
+    auto run_legacy = [&](Id id, void *data)
+    { legacy_dispatch(handlers.data(), APP_EVENTS, id, data); };
+
+    g_calls = 0;
+    const double table_ns = best_ns_per_event(stream, payload, run_table);
+    const std::size_t table_calls = g_calls;
+    g_calls = 0;
+    const double legacy_ns = best_ns_per_event(stream, payload, run_legacy);
+    CHECK(table_calls == g_calls);
+    CHECK(table_calls == kRounds * kEventsPerRound);
+
+    // Events of another base and ids without a slot reach no subscriber.
+    static const char kOtherBase[] = "OTHER";
+    g_calls = 0;
+    table_dispatch(table, kOtherBase, KNOB, payload);
+    legacy_dispatch(handlers.data(), kOtherBase, KNOB, payload);
+    table_dispatch(table, APP_EVENTS, 99, payload);
+    legacy_dispatch(handlers.data(), APP_EVENTS, 99, payload);
+    CHECK(g_calls == 0);
+
+    std::size_t table_allocs = 0;
+    {
+        host_test::AllocScope allocs;
+        for (Id id : stream)
+            run_table(id, payload);
+        table_allocs = allocs.count();
+    }
+    CHECK(table_allocs == 0);
+
+    std::printf("app event dispatch, %zu ids, %zu events, best of %d rounds:\n", kEventCount, kEventsPerRound, kRounds);
+    std::printf("  slot table %6.2f ns/event (%zu allocs)  |  per-id handlers %6.2f ns/event  (%.1fx)\n",
+                table_ns, table_allocs, legacy_ns, legacy_ns / table_ns);
+    return host_test::finish("dispatch_bench");
+}
@@ -0,0 +1,139 @@
+// Entity id lookup: the flat EntityIndex against the
+// std::unordered_map<std::string, size_t> it replaced, at install sizes
+// from a small flat to a large house.
+
+#include "entity_index.hpp"
+#include "string_arena.hpp"
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr int kRounds = 20;
+
+    struct Fixture
+    {
+        StringArena strings;
+        std::vector<Entity> entities;
+        // MQTT topics carry the id; half of the misses share a prefix.
+        std::vector<std::string> hits;
+        std::vector<std::string> misses;
+
+        explicit Fixture(std::size_t count)
+        {
+            static const char *const kDomains[] = {"switch", "light", "sensor", "climate", "cover", "binary_sensor"};
+            char id[64];
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::snprintf(id, sizeof(id), "%s.room_%zu_device_%zu", kDomains[i % 6], i / 12, i);
+                Entity e;
+                e.handle = static_cast<EntityHandle>(i);
+                e.id = strings.intern(id);
+                entities.push_back(e);
+                hits.emplace_back(id);
+                std::snprintf(id, sizeof(id), "%s.room_%zu_device_%zu_x", kDomains[i % 6], i / 12, i);
+                misses.emplace_back(id);
+            }
+        }
+    };
+
+    template <typename Fn>
+    double best_ns_per_lookup(const std::vector<std::string> &keys, Fn &&find, std::size_t &checksum)
+    {
+        double best = 1e12;
+        for (int round = 0; round < kRounds; ++round)
+        {
+            std::size_t sum = 0;
+            const auto t0 = std::chrono::steady_clock::now();
+            for (const std::string &k : keys)
+                sum += find(std::string_view(k));
+            const auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / static_cast<double>(keys.size()));
+            checksum = sum;
+        }
+        return best;
+    }
+
+    void run(std::size_t count)
+    {
+        Fixture f(count);
+
+        EntityIndex index;
+        CHECK(index.build(f.entities.data(), f.entities.size()));
+
+        std::unordered_map<std::string, std::size_t> map;
+        std::size_t map_allocs = 0;
+        {
+            host_test::AllocScope allocs;
+            for (const Entity &e : f.entities)
+                map.emplace(std::string(e.id), e.handle);
+            map_allocs = allocs.count();
+        }
+
+        auto index_find = [&](std::string_view id) -> std::size_t
+        {
+            return index.find(id);
+        };
+        // Old path: the topic's id became a std::string key per lookup.
+        auto map_find = [&](std::string_view id) -> std::size_t
+        {
+            auto it = map.find(std::string(id));
+            return it == map.end() ? kInvalidEntity : it->second;
+        };
+
+        std::size_t sum_index = 0;
+        std::size_t sum_map = 0;
+        const double index_hit = best_ns_per_lookup(f.hits, index_find, sum_index);
+        const double map_hit = best_ns_per_lookup(f.hits, map_find, sum_map);
+        CHECK(sum_index == sum_map);
+        const double index_miss = best_ns_per_lookup(f.misses, index_find, sum_index);
+        const double map_miss = best_ns_per_lookup(f.misses, map_find, sum_map);
+        CHECK(sum_index == count * kInvalidEntity);
+        CHECK(sum_index == sum_map);
+
+        std::size_t index_lookup_allocs = 0;
+        std::size_t map_lookup_allocs = 0;
+        {
+            host_test::AllocScope allocs;
+            for (const Entity &e : f.entities)
+                CHECK(index.find(e.id) == e.handle);
+            index_lookup_allocs = allocs.count();
+        }
+        {
+            host_test::AllocScope allocs;
+            for (const std::string &id : f.hits)
+                (void)map_find(id);
+            map_lookup_allocs = allocs.count();
+        }
+        CHECK(index_lookup_allocs == 0);
+
+        std::printf("  %5zu entities  hit %6.1f / %6.1f ns  miss %6.1f / %6.1f ns  "
+                    "index %6zu B (probe avg %.2f max %zu), map %5zu allocs + %.0f per lookup\n",
+                    count,
+                    index_hit, map_hit,
+                    index_miss, map_miss,
+                    index.bytes(), static_cast<double>(index.avg_probe()), index.max_probe(),
+                    map_allocs,
+                    static_cast<double>(map_lookup_allocs) / static_cast<double>(count));
+    }
+
+} // namespace
+
+int main()
+{
+    std::printf("entity lookup, EntityIndex / unordered_map, best of %d rounds:\n", kRounds);
+    for (std::size_t count : {50, 500, 2000, 8000})
+        run(count);
+    return host_test::finish("entity_index_bench");
+}
@@ -0,0 +1,189 @@
+// Event trace round trip (main/app/event_trace.*): record source events
+// and state batches, download the blob, decode it, load it back and
+// replay it through state::apply_entity_updates, then check the model
+// ends where the recording did. Replay runs inline here (the task stub
+// runs to completion) at speed 0.
+
+#include "event_trace.hpp"
+#include "state_manager.hpp"
+#include "app_events_host.hpp"
+#include "test_util.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr std::size_t kEntities = 80;
+    constexpr std::size_t kTraceBytes = 4096;
+
+    std::string make_csv()
+    {
+        std::string csv = "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n";
+        char line[160];
+        for (std::size_t i = 0; i < kEntities; ++i)
+        {
+            const bool sensor = i % 2 == 0;
+            std::snprintf(line, sizeof(line), "area_%zu,Area %zu,%s.device_%zu,Device %zu,%s,\n",
+                          i / 10, i / 10, sensor ? "sensor" : "switch", i, i, sensor ? "20" : "off");
+            csv += line;
+        }
+        return csv;
+    }
+
+    EntityState numeric(float v)
+    {
+        EntityState st;
+        st.kind = StateKind::Numeric;
+        st.value = v;
+        return st;
+    }
+
+    EntityState on()
+    {
+        EntityState st;
+        st.kind = StateKind::On;
+        return st;
+    }
+
+    std::vector<EntityState> states()
+    {
+        std::vector<EntityState> out;
+        const ModelPtr m = snapshot();
+        for (const Entity &e : m->entities)
+            out.push_back(e.state.load());
+        return out;
+    }
+
+    std::vector<unsigned char> download()
+    {
+        std::vector<unsigned char> blob(event_trace::blob_size());
+        std::size_t offset = 0;
+        unsigned char chunk[100]; // records straddle chunks
+        for (;;)
+        {
+            const std::size_t n = event_trace::read_blob(offset, chunk, sizeof(chunk));
+            if (n == 0)
+                break;
+            std::memcpy(blob.data() + offset, chunk, n);
+            offset += n;
+        }
+        CHECK(offset == blob.size());
+        return blob;
+    }
+
+    struct Decoded
+    {
+        std::size_t records = 0;
+        std::size_t knob = 0;
+        std::size_t state_records = 0;
+        std::size_t updates = 0;
+    };
+
+    Decoded decode(const std::vector<unsigned char> &blob)
+    {
+        Decoded d;
+        event_trace::TraceHeader header;
+        std::memcpy(&header, blob.data(), sizeof(header));
+        CHECK(header.magic == event_trace::kTraceMagic);
+        CHECK(header.version == event_trace::kTraceVersion);
+        CHECK(header.header_size + header.bytes == blob.size());
+
+        std::size_t at = header.header_size;
+        while (at + event_trace::kRecordHeaderSize <= blob.size())
+        {
+            const std::uint8_t id = blob[at + 4];
+            const std::uint8_t size = blob[at + 5];
+            ++d.records;
+            if (id == event_trace::kEntityUpdatesRecord)
+            {
+                ++d.state_records;
+                CHECK(size % event_trace::kEntityUpdateSize == 0);
+                d.updates += size / event_trace::kEntityUpdateSize;
+            }
+            else if (id == app_events::KNOB)
+            {
+                ++d.knob;
+                CHECK(size == sizeof(app_events::KnobPayload));
+            }
+            at += event_trace::kRecordHeaderSize + size;
+        }
+        CHECK(at == blob.size());
+        CHECK(d.records == header.records);
+        return d;
+    }
+
+} // namespace
+
+int main()
+{
+    const std::string csv = make_csv();
+    CHECK(init_from_csv(csv.data(), csv.size()));
+    const std::vector<EntityState> initial = states();
+
+    // Record: a knob turn, a small batch, and one past the ENTITIES_CHANGED
+    // capacity (reported in chunks, split over several records).
+    CHECK(event_trace::start(kTraceBytes) == ESP_OK);
+    app_events::KnobPayload knob;
+    knob.code = 1;
+    CHECK(app_events::post<app_events::KNOB>(knob) == ESP_OK);
+
+    EntityUpdate small[3] = {{0, numeric(21.5f)}, {1, on()}, {2, numeric(19.0f)}};
+    CHECK(apply_entity_updates(small, 3) == 3);
+    std::vector<EntityUpdate> big;
+    for (EntityHandle h = 10; h < 10 + 40; ++h)
+        big.push_back(EntityUpdate{h, h % 2 == 0 ? numeric(30.0f + h) : on()});
+    CHECK(apply_entity_updates(big.data(), big.size()) == big.size());
+    // Unchanged: not recorded.
+    CHECK(apply_entity_updates(small, 3) == 0);
+    event_trace::stop();
+    const std::vector<EntityState> recorded = states();
+
+    const std::vector<unsigned char> blob = download();
+    const Decoded d = decode(blob);
+    CHECK(d.knob == 1);
+    CHECK(d.updates == 3 + 40);
+    CHECK(d.state_records >= 3); // 3, then 40 as 31 + 1 and 8
+
+    // Back to the bootstrap states (same handles), then replay the blob.
+    CHECK(init_from_csv(csv.data(), csv.size()));
+    CHECK(states() == initial);
+    CHECK(event_trace::load_blob(blob.data(), blob.size()) == ESP_OK);
+    CHECK(!event_trace::recording());
+
+    // Recording is on when the replay starts: it pauses, nothing the
+    // replay posts is recorded, and it is back on afterwards.
+    CHECK(event_trace::start(kTraceBytes) == ESP_OK);
+    host_test::reset_events();
+    const std::size_t size_before = event_trace::blob_size();
+    event_trace::ReplayOptions options;
+    options.speed_percent = 0;
+    CHECK(event_trace::replay(options) == ESP_OK);
+    CHECK(!event_trace::replaying());
+    CHECK(event_trace::recording());
+    CHECK(event_trace::blob_size() == size_before);
+
+    CHECK(states() == recorded);
+    CHECK(host_test::posted(app_events::KNOB) == 1);
+    CHECK(host_test::posted(app_events::ENTITIES_CHANGED) == d.state_records);
+    const ModelPtr model = snapshot();
+    CHECK(model->entities[0].state.load().value == 21.5f);
+    CHECK(model->entities[11].state.load().kind == StateKind::On);
+
+    // Malformed blobs are rejected and leave the trace alone.
+    event_trace::stop();
+    std::vector<unsigned char> bad = blob;
+    bad[sizeof(event_trace::TraceHeader) + 5] = 0xF0; // first record's size
+    CHECK(event_trace::load_blob(bad.data(), bad.size()) != ESP_OK);
+    bad = blob;
+    bad[0] ^= 1; // magic
+    CHECK(event_trace::load_blob(bad.data(), bad.size()) != ESP_OK);
+    CHECK(event_trace::blob_size() == size_before);
+
+    return host_test::finish("event_trace_test");
+}
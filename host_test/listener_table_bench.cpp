@@ -0,0 +1,186 @@
+// Entity change notification with hundreds of subscribers: the
+// per-entity ListenerTable against the registry it replaced (one vector
+// of {id, entity id, std::function}, scanned under the lock, matches
+// copied into a fresh vector).
+
+#include "listener_table.hpp"
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr int kRounds = 20;
+    constexpr std::size_t kListenersPerEntity = 2;
+
+    std::size_t g_calls = 0;
+
+    void on_change(const Entity & /*e*/, void *ctx)
+    {
+        g_calls += reinterpret_cast<std::uintptr_t>(ctx) & 1;
+    }
+
+    struct LegacyListener
+    {
+        int id;
+        std::string entity_id;
+        std::function<void(const Entity &)> cb;
+    };
+
+    struct Fixture
+    {
+        std::vector<Entity> entities;
+        std::vector<std::string> ids;
+
+        explicit Fixture(std::size_t count)
+        {
+            ids.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                ids.push_back("light.room_" + std::to_string(i / 8) + "_lamp_" + std::to_string(i));
+                Entity e;
+                e.handle = static_cast<EntityHandle>(i);
+                entities.push_back(e);
+            }
+            for (std::size_t i = 0; i < count; ++i)
+                entities[i].id = ids[i];
+        }
+    };
+
+    template <typename Fn>
+    double best_ns_per_notify(const Fixture &f, Fn &&notify)
+    {
+        double best = 1e12;
+        for (int round = 0; round < kRounds; ++round)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (const Entity &e : f.entities)
+                notify(e);
+            const auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                                      static_cast<double>(f.entities.size()));
+        }
+        return best;
+    }
+
+    void run(std::size_t entity_count)
+    {
+        Fixture f(entity_count);
+        std::mutex mutex;
+
+        ListenerTable table;
+        std::vector<LegacyListener> legacy;
+        int next_id = 1;
+        for (std::size_t i = 0; i < entity_count; ++i)
+        {
+            for (std::size_t k = 0; k < kListenersPerEntity; ++k)
+            {
+                void *ctx = reinterpret_cast<void *>(static_cast<std::uintptr_t>(k + 1));
+                CHECK(table.add(static_cast<EntityHandle>(i), EntityListener{&on_change, ctx}) > 0);
+                legacy.push_back(LegacyListener{next_id++, f.ids[i], [ctx](const Entity &e)
+                                                { on_change(e, ctx); }});
+            }
+        }
+
+        auto notify_table = [&](const Entity &e)
+        {
+            EntityListener to_call[8];
+            std::size_t n = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                n = table.collect(e.handle, to_call, 8);
+            }
+            for (std::size_t i = 0; i < n; ++i)
+                to_call[i].fn(e, to_call[i].ctx);
+        };
+        auto notify_legacy = [&](const Entity &e)
+        {
+            std::vector<std::function<void(const Entity &)>> to_call;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const LegacyListener &l : legacy)
+                {
+                    if (l.entity_id == e.id)
+                        to_call.push_back(l.cb);
+                }
+            }
+            for (auto &cb : to_call)
+                cb(e);
+        };
+
+        g_calls = 0;
+        const double table_ns = best_ns_per_notify(f, notify_table);
+        const std::size_t table_calls = g_calls;
+        g_calls = 0;
+        const double legacy_ns = best_ns_per_notify(f, notify_legacy);
+        CHECK(table_calls == g_calls);
+        CHECK(table_calls == kRounds * entity_count); // one odd ctx per entity
+
+        std::size_t table_allocs = 0;
+        std::size_t legacy_allocs = 0;
+        {
+            host_test::AllocScope allocs;
+            for (const Entity &e : f.entities)
+                notify_table(e);
+            table_allocs = allocs.count();
+        }
+        {
+            host_test::AllocScope allocs;
+            for (const Entity &e : f.entities)
+                notify_legacy(e);
+            legacy_allocs = allocs.count();
+        }
+        CHECK(table_allocs == 0);
+
+        std::printf("  %5zu subscribers  table %7.1f ns, %zu allocs  |  scan %9.1f ns, %.1f allocs  per notification\n",
+                    entity_count * kListenersPerEntity,
+                    table_ns, table_allocs,
+                    legacy_ns, static_cast<double>(legacy_allocs) / static_cast<double>(entity_count));
+    }
+
+    // Removing and re-adding reuses slots; stale ids do nothing.
+    void test_reuse()
+    {
+        ListenerTable table;
+        void *a = reinterpret_cast<void *>(1);
+        void *b = reinterpret_cast<void *>(2);
+        const int id_a = table.add(3, EntityListener{&on_change, a});
+        const int id_b = table.add(3, EntityListener{&on_change, b});
+        CHECK(id_a > 0 && id_b > 0 && id_a != id_b);
+        CHECK(table.count(3) == 2);
+        CHECK(table.count(2) == 0);
+        CHECK(table.count(100) == 0);
+
+        table.remove(id_a);
+        CHECK(table.count(3) == 1);
+        const int id_c = table.add(5, EntityListener{&on_change, a}); // takes id_a's slot
+        CHECK(id_c > 0 && id_c != id_a);
+        table.remove(id_a); // stale
+        CHECK(table.count(5) == 1);
+
+        EntityListener out[4];
+        CHECK(table.collect(3, out, 4) == 1 && out[0].ctx == b);
+        CHECK(table.add(kInvalidEntity, EntityListener{&on_change, a}) == 0);
+        CHECK(table.add(1, EntityListener{}) == 0);
+    }
+
+} // namespace
+
+int main()
+{
+    test_reuse();
+    std::printf("entity notification, %zu listeners per entity, best of %d rounds:\n", kListenersPerEntity, kRounds);
+    for (std::size_t count : {50, 200, 500, 2000})
+        run(count);
+    return host_test::finish("listener_table_bench");
+}
@@ -0,0 +1,234 @@
+// Round trip and corruption checks for the warm-boot model blob
+// (main/app/model_blob.*).
+
+#include "model_blob.hpp"
+#include "state_manager.hpp"
+#include "test_util.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    void add_area(Model &m, const char *id, const char *name)
+    {
+        m.areas.push_back(Area{m.strings.intern(id), m.strings.intern(name)});
+    }
+
+    Entity &add_entity(Model &m, const char *area, const char *id, const char *name, const char *state)
+    {
+        Entity e;
+        e.handle = static_cast<EntityHandle>(m.entities.size());
+        e.id = m.strings.intern(id);
+        e.name = m.strings.intern(name);
+        e.area_id = m.strings.intern(area);
+        e.domain = parse_entity_domain(e.id);
+        e.state.store(parse_entity_state(state, domain_traits(e.domain).shape));
+        m.entities.push_back(std::move(e));
+        return m.entities.back();
+    }
+
+    void build_model(Model &m)
+    {
+        add_area(m, "kitchen", "Кухня");
+        add_area(m, "living", "Living room");
+        add_area(m, "empty", "");
+        add_entity(m, "kitchen", "switch.kitchen_light", "Light", "on");
+        add_entity(m, "kitchen", "sensor.kitchen_temp", "Temperature", "21.5");
+        add_entity(m, "living", "climate.living", "Thermostat", "heat");
+        add_entity(m, "living", "cover.blinds", "Light", "closing"); // name shared with the switch
+        add_entity(m, "living", "light.gone", "Gone", "off").removed = true;
+        add_entity(m, "nowhere", "switch.orphan", "Orphan", "on"); // area not in the model
+    }
+
+    // The blob is read in place and must be 4-byte aligned.
+    struct Image
+    {
+        std::vector<std::uint32_t> words;
+        std::size_t size = 0;
+
+        explicit Image(const std::string &bytes)
+            : words((bytes.size() + 3) / 4), size(bytes.size())
+        {
+            std::memcpy(words.data(), bytes.data(), bytes.size());
+        }
+
+        unsigned char *data() { return reinterpret_cast<unsigned char *>(words.data()); }
+        BlobHeader &header() { return *reinterpret_cast<BlobHeader *>(words.data()); }
+        void reseal() { header().crc = model_blob_crc(header()); }
+    };
+
+    void test_round_trip(const Model &m, const std::string &blob)
+    {
+        Image img(blob);
+        const BlobHeader *hdr = validate_model_blob(img.data(), img.size);
+        CHECK(hdr != nullptr);
+        if (!hdr)
+            return;
+
+        CHECK(hdr->total_size == blob.size());
+        CHECK(hdr->area_count == m.areas.size());
+        CHECK(hdr->entity_count == 4); // removed and orphaned entities are left out
+
+        const char *base = reinterpret_cast<const char *>(hdr);
+        const auto *areas = reinterpret_cast<const BlobArea *>(base + hdr->areas_offset);
+        for (std::size_t i = 0; i < m.areas.size(); ++i)
+        {
+            CHECK(blob_string(*hdr, areas[i].id) == m.areas[i].id);
+            CHECK(blob_string(*hdr, areas[i].name) == m.areas[i].name);
+        }
+
+        const auto *entities = reinterpret_cast<const BlobEntity *>(base + hdr->entities_offset);
+        for (std::uint32_t i = 0; i < hdr->entity_count; ++i)
+        {
+            const BlobEntity &be = entities[i];
+            const Entity &e = m.entities[i];
+            const EntityState st = e.state.load();
+            CHECK(blob_string(*hdr, be.id) == e.id);
+            CHECK(blob_string(*hdr, be.name) == e.name);
+            // Strings are NUL-terminated in place.
+            CHECK(blob_string(*hdr, be.id).data()[be.id.length] == '\0');
+            CHECK(blob_string(*hdr, areas[be.area].id) == e.area_id);
+            CHECK(be.domain == static_cast<std::uint8_t>(e.domain));
+            CHECK(be.kind == static_cast<std::uint8_t>(st.kind));
+            CHECK(be.mode == static_cast<std::uint8_t>(st.mode));
+            CHECK(be.value == st.value);
+        }
+
+        // Shared strings are stored once.
+        CHECK(entities[0].name.offset == entities[3].name.offset);
+    }
+
+    void test_empty_model()
+    {
+        Model m;
+        std::string blob;
+        encode_model_blob(m, blob);
+        Image img(blob);
+        const BlobHeader *hdr = validate_model_blob(img.data(), img.size);
+        CHECK(hdr != nullptr);
+        CHECK(hdr && hdr->area_count == 0 && hdr->entity_count == 0);
+    }
+
+    void test_truncated(const std::string &blob)
+    {
+        for (std::size_t size = 0; size < blob.size(); ++size)
+        {
+            Image img(blob.substr(0, size));
+            if (validate_model_blob(img.data(), size) != nullptr)
+            {
+                std::printf("accepted blob truncated to %zu of %zu bytes\n", size, blob.size());
+                CHECK(false);
+            }
+        }
+        // Trailing bytes past total_size (erased flash) are fine.
+        Image padded(blob + std::string(64, '\xFF'));
+        CHECK(validate_model_blob(padded.data(), padded.size) != nullptr);
+    }
+
+    void test_bit_flips(const std::string &blob)
+    {
+        // The storage layer rewrites the sequence number; it is the only
+        // part of the image a flip may leave acceptable.
+        const std::size_t seq_begin = offsetof(BlobHeader, sequence);
+        const std::size_t seq_end = seq_begin + sizeof(BlobHeader::sequence);
+
+        for (std::size_t i = 0; i < blob.size(); ++i)
+        {
+            if (i >= seq_begin && i < seq_end)
+                continue;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                Image img(blob);
+                img.data()[i] ^= static_cast<unsigned char>(1u << bit);
+                if (validate_model_blob(img.data(), img.size) != nullptr)
+                {
+                    std::printf("accepted blob with bit %d of byte %zu flipped\n", bit, i);
+                    CHECK(false);
+                }
+            }
+        }
+
+        Image img(blob);
+        img.header().sequence = 42;
+        CHECK(validate_model_blob(img.data(), img.size) != nullptr);
+    }
+
+    // Damage that a matching CRC does not excuse: the structure checks
+    // must catch it on their own.
+    void test_structure(const std::string &blob)
+    {
+        {
+            Image img(blob);
+            CHECK(validate_model_blob(img.data() + 4, img.size - 4) == nullptr); // misaligned
+            CHECK(validate_model_blob(nullptr, img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            img.header().version = kBlobVersion + 1;
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            img.header().entity_count = 1000;
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            img.header().areas_offset += 2; // unaligned table
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            auto *entities = reinterpret_cast<BlobEntity *>(img.data() + img.header().entities_offset);
+            entities[0].area = img.header().area_count;
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            auto *entities = reinterpret_cast<BlobEntity *>(img.data() + img.header().entities_offset);
+            entities[1].id.offset = img.header().strings_size;
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            auto *entities = reinterpret_cast<BlobEntity *>(img.data() + img.header().entities_offset);
+            entities[1].id.length -= 1; // no terminator right after the string
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+        {
+            Image img(blob);
+            auto *entities = reinterpret_cast<BlobEntity *>(img.data() + img.header().entities_offset);
+            entities[2].domain = static_cast<std::uint8_t>(EntityDomain::Count);
+            img.reseal();
+            CHECK(validate_model_blob(img.data(), img.size) == nullptr);
+        }
+    }
+
+} // namespace
+
+int main()
+{
+    Model m;
+    build_model(m);
+    std::string blob;
+    encode_model_blob(m, blob);
+
+    test_round_trip(m, blob);
+    test_empty_model();
+    test_truncated(blob);
+    test_bit_flips(blob);
+    test_structure(blob);
+    return host_test::finish("model_blob_test");
+}
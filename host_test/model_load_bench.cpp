@@ -0,0 +1,187 @@
+// Loading the same 6000-row model two ways: the warm-boot path
+// (validate_model_blob() plus state::load_model_blob(), strings left in
+// the image) against a cold bootstrap through state::init_from_csv().
+// Time and heap allocations per load, each starting from an empty model.
+
+#include "model_blob.hpp"
+#include "state_manager.hpp"
+#include "alloc_counter.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr std::size_t kRows = 6000;
+    constexpr int kRuns = 10;
+
+    // Same rows as bootstrap_csv_bench.
+    std::string make_csv(std::size_t rows)
+    {
+        static const char *const kDomains[] = {"switch", "light", "sensor", "climate", "cover", "input_boolean"};
+        static const char *const kStates[] = {"on", "on", "21.5", "heat", "closed", "off"};
+        std::string csv = "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n";
+        char line[256];
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            const std::size_t d = i % 6;
+            const std::size_t area = i / 40;
+            const char *attrs = d == 1 ? "brightness=128;color_temp=370" : (d == 3 ? "temperature=22;current_temperature=21.5" : "");
+            std::snprintf(line, sizeof(line), "area_%zu,Area %zu,%s.device_%zu,Device number %zu,%s,%s\n",
+                          area, area, kDomains[d], i, i, kStates[d], attrs);
+            csv += line;
+        }
+        return csv;
+    }
+
+    // Drop the published model, so every load is a first load (no
+    // reconcile). Logs a warning about the empty input.
+    void reset_model()
+    {
+        (void)init_from_csv(nullptr, 0);
+    }
+
+    struct Result
+    {
+        double best_us = 0.0;
+        std::size_t allocs = 0;
+        std::size_t alloc_bytes = 0;
+    };
+
+    template <typename Fn>
+    Result measure(Fn &&load)
+    {
+        Result r;
+        r.best_us = 1e12;
+        for (int run = 0; run < kRuns; ++run)
+        {
+            reset_model();
+            host_test::AllocScope allocs;
+            const auto t0 = std::chrono::steady_clock::now();
+            CHECK(load());
+            const auto t1 = std::chrono::steady_clock::now();
+            r.best_us = std::min(r.best_us, std::chrono::duration<double, std::micro>(t1 - t0).count());
+            r.allocs = allocs.count();
+            r.alloc_bytes = allocs.bytes();
+        }
+        return r;
+    }
+
+    void report(const char *name, const Result &r)
+    {
+        std::printf("  %-28s %9.1f us  %6.1f ns/row  %7zu allocs (%zu B)\n",
+                    name,
+                    r.best_us,
+                    r.best_us * 1000.0 / static_cast<double>(kRows),
+                    r.allocs,
+                    r.alloc_bytes);
+    }
+
+    // Ids, names, areas and states of two models match entity by entity.
+    bool same_entities(const Model &a, const Model &b)
+    {
+        if (a.entities.size() != b.entities.size() || a.areas.size() != b.areas.size())
+            return false;
+        for (std::size_t i = 0; i < a.entities.size(); ++i)
+        {
+            const Entity &x = a.entities[i];
+            const Entity &y = b.entities[i];
+            if (x.id != y.id || x.name != y.name || x.area_id != y.area_id || x.state.load() != y.state.load())
+                return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+int main()
+{
+    const std::string csv = make_csv(kRows);
+
+    // The image the warm boot reads, 4-byte aligned like the mapped
+    // partition.
+    CHECK(init_from_csv(csv.data(), csv.size()));
+    const ModelPtr from_csv = snapshot();
+    std::string bytes;
+    encode_model_blob(*from_csv, bytes);
+    auto words = std::make_shared<std::vector<std::uint32_t>>((bytes.size() + 3) / 4);
+    std::memcpy(words->data(), bytes.data(), bytes.size());
+    const std::shared_ptr<const void> backing(words, words->data());
+
+    std::printf("model load: %zu rows, CSV %zu B, blob %zu B, best of %d\n", kRows, csv.size(), bytes.size(), kRuns);
+
+    Result validate;
+    validate.best_us = 1e12;
+    for (int run = 0; run < kRuns; ++run)
+    {
+        host_test::AllocScope allocs;
+        const auto t0 = std::chrono::steady_clock::now();
+        CHECK(validate_model_blob(backing.get(), bytes.size()) != nullptr);
+        const auto t1 = std::chrono::steady_clock::now();
+        validate.best_us = std::min(validate.best_us, std::chrono::duration<double, std::micro>(t1 - t0).count());
+        validate.allocs = allocs.count();
+    }
+
+    const Result blob = measure([&]
+                                { return load_model_blob(backing.get(), bytes.size(), backing); });
+    const ModelPtr from_blob = snapshot();
+    const Result text = measure([&]
+                                { return init_from_csv(csv.data(), csv.size()); });
+
+    report("validate_model_blob", validate);
+    report("blob: validate + load", blob);
+    report("init_from_csv", text);
+    std::printf("  blob load is %.1fx faster with %.1fx fewer allocations\n",
+                text.best_us / blob.best_us,
+                static_cast<double>(text.allocs) / static_cast<double>(std::max<std::size_t>(blob.allocs, 1)));
+
+    CHECK(from_blob->entities.size() == kRows);
+    CHECK(same_entities(*from_blob, *snapshot()));
+    CHECK(from_blob->backing == backing);
+    // Checking the image does not allocate; loading it allocates the
+    // model and its vectors, a fixed handful, never per entity or string.
+    CHECK(validate.allocs == 0);
+    CHECK(blob.allocs <= 32);
+    CHECK(blob.allocs < text.allocs);
+
+    // Warm boot: the live bootstrap reconciles into the blob's model and
+    // every entity keeps its handle.
+    reset_model();
+    CHECK(load_model_blob(backing.get(), bytes.size(), backing));
+    const std::uint32_t blob_version = snapshot()->version;
+    CHECK(init_from_csv(csv.data(), csv.size()));
+    CHECK(snapshot()->version == blob_version + 1);
+    CHECK(same_entities(*from_blob, *snapshot()));
+    CHECK(snapshot()->index.find("sensor.device_2") == 2);
+
+    // An image that repeats an id is rejected; the model stays.
+    Model dup;
+    dup.areas.push_back(Area{dup.strings.intern("a"), dup.strings.intern("A")});
+    for (const char *id : {"switch.x", "switch.y", "switch.x"})
+    {
+        Entity e;
+        e.handle = static_cast<EntityHandle>(dup.entities.size());
+        e.id = dup.strings.intern(id);
+        e.name = e.id;
+        e.area_id = dup.areas[0].id;
+        e.domain = parse_entity_domain(e.id);
+        dup.entities.push_back(std::move(e));
+    }
+    std::string dup_bytes;
+    encode_model_blob(dup, dup_bytes);
+    std::vector<std::uint32_t> dup_words((dup_bytes.size() + 3) / 4);
+    std::memcpy(dup_words.data(), dup_bytes.data(), dup_bytes.size());
+    CHECK(!load_model_blob(dup_words.data(), dup_bytes.size(), nullptr));
+    CHECK(snapshot()->entities.size() == kRows);
+
+    return host_test::finish("model_load_bench");
+}
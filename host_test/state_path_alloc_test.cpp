@@ -0,0 +1,206 @@
+// The MQTT state path after the model is loaded: topic and payload as
+// views into one receive buffer, entity lookup through the index, state
+// parsing, batching and apply_entity_updates() (history, dirty set,
+// ENTITIES_CHANGED, listeners), plus ha/attr updates. Mirrors
+// router.cpp's handle_message() and batch flush; fails if any of it
+// calls operator new once warmed up.
+
+#include "state_manager.hpp"
+#include "alloc_counter.hpp"
+#include "app_events_host.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr std::size_t kEntities = 600;
+    constexpr int kRounds = 20;
+    constexpr std::size_t kBatch = app_events::kMaxEntitiesPerChange;
+
+    std::string make_csv()
+    {
+        static const char *const kDomains[] = {"switch", "light", "sensor", "climate", "cover", "input_boolean"};
+        static const char *const kStates[] = {"on", "on", "21.5", "heat", "closed", "off"};
+        std::string csv = "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n";
+        char line[256];
+        for (std::size_t i = 0; i < kEntities; ++i)
+        {
+            const std::size_t d = i % 6;
+            const char *attrs = d == 1 ? "brightness=128;color_temp=370" : "";
+            std::snprintf(line, sizeof(line), "area_%zu,Area %zu,%s.device_%zu,Device %zu,%s,%s\n",
+                          i / 40, i / 40, kDomains[d], i, i, kStates[d], attrs);
+            csv += line;
+        }
+        return csv;
+    }
+
+    // Messages of one round, laid out back to back like the MQTT client's
+    // buffer. Odd rounds send the other state, so every message changes
+    // something.
+    struct Message
+    {
+        std::size_t topic_at, topic_len, data_at, data_len;
+    };
+
+    struct Traffic
+    {
+        std::string buffer;
+        std::vector<Message> messages[2];
+
+        void add(int parity, const std::string &topic, const std::string &data)
+        {
+            messages[parity].push_back(Message{buffer.size(), topic.size(), buffer.size() + topic.size(), data.size()});
+            buffer += topic;
+            buffer += data;
+        }
+    };
+
+    Traffic make_traffic()
+    {
+        static const char *const kDomains[] = {"switch", "light", "sensor", "climate", "cover", "input_boolean"};
+        static const char *const kStates[2][6] = {
+            {"off", "off", "22.5", "cool", "open", "on"},
+            {"on", "on", "21.5", "heat", "closed", "off"},
+        };
+        Traffic t;
+        for (int parity = 0; parity < 2; ++parity)
+        {
+            for (std::size_t i = 0; i < kEntities; ++i)
+            {
+                const std::size_t d = i % 6;
+                const std::string id = std::string(kDomains[d]) + ".device_" + std::to_string(i);
+                t.add(parity, "ha/state/" + id, kStates[parity][d]);
+                if (d == 1 && i % 12 == 1)
+                    t.add(parity, "ha/attr/" + id, parity ? "brightness=128" : "brightness=64");
+            }
+            t.add(parity, "ha/state/sensor.not_in_model", "1");
+        }
+        return t;
+    }
+
+    // router.cpp: pending batch, later message for the same entity wins.
+    EntityUpdate g_pending[kBatch];
+    std::size_t g_pending_count = 0;
+
+    void flush()
+    {
+        if (g_pending_count > 0)
+            (void)apply_entity_updates(g_pending, g_pending_count);
+        g_pending_count = 0;
+    }
+
+    void queue_update(EntityHandle entity, const EntityState &value)
+    {
+        std::size_t i = 0;
+        while (i < g_pending_count && g_pending[i].entity != entity)
+            ++i;
+        if (i == g_pending_count)
+            ++g_pending_count;
+        g_pending[i].entity = entity;
+        g_pending[i].state = value;
+        if (g_pending_count == kBatch)
+            flush();
+    }
+
+    void handle_message(std::string_view topic, std::string_view data)
+    {
+        constexpr std::string_view kAttrPrefix = "ha/attr/";
+        if (topic.substr(0, kAttrPrefix.size()) == kAttrPrefix)
+        {
+            const EntityHandle entity = find_handle(topic.substr(kAttrPrefix.size()));
+            if (entity != kInvalidEntity)
+                (void)set_entity_attributes(entity, data);
+            return;
+        }
+
+        constexpr std::string_view kStatePrefix = "ha/state/";
+        if (topic.substr(0, kStatePrefix.size()) != kStatePrefix)
+            return;
+        const ModelPtr model = snapshot();
+        const Entity *e = model->find(model->index.find(topic.substr(kStatePrefix.size())));
+        if (!e)
+            return;
+        queue_update(e->handle, parse_entity_state(data, domain_traits(e->domain).shape));
+    }
+
+    void run_round(const Traffic &t, int round)
+    {
+        for (const Message &m : t.messages[round & 1])
+        {
+            handle_message(std::string_view(t.buffer.data() + m.topic_at, m.topic_len),
+                           std::string_view(t.buffer.data() + m.data_at, m.data_len));
+        }
+        flush();
+        // The lane would dispatch the merged notification here.
+        app_events::EntitiesChangedPayload changed;
+        (void)host_test::take_entities_changed(changed);
+    }
+
+    std::size_t g_notified = 0;
+
+    void on_entity(const Entity & /*e*/, void * /*ctx*/)
+    {
+        ++g_notified;
+    }
+
+} // namespace
+
+int main()
+{
+    const std::string csv = make_csv();
+    CHECK(init_history());
+    CHECK(init_from_csv(csv.data(), csv.size()));
+    const ModelPtr model = snapshot();
+    CHECK(model->entities.size() == kEntities);
+    for (EntityHandle h = 0; h < kEntities; h += 7)
+        CHECK(subscribe_entity(h, EntityListener{&on_entity, nullptr}) > 0);
+
+    const Traffic traffic = make_traffic();
+    const std::size_t messages = traffic.messages[0].size();
+
+    // Warm-up: first samples take their history slots.
+    run_round(traffic, 0);
+    run_round(traffic, 1);
+    host_test::reset_events();
+    g_notified = 0;
+
+    std::size_t allocs = 0;
+    double best_ns = 1e12;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        host_test::AllocScope scope;
+        const auto t0 = std::chrono::steady_clock::now();
+        run_round(traffic, round);
+        const auto t1 = std::chrono::steady_clock::now();
+        allocs += scope.count();
+        best_ns = std::min(best_ns, std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                                        static_cast<double>(messages));
+    }
+    CHECK(allocs == 0);
+
+    // Every round changed every entity and went through the batch path.
+    const std::size_t batches_per_round = (kEntities + kBatch - 1) / kBatch;
+    CHECK(host_test::posted(app_events::ENTITIES_CHANGED) >= kRounds * batches_per_round);
+    CHECK(g_notified >= kRounds * ((kEntities + 6) / 7));
+
+    // The last round (odd) left the CSV states; sensors have history.
+    const ModelPtr after = snapshot();
+    CHECK(after->entities[0].state.load().kind == StateKind::On);
+    CHECK(after->entities[2].state.load().kind == StateKind::Numeric);
+    CHECK(after->entities[2].state.load().value == 21.5f);
+    SeriesPoint points[4];
+    CHECK(read_history(SeriesKey{SeriesSource::Entity, 2}, Resolution::Minute, points, 4) > 0);
+
+    std::printf("MQTT state path, %zu entities, %zu messages per round, best of %d rounds:\n", kEntities, messages, kRounds);
+    std::printf("  %6.1f ns/message, %zu allocs after warm-up\n", best_ns, allocs);
+    return host_test::finish("state_path_alloc_test");
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Host stand-in for esp_event: event bases only. The host build links a
+// stand-in for app_events instead of the loops (see app_events_host.cpp).
+typedef const char *esp_event_base_t;
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t const id = #id
+#define ESP_EVENT_ANY_ID -1
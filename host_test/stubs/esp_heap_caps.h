@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// Host stand-ins for the IDF capability allocator: every region is malloc.
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+inline void *heap_caps_malloc(std::size_t size, std::uint32_t /*caps*/)
+{
+    return std::malloc(size);
+}
+
+inline void *heap_caps_calloc(std::size_t n, std::size_t size, std::uint32_t /*caps*/)
+{
+    return std::calloc(n, size);
+}
+
+inline void heap_caps_free(void *p)
+{
+    std::free(p);
+}
+
+inline std::size_t heap_caps_get_free_size(std::uint32_t /*caps*/)
+{
+    return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdio>
+
+// Host stand-in for esp_log: warnings and errors go to stderr, the rest
+// is dropped so benchmark output stays readable (the arguments are still
+// type-checked, and count as used).
+#define ESP_LOGE(tag, fmt, ...) std::fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) std::fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)sizeof(std::printf("%s: " fmt, tag, ##__VA_ARGS__)))
+#define ESP_LOGD(tag, fmt, ...) ((void)sizeof(std::printf("%s: " fmt, tag, ##__VA_ARGS__)))
+#define ESP_LOGV(tag, fmt, ...) ((void)sizeof(std::printf("%s: " fmt, tag, ##__VA_ARGS__)))
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Table-driven CRC32 (IEEE, reflected), same results as the ROM routine
+// and close to its speed, so benchmarks that checksum images stay fair.
+inline std::uint32_t esp_rom_crc32_le(std::uint32_t crc, const std::uint8_t *buf, std::uint32_t len)
+{
+    static const std::array<std::uint32_t, 256> table = []
+    {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (std::uint32_t i = 0; i < len; ++i)
+        crc = (crc >> 8) ^ table[(crc ^ buf[i]) & 0xFFu];
+    return ~crc;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "esp_err.h"
+
+#include <chrono>
+#include <cstdint>
+
+// Host stand-in for esp_timer: microseconds of the steady clock. Timers
+// cannot be created (callers fall back as they do on the device).
+typedef struct esp_timer *esp_timer_handle_t;
+
+struct esp_timer_create_args_t
+{
+    void (*callback)(void *arg) = nullptr;
+    void *arg = nullptr;
+    const char *name = nullptr;
+};
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t * /*args*/, esp_timer_handle_t *out)
+{
+    *out = nullptr;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t /*timer*/, std::uint64_t /*timeout_us*/)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t /*timer*/, std::uint64_t /*period_us*/)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t /*timer*/)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+inline std::int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
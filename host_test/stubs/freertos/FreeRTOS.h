@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+
+// Host stand-in for the FreeRTOS critical sections: a spinlock.
+struct portMUX_TYPE
+{
+    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void host_port_enter(portMUX_TYPE *mux)
+{
+    while (mux->locked.test_and_set(std::memory_order_acquire))
+    {
+    }
+}
+
+inline void host_port_exit(portMUX_TYPE *mux)
+{
+    mux->locked.clear(std::memory_order_release);
+}
+
+#define portENTER_CRITICAL(mux) host_port_enter(mux)
+#define portEXIT_CRITICAL(mux) host_port_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux) host_port_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux) host_port_exit(mux)
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <cstdint>
+
+// Host stand-in for FreeRTOS tasks: xTaskCreate runs the task function to
+// completion on the calling thread, delays return at once.
+typedef int BaseType_t;
+typedef std::uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char * /*name*/, std::uint32_t /*stack*/, void *arg,
+                              unsigned /*priority*/, TaskHandle_t *handle)
+{
+    if (handle)
+        *handle = nullptr;
+    fn(arg);
+    return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t /*ticks*/)
+{
+}
+
+inline void vTaskDelete(TaskHandle_t /*task*/)
+{
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host build: no PSRAM, no heap hooks.
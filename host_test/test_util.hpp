@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal assertion helpers: a failed CHECK reports and the test exits
+// non-zero at the end (ctest picks that up).
+namespace host_test
+{
+
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int finish(const char *name)
+    {
+        if (failures() == 0)
+        {
+            std::printf("%s: ok\n", name);
+            return EXIT_SUCCESS;
+        }
+        std::printf("%s: %d check(s) failed\n", name, failures());
+        return EXIT_FAILURE;
+    }
+
+} // namespace host_test
+
+#define CHECK(cond)                                                                 \
+    do                                                                              \
+    {                                                                               \
+        if (!(cond))                                                                \
+        {                                                                           \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);    \
+            ++::host_test::failures();                                              \
+        }                                                                           \
+    } while (0)
@@ -0,0 +1,130 @@
+// TimeSeriesStore (main/app/timeseries.*): bucket aggregation, the
+// reserved DHT/weather slots, eviction of idle entity series and
+// forget().
+
+#include "timeseries.hpp"
+#include "test_util.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+using namespace state;
+
+namespace
+{
+
+    constexpr std::size_t kMaxSeries = 8; // 3 reserved + 5 entity slots
+    constexpr std::int64_t kSecond = 1000000;
+
+    SeriesKey entity(EntityHandle h)
+    {
+        return SeriesKey{SeriesSource::Entity, h};
+    }
+
+    std::size_t points(const TimeSeriesStore &store, const SeriesKey &key)
+    {
+        SeriesPoint out[60];
+        return store.read(key, Resolution::Minute, out, 60);
+    }
+
+    void test_buckets()
+    {
+        TimeSeriesStore store;
+        CHECK(store.init(kMaxSeries));
+        const SeriesKey key = entity(1);
+        store.record(key, 10.0f, 0);
+        store.record(key, 20.0f, 30 * kSecond);
+        store.record(key, 5.0f, 61 * kSecond);
+        store.record(key, NAN, 62 * kSecond); // NaN: ignored
+
+        SeriesPoint out[4];
+        CHECK(store.read(key, Resolution::Minute, out, 4) == 2);
+        CHECK(out[0].start_s == 0 && out[0].samples == 2);
+        CHECK(out[0].min == 10.0f && out[0].max == 20.0f && out[0].avg == 15.0f);
+        CHECK(out[1].start_s == 60 && out[1].samples == 1 && out[1].avg == 5.0f);
+        CHECK(store.read(key, Resolution::Hour, out, 4) == 1);
+        CHECK(out[0].samples == 3 && out[0].min == 5.0f);
+        CHECK(store.read(entity(2), Resolution::Minute, out, 4) == 0);
+    }
+
+    // Entities cannot take the DHT and weather slots, however many there are.
+    void test_reserved()
+    {
+        TimeSeriesStore store;
+        CHECK(store.init(kMaxSeries));
+        for (EntityHandle h = 0; h < 20; ++h)
+            store.record(entity(h), 1.0f, 0);
+        CHECK(store.series() == kMaxSeries - kReservedSeries);
+        CHECK(points(store, entity(4)) == 1);
+        CHECK(points(store, entity(5)) == 0); // no slot left
+
+        store.record(SeriesKey{SeriesSource::DhtTemperature}, 21.0f, 0);
+        store.record(SeriesKey{SeriesSource::DhtHumidity}, 40.0f, 0);
+        store.record(SeriesKey{SeriesSource::WeatherTemperature}, 15.0f, 0);
+        CHECK(store.series() == kMaxSeries);
+        CHECK(points(store, SeriesKey{SeriesSource::DhtTemperature}) == 1);
+        CHECK(points(store, SeriesKey{SeriesSource::DhtHumidity}) == 1);
+        CHECK(points(store, SeriesKey{SeriesSource::WeatherTemperature}) == 1);
+
+        CHECK(!TimeSeriesStore().init(kReservedSeries));
+    }
+
+    // A full store hands out the slot of the series idle the longest, but
+    // only once it has been idle for kEvictAfterS.
+    void test_eviction()
+    {
+        TimeSeriesStore store;
+        CHECK(store.init(kMaxSeries));
+        const std::int64_t t0 = 100 * kSecond;
+        for (EntityHandle h = 0; h < 5; ++h)
+            store.record(entity(h), 1.0f, t0 + h * kSecond);
+
+        // Entity 0 is the oldest but not idle long enough yet.
+        const std::int64_t soon = t0 + (TimeSeriesStore::kEvictAfterS - 10) * kSecond;
+        store.record(entity(10), 2.0f, soon);
+        CHECK(points(store, entity(10)) == 0);
+
+        // Keep 1..4 alive, let 0 go idle.
+        for (EntityHandle h = 1; h < 5; ++h)
+            store.record(entity(h), 1.0f, soon);
+        const std::int64_t later = t0 + (TimeSeriesStore::kEvictAfterS + 1) * kSecond;
+        store.record(entity(10), 2.0f, later);
+        CHECK(points(store, entity(10)) == 1);
+        CHECK(points(store, entity(0)) == 0);
+        for (EntityHandle h = 1; h < 5; ++h)
+            CHECK(points(store, entity(h)) > 0);
+
+        // Everyone active: the next newcomer is dropped.
+        store.record(entity(11), 3.0f, later);
+        CHECK(points(store, entity(11)) == 0);
+        CHECK(store.series() == kMaxSeries - kReservedSeries);
+    }
+
+    void test_forget()
+    {
+        TimeSeriesStore store;
+        CHECK(store.init(kMaxSeries));
+        for (EntityHandle h = 0; h < 5; ++h)
+            store.record(entity(h), 1.0f, 0);
+        store.forget(entity(2));
+        store.forget(entity(42)); // unknown: no-op
+        CHECK(store.series() == 4);
+        CHECK(points(store, entity(2)) == 0);
+
+        // The freed slot is taken at once, and starts empty.
+        store.record(entity(7), 5.0f, kSecond);
+        CHECK(points(store, entity(7)) == 1);
+        store.record(entity(2), 6.0f, kSecond);
+        CHECK(points(store, entity(2)) == 0);
+    }
+
+} // namespace
+
+int main()
+{
+    test_buckets();
+    test_reserved();
+    test_eviction();
+    test_forget();
+    return host_test::finish("timeseries_test");
+}
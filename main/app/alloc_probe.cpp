@@ -0,0 +1,66 @@
+#include "alloc_probe.hpp"
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace alloc_probe
+{
+
+    namespace
+    {
+        // Task whose allocations are counted; nullptr = no scope open.
+        static std::atomic<TaskHandle_t> s_task{nullptr};
+        static std::atomic<std::uint32_t> s_count{0};
+    } // namespace
+
+#if CONFIG_HEAP_USE_HOOKS
+    bool available()
+    {
+        return true;
+    }
+#else
+    bool available()
+    {
+        return false;
+    }
+#endif
+
+    Scope::Scope()
+    {
+        TaskHandle_t expected = nullptr;
+        owner_ = s_task.compare_exchange_strong(expected, xTaskGetCurrentTaskHandle(), std::memory_order_acq_rel);
+        if (owner_)
+            s_count.store(0, std::memory_order_relaxed);
+    }
+
+    Scope::~Scope()
+    {
+        if (owner_)
+            s_task.store(nullptr, std::memory_order_release);
+    }
+
+    std::uint32_t Scope::count() const
+    {
+        return owner_ ? s_count.load(std::memory_order_relaxed) : 0;
+    }
+
+} // namespace alloc_probe
+
+#if CONFIG_HEAP_USE_HOOKS
+// Called by the heap allocator for every successful allocation.
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void * /*ptr*/, size_t /*size*/, uint32_t /*caps*/)
+{
+    const TaskHandle_t task = alloc_probe::s_task.load(std::memory_order_relaxed);
+    if (task && task == xTaskGetCurrentTaskHandle())
+        alloc_probe::s_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void * /*ptr*/)
+{
+}
+#endif
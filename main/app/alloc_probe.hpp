@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations made by one task inside a scope, to check that
+// a path meant to be allocation-free stays that way on the device. Needs
+// CONFIG_HEAP_USE_HOOKS, which hooks every allocation and is off in the
+// shipped sdkconfig; enable it in a debug build (menuconfig: Heap memory
+// debugging). Without it available() is false, scopes count nothing and
+// callers should say so. host_test/state_path_alloc_test checks the same
+// path on every host build.
+namespace alloc_probe
+{
+
+    bool available();
+
+    // Allocations by the current task while the scope is alive. One scope
+    // at a time (per firmware); a nested or concurrent one counts nothing.
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        std::uint32_t count() const;
+
+    private:
+        bool owner_ = false;
+    };
+
+} // namespace alloc_probe
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace app_config
@@ -21,7 +22,78 @@ namespace app_config
     // Interval between weather HTTP polls.
     constexpr std::uint32_t kWeatherPollIntervalMs = 120 * 1000;
 
+    // Interval between background re-bootstraps of the HA area/entity
+    // list (see http_manager::start_state_refresh).
+    constexpr std::uint32_t kStateRefreshIntervalMs = 30 * 60 * 1000;
+
+    // After a warm boot (rooms shown from the stored snapshot), bring the
+    // splash with the setup button back if HA is still unreachable.
+    constexpr std::uint32_t kWarmBootSplashFallbackMs = 60 * 1000;
+
+    // Number of value histories kept, ~6.5 KB each, in PSRAM: DHT
+    // temperature and humidity and weather temperature have reserved
+    // slots, the rest go to numeric entities (see TimeSeriesStore).
+    constexpr std::size_t kHistoryMaxSeries = 16;
+
     // Interval between local DHT11 sensor polls.
     constexpr std::uint32_t kDhtPollIntervalMs = 2 * 1000;
 
+    // MQTT state updates arriving within this window are applied as one
+    // batch (one ENTITIES_CHANGED event, one UI pass).
+    constexpr std::uint32_t kStateBatchWindowMs = 20;
+
+    // Application event loops (see app_events::Lane). Input events are
+    // dispatched above the LVGL task (priority 4) so a knob turn is
+    // handled while a state update waits for the display; the state lane
+    // stays off the input core. core -1 = no affinity.
+    struct EventLaneConfig
+    {
+        const char *task_name;
+        std::int32_t queue_size;
+        std::uint32_t priority;
+        std::uint32_t stack_size;
+        int core;
+    };
+
+    constexpr EventLaneConfig kInputEventLane = {"ev_input", 16, 6, 4096, 1};
+    constexpr EventLaneConfig kStateEventLane = {"ev_state", 32, 5, 4096, 0};
+
+    // Period of the event bus metrics dump on the serial console (see
+    // event_metrics); 0 logs only on request (GET /api/metrics).
+    constexpr std::uint32_t kEventMetricsLogIntervalMs = 0;
+
+    // Port of the read-only diagnostics HTTP server (metrics, event trace
+    // download) run in normal mode. Trace upload/replay and metrics reset
+    // are only served by the config server, in config mode, on port 80.
+    constexpr std::uint16_t kDiagHttpPort = 8080;
+
+    // MQTT messages above the client's 2 KB buffer arrive in fragments;
+    // up to kMqttReassemblySlots of them are reassembled at once, each up
+    // to kMqttMaxMessageBytes (buffers allocated once, in PSRAM). Larger
+    // messages are dropped and counted (ha_mqtt::rx_stats()).
+    constexpr std::size_t kMqttMaxMessageBytes = 8 * 1024;
+    constexpr std::size_t kMqttReassemblySlots = 2;
+
+    // Deferred log (see deferred_log): records the ring holds (power of
+    // two; ~96 B each: kMaxArgBytes of arguments plus call site, format
+    // function, timestamp and turn counter, so ~6 KB for 64), how often
+    // the formatter task drains it, and its task settings. Priority 1
+    // keeps the UART writes below every hot path.
+    constexpr std::size_t kDeferredLogSlots = 64;
+    constexpr std::uint32_t kDeferredLogFlushMs = 50;
+    constexpr std::size_t kDeferredLogLineLength = 160;
+    constexpr std::uint32_t kDeferredLogTaskPriority = 1;
+    constexpr std::uint32_t kDeferredLogTaskStack = 3072;
+
+    // Bytes of the app event trace recorded from boot (see event_trace;
+    // ~20 B per input event, 6 B per state batch + 8 B per changed
+    // entity), in PSRAM; 0 = off. 64 KB holds a few thousand input
+    // events or state batches; export it from GET /api/trace on
+    // kDiagHttpPort.
+    constexpr std::size_t kEventTraceBytes = 64 * 1024;
+
+    // Period of the room-page timer that applies changed entity states to
+    // widgets (roughly one display frame).
+    constexpr std::uint32_t kUiStateRefreshMs = 33;
+
 } // namespace app_config
@@ -1,7 +1,16 @@
 #include "app_events.hpp"
 
 #include "esp_log.h"
-#include <cstdio>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "app_config.hpp"
+#include "event_metrics.hpp"
+#include "event_table.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <utility>
 
 ESP_EVENT_DEFINE_BASE(APP_EVENTS);
 
@@ -11,346 +20,316 @@ namespace app_events
     namespace
     {
         static const char *TAG = "app_events";
-    }
 
-    esp_err_t post_knob(int code, std::int64_t timestamp_us, bool from_isr)
-    {
-        KnobPayload payload;
-        payload.code = code;
-        payload.timestamp_us = timestamp_us;
+        using detail::kMaxId;
+        using detail::kSlotById;
+        using detail::Subscriber;
+        using detail::SubscriberTable;
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     KNOB,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
-        {
-            err = esp_event_post(APP_EVENTS,
-                                 KNOB,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
-        }
+        // ---- coalescing ----------------------------------------------------
 
-        if (err != ESP_OK)
-        {
-            ESP_LOGW(TAG, "post_knob failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
+        using TimestampFn = std::int64_t (*)(const void *payload);
 
-    esp_err_t post_button(int code, std::int64_t timestamp_us, bool from_isr)
-    {
-        ButtonPayload payload;
-        payload.code = code;
-        payload.timestamp_us = timestamp_us;
-
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     BUTTON,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+        template <Id E>
+        std::int64_t timestamp_of(const void *payload)
         {
-            err = esp_event_post(APP_EVENTS,
-                                 BUTTON,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            return static_cast<const PayloadOf<E> *>(payload)->timestamp_us;
         }
 
-        if (err != ESP_OK)
+        struct SlotPolicy
         {
-            ESP_LOGW(TAG, "post_button failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
-
-    esp_err_t post_gesture(int code, std::int64_t timestamp_us, bool from_isr)
-    {
-        GesturePayload payload;
-        payload.code = code;
-        payload.timestamp_us = timestamp_us;
+            Lane lane;
+            Coalesce coalesce;
+            TimestampFn timestamp;
+        };
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     GESTURE,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+        template <Id E>
+        constexpr SlotPolicy policy_of()
         {
-            err = esp_event_post(APP_EVENTS,
-                                 GESTURE,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            return SlotPolicy{EventTraits<E>::lane, EventTraits<E>::coalesce, &timestamp_of<E>};
         }
 
-        if (err != ESP_OK)
+        template <std::size_t... I>
+        constexpr std::array<SlotPolicy, kEventCount> make_policies(std::index_sequence<I...>)
         {
-            ESP_LOGW(TAG, "post_gesture failed: %s", esp_err_to_name(err));
+            return {policy_of<kEventIds[I]>()...};
         }
-        return err;
-    }
 
-    esp_err_t post_navigate_room(int delta, std::int64_t timestamp_us, bool from_isr)
-    {
-        NavigateRoomPayload payload;
-        payload.delta = delta;
-        payload.timestamp_us = timestamp_us;
-
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     NAVIGATE_ROOM,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
-        {
-            err = esp_event_post(APP_EVENTS,
-                                 NAVIGATE_ROOM,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
-        }
+        constexpr std::array<SlotPolicy, kEventCount> kPolicyBySlot = make_policies(std::make_index_sequence<kEventCount>{});
 
-        if (err != ESP_OK)
+        // The queued instance of a Merge event: the loop queue only holds a
+        // marker without data (esp_event would heap-copy it), the payload
+        // posts merge into lives here.
+        struct MergeSlot
         {
-            ESP_LOGW(TAG, "post_navigate_room failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
+            bool queued = false;
+            alignas(8) unsigned char payload[kMaxMergedPayloadSize];
+        };
 
-    esp_err_t post_toggle_current_entity(std::int64_t timestamp_us, bool from_isr)
-    {
-        ToggleCurrentEntityPayload payload;
-        payload.timestamp_us = timestamp_us;
+        static MergeSlot s_merge[kEventCount];
+        static portMUX_TYPE s_coalesce_mux = portMUX_INITIALIZER_UNLOCKED;
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     TOGGLE_CURRENT_ENTITY,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+        // Take the merged payload of `slot` for dispatch.
+        static void take_merged(std::size_t slot, void *out)
         {
-            err = esp_event_post(APP_EVENTS,
-                                 TOGGLE_CURRENT_ENTITY,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            portENTER_CRITICAL_SAFE(&s_coalesce_mux);
+            std::memcpy(out, s_merge[slot].payload, kMaxMergedPayloadSize);
+            s_merge[slot].queued = false;
+            portEXIT_CRITICAL_SAFE(&s_coalesce_mux);
         }
 
-        if (err != ESP_OK)
-        {
-            ESP_LOGW(TAG, "post_toggle_current_entity failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
+        constexpr std::size_t kMaxMonitors = 2;
 
-    esp_err_t post_entity_state_changed(const char *entity_id, std::int64_t timestamp_us, bool from_isr)
-    {
-        if (!entity_id || !*entity_id)
-        {
-            return ESP_ERR_INVALID_ARG;
-        }
+        static SubscriberTable s_table;
+        static MonitorFn s_monitors[kMaxMonitors] = {};
+        static std::atomic<std::uint8_t> s_monitor_count{0};
+        static portMUX_TYPE s_register_mux = portMUX_INITIALIZER_UNLOCKED;
 
-        EntityStateChangedPayload payload{};
-        std::snprintf(payload.entity_id, sizeof(payload.entity_id), "%s", entity_id);
-        payload.timestamp_us = timestamp_us;
+        // Indexed by Lane.
+        constexpr const app_config::EventLaneConfig *kLaneConfigs[kLaneCount] = {
+            &app_config::kInputEventLane,
+            &app_config::kStateEventLane,
+        };
+        static esp_event_loop_handle_t s_loops[kLaneCount] = {};
+        static std::atomic<PostHookFn> s_post_hook{nullptr};
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     ENTITY_STATE_CHANGED,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+        static void run_post_hook(Id id, const void *payload, std::size_t size)
         {
-            err = esp_event_post(APP_EVENTS,
-                                 ENTITY_STATE_CHANGED,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            const PostHookFn hook = s_post_hook.load(std::memory_order_acquire);
+            if (hook)
+            {
+                hook(id, payload, size);
+            }
         }
 
-        if (err != ESP_OK)
+        static esp_err_t enqueue(Lane lane, Id id, const void *payload, std::size_t size, bool from_isr)
         {
-            ESP_LOGW(TAG, "post_entity_state_changed failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
+            esp_event_loop_handle_t loop = s_loops[static_cast<std::size_t>(lane)];
+            if (!loop)
+            {
+                return ESP_ERR_INVALID_STATE;
+            }
 
-    esp_err_t post_toggle_request(const char *entity_id, std::int64_t timestamp_us, bool from_isr)
-    {
-        if (!entity_id || !*entity_id)
-        {
-            return ESP_ERR_INVALID_ARG;
-        }
-
-        ToggleRequestPayload payload{};
-        std::snprintf(payload.entity_id, sizeof(payload.entity_id), "%s", entity_id);
-        payload.timestamp_us = timestamp_us;
+            const std::size_t slot = (id >= 0 && id <= kMaxId) ? kSlotById.slot[id] : kNoSlot;
+            const std::uint32_t depth = event_metrics::on_enqueue(lane);
+            esp_err_t err;
+            if (from_isr)
+            {
+                err = esp_event_isr_post_to(loop, APP_EVENTS, id, payload, size, nullptr);
+            }
+            else
+            {
+                err = esp_event_post_to(loop, APP_EVENTS, id, payload, size, 0);
+            }
+            event_metrics::on_post_result(lane, slot, depth, err == ESP_OK);
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     TOGGLE_REQUEST,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
-        {
-            err = esp_event_post(APP_EVENTS,
-                                 TOGGLE_REQUEST,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            // Drops are counted in event_metrics; no log from an ISR.
+            if (err != ESP_OK && !from_isr)
+            {
+                ESP_LOGW(TAG, "post %s failed: %s", id_to_string(id), esp_err_to_name(err));
+            }
+            return err;
         }
 
-        if (err != ESP_OK)
+        // The only esp_event handler for APP_EVENTS, on every lane.
+        static void on_app_event(void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
         {
-            ESP_LOGW(TAG, "post_toggle_request failed: %s", esp_err_to_name(err));
-        }
-        return err;
-    }
+            if (base != APP_EVENTS || id < 0 || id > kMaxId)
+            {
+                return;
+            }
+            const std::size_t slot = kSlotById.slot[id];
+            if (slot == kNoSlot)
+            {
+                return;
+            }
+
+            const void *payload = event_data;
+            alignas(8) unsigned char merged[kMaxMergedPayloadSize];
+            const SlotPolicy &policy = kPolicyBySlot[slot];
+            if (policy.coalesce != Coalesce::Merge && !event_data)
+            {
+                return;
+            }
+            if (policy.coalesce == Coalesce::Merge)
+            {
+                take_merged(slot, merged);
+                payload = merged;
+            }
+
+            // Queue wait is measured from the payload timestamp (0 = not
+            // stamped), handler time over all subscribers.
+            const std::int64_t posted_us = policy.timestamp(payload);
+            const std::int64_t start_us = esp_timer_get_time();
+            s_table.dispatch_slot(slot, payload);
+            event_metrics::on_dispatched(policy.lane, slot,
+                                         posted_us > 0 ? start_us - posted_us : -1,
+                                         esp_timer_get_time() - start_us);
+
+            const std::uint8_t n = s_monitor_count.load(std::memory_order_acquire);
+            for (std::uint8_t i = 0; i < n; ++i)
+            {
+                s_monitors[i](static_cast<Id>(id), payload);
+            }
+        }
+
+    } // namespace
+
+    namespace detail
+    {
 
-    esp_err_t post_toggle_result(const char *entity_id, bool success, std::int64_t timestamp_us, bool from_isr)
+        esp_err_t add_subscriber(std::size_t slot, ErasedFn fn, Invoker invoker)
+        {
+            if (slot >= kEventCount || !fn || !invoker)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            portENTER_CRITICAL(&s_register_mux);
+            const bool ok = s_table.add(slot, Subscriber{fn, invoker});
+            portEXIT_CRITICAL(&s_register_mux);
+
+            if (!ok)
+            {
+                ESP_LOGE(TAG, "too many subscribers for %s", id_to_string(kEventIds[slot]));
+                return ESP_ERR_NO_MEM;
+            }
+            return ESP_OK;
+        }
+
+        esp_err_t post_raw(Lane lane, Id id, const void *payload, std::size_t size, bool from_isr)
+        {
+            run_post_hook(id, payload, size);
+            return enqueue(lane, id, payload, size, from_isr);
+        }
+
+        esp_err_t post_merged(Lane lane, Id id, const void *payload, std::size_t size, Merger merger, bool from_isr)
+        {
+            const std::size_t slot = slot_of(id);
+            if (slot == kNoSlot || size > kMaxMergedPayloadSize)
+            {
+                return ESP_ERR_INVALID_ARG;
+            }
+            run_post_hook(id, payload, size);
+
+            bool first = false;
+            portENTER_CRITICAL_SAFE(&s_coalesce_mux);
+            MergeSlot &m = s_merge[slot];
+            if (m.queued)
+            {
+                merger(m.payload, payload);
+            }
+            else
+            {
+                std::memcpy(m.payload, payload, size);
+                m.queued = true;
+                first = true;
+            }
+            portEXIT_CRITICAL_SAFE(&s_coalesce_mux);
+
+            if (!first)
+            {
+                event_metrics::on_coalesced(slot);
+                return ESP_OK;
+            }
+
+            // The queued event is only a marker; the dispatcher reads s_merge.
+            esp_err_t err = enqueue(lane, id, nullptr, 0, from_isr);
+            if (err != ESP_OK)
+            {
+                portENTER_CRITICAL_SAFE(&s_coalesce_mux);
+                m.queued = false;
+                portEXIT_CRITICAL_SAFE(&s_coalesce_mux);
+            }
+            return err;
+        }
+
+    } // namespace detail
+
+    esp_err_t add_monitor(MonitorFn fn)
     {
-        if (!entity_id || !*entity_id)
+        if (!fn)
         {
             return ESP_ERR_INVALID_ARG;
         }
 
-        ToggleResultPayload payload{};
-        std::snprintf(payload.entity_id, sizeof(payload.entity_id), "%s", entity_id);
-        payload.success = success;
-        payload.timestamp_us = timestamp_us;
-
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     TOGGLE_RESULT,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+        portENTER_CRITICAL(&s_register_mux);
+        const std::uint8_t n = s_monitor_count.load(std::memory_order_relaxed);
+        const bool ok = n < kMaxMonitors;
+        if (ok)
         {
-            err = esp_event_post(APP_EVENTS,
-                                 TOGGLE_RESULT,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            s_monitors[n] = fn;
+            s_monitor_count.store(n + 1, std::memory_order_release);
         }
+        portEXIT_CRITICAL(&s_register_mux);
 
-        if (err != ESP_OK)
-        {
-            ESP_LOGW(TAG, "post_toggle_result failed: %s", esp_err_to_name(err));
-        }
-        return err;
+        return ok ? ESP_OK : ESP_ERR_NO_MEM;
     }
 
-    esp_err_t post_app_state_changed(AppState old_state, AppState new_state, std::int64_t timestamp_us, bool from_isr)
+    void set_post_hook(PostHookFn fn)
     {
-        AppStateChangedPayload payload{};
-        payload.old_state = static_cast<int>(old_state);
-        payload.new_state = static_cast<int>(new_state);
-        payload.timestamp_us = timestamp_us;
-
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     APP_STATE_CHANGED,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
-        {
-            err = esp_event_post(APP_EVENTS,
-                                 APP_STATE_CHANGED,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
-        }
-
-        if (err != ESP_OK)
-        {
-            ESP_LOGW(TAG, "post_app_state_changed failed: %s", esp_err_to_name(err));
-        }
-        return err;
+        s_post_hook.store(fn, std::memory_order_release);
     }
 
-    static esp_err_t post_empty_event(int32_t id, std::int64_t timestamp_us, bool from_isr)
+    esp_err_t init()
     {
-        EmptyPayload payload{};
-        payload.timestamp_us = timestamp_us;
+        for (std::size_t lane = 0; lane < kLaneCount; ++lane)
+        {
+            if (s_loops[lane])
+            {
+                continue;
+            }
+
+            const app_config::EventLaneConfig &cfg = *kLaneConfigs[lane];
+            esp_event_loop_args_t args = {};
+            args.queue_size = cfg.queue_size;
+            args.task_name = cfg.task_name;
+            args.task_priority = cfg.priority;
+            args.task_stack_size = cfg.stack_size;
+            args.task_core_id = (cfg.core < 0) ? tskNO_AFFINITY : cfg.core;
+
+            esp_event_loop_handle_t loop = nullptr;
+            esp_err_t err = esp_event_loop_create(&args, &loop);
+            if (err == ESP_OK)
+            {
+                err = esp_event_handler_register_with(loop, APP_EVENTS, ESP_EVENT_ANY_ID, &on_app_event, nullptr);
+                if (err != ESP_OK)
+                {
+                    (void)esp_event_loop_delete(loop);
+                }
+            }
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "failed to start event lane %s: %s", cfg.task_name, esp_err_to_name(err));
+                return err;
+            }
+            s_loops[lane] = loop;
+            ESP_LOGI(TAG, "event lane %s: queue %d, prio %u, core %d",
+                     cfg.task_name,
+                     static_cast<int>(cfg.queue_size),
+                     static_cast<unsigned>(cfg.priority),
+                     cfg.core);
+        }
+        return ESP_OK;
+    }
 
-        esp_err_t err;
-        if (from_isr)
-        {
-            err = esp_event_isr_post(APP_EVENTS,
-                                     id,
-                                     &payload,
-                                     sizeof(payload),
-                                     nullptr);
-        }
-        else
+    esp_err_t post_entities_changed(const std::uint16_t *entities, std::size_t count, std::int64_t timestamp_us)
+    {
+        if (!entities || count == 0)
         {
-            err = esp_event_post(APP_EVENTS,
-                                 id,
-                                 &payload,
-                                 sizeof(payload),
-                                 0);
+            return ESP_ERR_INVALID_ARG;
         }
 
-        if (err != ESP_OK)
+        EntitiesChangedPayload payload{};
+        payload.overflow = count > kMaxEntitiesPerChange;
+        payload.count = static_cast<std::uint16_t>(payload.overflow ? kMaxEntitiesPerChange : count);
+        for (std::size_t i = 0; i < payload.count; ++i)
         {
-            ESP_LOGW(TAG, "post_empty_event(id=%d) failed: %s", (int)id, esp_err_to_name(err));
+            payload.entities[i] = entities[i];
         }
-        return err;
-    }
-
-    esp_err_t post_request_config_mode(std::int64_t timestamp_us, bool from_isr)
-    {
-        return post_empty_event(REQUEST_CONFIG_MODE, timestamp_us, from_isr);
-    }
-
-    esp_err_t post_request_sleep(std::int64_t timestamp_us, bool from_isr)
-    {
-        return post_empty_event(REQUEST_SLEEP, timestamp_us, from_isr);
-    }
+        payload.timestamp_us = timestamp_us;
 
-    esp_err_t post_request_wake(std::int64_t timestamp_us, bool from_isr)
-    {
-        return post_empty_event(REQUEST_WAKE, timestamp_us, from_isr);
+        return post<ENTITIES_CHANGED>(payload);
     }
 
     const char *id_to_string(int32_t id)
@@ -367,8 +346,10 @@ namespace app_events
             return "NAVIGATE_ROOM";
         case TOGGLE_CURRENT_ENTITY:
             return "TOGGLE_CURRENT_ENTITY";
-        case ENTITY_STATE_CHANGED:
-            return "ENTITY_STATE_CHANGED";
+        case ENTITIES_CHANGED:
+            return "ENTITIES_CHANGED";
+        case MODEL_UPDATED:
+            return "MODEL_UPDATED";
         case WEATHER_UPDATED:
             return "WEATHER_UPDATED";
         case CLOCK_UPDATED:
@@ -390,14 +371,4 @@ namespace app_events
         }
     }
 
-    esp_err_t post_weather_updated(std::int64_t timestamp_us, bool from_isr)
-    {
-        return post_empty_event(WEATHER_UPDATED, timestamp_us, from_isr);
-    }
-
-    esp_err_t post_clock_updated(std::int64_t timestamp_us, bool from_isr)
-    {
-        return post_empty_event(CLOCK_UPDATED, timestamp_us, from_isr);
-    }
-
 } // namespace app_events
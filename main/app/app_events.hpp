@@ -1,6 +1,7 @@
 #pragma once
 
 #include "esp_event.h"
+#include <cstddef>
 #include <cstdint>
 
 #include "app_state.hpp"
@@ -18,7 +19,8 @@ namespace app_events
         GESTURE = 3,
         NAVIGATE_ROOM = 10,
         TOGGLE_CURRENT_ENTITY = 12,
-        ENTITY_STATE_CHANGED = 20,
+        ENTITIES_CHANGED = 21,
+        MODEL_UPDATED = 22,
         WEATHER_UPDATED = 40,
         CLOCK_UPDATED = 41,
         TOGGLE_REQUEST = 30,
@@ -64,21 +66,32 @@ namespace app_events
         std::int64_t timestamp_us = 0;
     };
 
-    struct EntityStateChangedPayload
+    // Entities are identified by their state::EntityHandle (dense index
+    // assigned at bootstrap); 0xFFFF means "no entity".
+
+    // One notification for a batch of state updates (see
+    // state::apply_entity_updates); batches posted while one is queued
+    // merge into it. If more entities changed than fit, `overflow` is set
+    // and receivers should refresh everything.
+    constexpr std::size_t kMaxEntitiesPerChange = 32;
+
+    struct EntitiesChangedPayload
     {
-        char entity_id[96];
+        std::uint16_t count = 0;
+        bool overflow = false;
+        std::uint16_t entities[kMaxEntitiesPerChange] = {};
         std::int64_t timestamp_us = 0;
     };
 
     struct ToggleRequestPayload
     {
-        char entity_id[96];
+        std::uint16_t entity = 0xFFFF;
         std::int64_t timestamp_us = 0;
     };
 
     struct ToggleResultPayload
     {
-        char entity_id[96];
+        std::uint16_t entity = 0xFFFF;
         bool success = false;
         std::int64_t timestamp_us = 0;
     };
@@ -95,26 +108,195 @@ namespace app_events
         std::int64_t timestamp_us = 0;
     };
 
-    const char *id_to_string(int32_t id);
-    // Currently a no-op stub; kept for symmetry / future use
-    inline esp_err_t init()
+    // Each event is dispatched by one of two loop tasks (see
+    // app_config::kInputEventLane/kStateEventLane), so a handler stuck on
+    // HTTP or a long LVGL rebuild in one lane does not hold up the other.
+    // Handlers of different lanes may run concurrently.
+    enum class Lane : std::uint8_t
+    {
+        Input, // knob/button/touch and what they trigger
+        State, // HA state, model, weather, toggle round trips
+        Count,
+    };
+    constexpr std::size_t kLaneCount = static_cast<std::size_t>(Lane::Count);
+
+    // How posts of one id that are still queued combine.
+    enum class Coalesce : std::uint8_t
+    {
+        None,  // every post is dispatched
+        Merge, // one queued instance; later posts merge into it (merge_payload)
+    };
+
+    // Compile-time map from event id to payload type, lane and coalescing.
+    // Posting or subscribing to an id without a specialization does not
+    // compile.
+    template <Id E>
+    struct EventTraits;
+
+    template <typename P, Lane L, Coalesce C = Coalesce::None>
+    struct EventDef
+    {
+        using Payload = P;
+        static constexpr Lane lane = L;
+        static constexpr Coalesce coalesce = C;
+    };
+
+    template <> struct EventTraits<KNOB> : EventDef<KnobPayload, Lane::Input> {};
+    template <> struct EventTraits<BUTTON> : EventDef<ButtonPayload, Lane::Input> {};
+    template <> struct EventTraits<GESTURE> : EventDef<GesturePayload, Lane::Input> {};
+    template <> struct EventTraits<NAVIGATE_ROOM> : EventDef<NavigateRoomPayload, Lane::Input, Coalesce::Merge> {};
+    template <> struct EventTraits<TOGGLE_CURRENT_ENTITY> : EventDef<ToggleCurrentEntityPayload, Lane::Input> {};
+    template <> struct EventTraits<ENTITIES_CHANGED> : EventDef<EntitiesChangedPayload, Lane::State, Coalesce::Merge> {};
+    template <> struct EventTraits<MODEL_UPDATED> : EventDef<EmptyPayload, Lane::State> {};
+    template <> struct EventTraits<WEATHER_UPDATED> : EventDef<EmptyPayload, Lane::State> {};
+    template <> struct EventTraits<CLOCK_UPDATED> : EventDef<EmptyPayload, Lane::State> {};
+    template <> struct EventTraits<TOGGLE_REQUEST> : EventDef<ToggleRequestPayload, Lane::State> {};
+    template <> struct EventTraits<TOGGLE_RESULT> : EventDef<ToggleResultPayload, Lane::State> {};
+    template <> struct EventTraits<APP_STATE_CHANGED> : EventDef<AppStateChangedPayload, Lane::Input> {};
+    template <> struct EventTraits<REQUEST_CONFIG_MODE> : EventDef<EmptyPayload, Lane::Input> {};
+    template <> struct EventTraits<REQUEST_SLEEP> : EventDef<EmptyPayload, Lane::Input> {};
+    template <> struct EventTraits<REQUEST_WAKE> : EventDef<EmptyPayload, Lane::Input, Coalesce::Merge> {};
+
+    template <Id E>
+    using PayloadOf = typename EventTraits<E>::Payload;
+
+    // Merge rules for Coalesce::Merge. The first post's timestamp is kept,
+    // so queue latency is measured from the oldest input.
+    inline void merge_payload(NavigateRoomPayload &pending, const NavigateRoomPayload &next)
+    {
+        pending.delta += next.delta; // net movement
+    }
+
+    inline void merge_payload(EmptyPayload & /*pending*/, const EmptyPayload & /*next*/)
     {
-        return ESP_OK;
     }
 
-    esp_err_t post_knob(int code, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_button(int code, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_gesture(int code, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_navigate_room(int delta, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_toggle_current_entity(std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_entity_state_changed(const char *entity_id, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_toggle_request(const char *entity_id, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_toggle_result(const char *entity_id, bool success, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_app_state_changed(AppState old_state, AppState new_state, std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_request_config_mode(std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_request_sleep(std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_request_wake(std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_weather_updated(std::int64_t timestamp_us, bool from_isr);
-    esp_err_t post_clock_updated(std::int64_t timestamp_us, bool from_isr);
+    // Union of the entity lists.
+    inline void merge_payload(EntitiesChangedPayload &pending, const EntitiesChangedPayload &next)
+    {
+        pending.overflow = pending.overflow || next.overflow;
+        for (std::uint16_t i = 0; i < next.count && !pending.overflow; ++i)
+        {
+            std::uint16_t j = 0;
+            while (j < pending.count && pending.entities[j] != next.entities[i])
+                ++j;
+            if (j < pending.count)
+                continue;
+            if (pending.count == kMaxEntitiesPerChange)
+                pending.overflow = true;
+            else
+                pending.entities[pending.count++] = next.entities[i];
+        }
+    }
+
+    // Every id, in dispatch-table order.
+    constexpr Id kEventIds[] = {
+        KNOB,
+        BUTTON,
+        GESTURE,
+        NAVIGATE_ROOM,
+        TOGGLE_CURRENT_ENTITY,
+        ENTITIES_CHANGED,
+        MODEL_UPDATED,
+        WEATHER_UPDATED,
+        CLOCK_UPDATED,
+        TOGGLE_REQUEST,
+        TOGGLE_RESULT,
+        APP_STATE_CHANGED,
+        REQUEST_CONFIG_MODE,
+        REQUEST_SLEEP,
+        REQUEST_WAKE,
+    };
+    constexpr std::size_t kEventCount = sizeof(kEventIds) / sizeof(kEventIds[0]);
+    constexpr std::size_t kNoSlot = kEventCount;
+
+    constexpr std::size_t slot_of(int32_t id)
+    {
+        for (std::size_t i = 0; i < kEventCount; ++i)
+        {
+            if (kEventIds[i] == id)
+                return i;
+        }
+        return kNoSlot;
+    }
+
+    // Handlers per id. Subscriptions are made at init and never removed.
+    constexpr std::size_t kMaxSubscribersPerEvent = 4;
+
+    // Largest payload of a Coalesce::Merge event.
+    constexpr std::size_t kMaxMergedPayloadSize = sizeof(EntitiesChangedPayload);
+
+    namespace detail
+    {
+        // Handlers are stored type-erased and cast back to their exact
+        // type by the invoker instantiated for their id.
+        using ErasedFn = void (*)();
+        using Invoker = void (*)(ErasedFn fn, const void *payload);
+
+        template <Id E>
+        void invoke(ErasedFn fn, const void *payload)
+        {
+            reinterpret_cast<void (*)(const PayloadOf<E> &)>(fn)(*static_cast<const PayloadOf<E> *>(payload));
+        }
+
+        esp_err_t add_subscriber(std::size_t slot, ErasedFn fn, Invoker invoker);
+        esp_err_t post_raw(Lane lane, Id id, const void *payload, std::size_t size, bool from_isr);
+
+        using Merger = void (*)(void *pending, const void *next);
+
+        template <Id E>
+        void merge(void *pending, const void *next)
+        {
+            merge_payload(*static_cast<PayloadOf<E> *>(pending), *static_cast<const PayloadOf<E> *>(next));
+        }
+
+        esp_err_t post_merged(Lane lane, Id id, const void *payload, std::size_t size, Merger merger, bool from_isr);
+    } // namespace detail
+
+    template <Id E>
+    using Handler = void (*)(const PayloadOf<E> &payload);
+
+    // Run `fn` for every E, in the task of E's lane, after the handlers
+    // subscribed before it.
+    template <Id E>
+    esp_err_t subscribe(Handler<E> fn)
+    {
+        static_assert(slot_of(E) != kNoSlot, "event id missing from kEventIds");
+        return detail::add_subscriber(slot_of(E), reinterpret_cast<detail::ErasedFn>(fn), &detail::invoke<E>);
+    }
+
+    template <Id E>
+    esp_err_t post(const PayloadOf<E> &payload, bool from_isr = false)
+    {
+        constexpr Lane lane = EventTraits<E>::lane;
+        if constexpr (EventTraits<E>::coalesce == Coalesce::Merge)
+        {
+            static_assert(sizeof(payload) <= kMaxMergedPayloadSize, "payload too large to merge");
+            return detail::post_merged(lane, E, &payload, sizeof(payload), &detail::merge<E>, from_isr);
+        }
+        else
+        {
+            return detail::post_raw(lane, E, &payload, sizeof(payload), from_isr);
+        }
+    }
+
+    // Called for every app event after its subscribers (event logger), from
+    // both lanes. `payload` points to the PayloadOf<id>.
+    using MonitorFn = void (*)(Id id, const void *payload);
+    esp_err_t add_monitor(MonitorFn fn);
+
+    // Called for every post, before coalescing, on the posting task (or
+    // ISR) (event trace). One hook; nullptr removes it.
+    using PostHookFn = void (*)(Id id, const void *payload, std::size_t size);
+    void set_post_hook(PostHookFn fn);
+
+    // Start the lane loop tasks. Posts before init() fail with
+    // ESP_ERR_INVALID_STATE.
+    esp_err_t init();
+
+    const char *id_to_string(int32_t id);
+
+    // Clamps to kMaxEntitiesPerChange and sets `overflow`.
+    esp_err_t post_entities_changed(const std::uint16_t *entities, std::size_t count, std::int64_t timestamp_us);
 
 } // namespace app_events
@@ -0,0 +1,188 @@
+#include "bootstrap_csv.hpp"
+
+#include "esp_log.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace state
+{
+
+    namespace
+    {
+
+        constexpr const char *TAG = "bootstrap_csv";
+
+        // Longest line we are willing to carry across chunk boundaries.
+        // Anything longer is certainly not a valid row and is skipped.
+        constexpr std::size_t kMaxLineLength = 512;
+
+        inline bool is_blank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        std::string_view trim(std::string_view s)
+        {
+            std::size_t start = 0;
+            while (start < s.size() && is_blank(s[start]))
+                ++start;
+            std::size_t end = s.size();
+            while (end > start && is_blank(s[end - 1]))
+                --end;
+            return s.substr(start, end - start);
+        }
+
+        // Split into at most fields_out.size() fields; returns the number
+        // found, or 0 if there are too many.
+        std::size_t split_csv_line(std::string_view line, BootstrapCsvParser::Row &fields_out)
+        {
+            fields_out = BootstrapCsvParser::Row{};
+            std::size_t field_idx = 0;
+            std::size_t start = 0;
+            for (std::size_t i = 0; i <= line.size(); ++i)
+            {
+                bool at_end = (i == line.size());
+                if (at_end || line[i] == ',')
+                {
+                    if (field_idx >= fields_out.size())
+                    {
+                        // too many fields
+                        return 0;
+                    }
+                    fields_out[field_idx++] = trim(line.substr(start, i - start));
+                    start = i + 1;
+                }
+            }
+            return field_idx;
+        }
+
+        bool eq_nocase(std::string_view a, const char *b)
+        {
+            std::size_t blen = std::strlen(b);
+            if (a.size() != blen)
+                return false;
+            for (std::size_t i = 0; i < blen; ++i)
+            {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+                    return false;
+            }
+            return true;
+        }
+
+    } // namespace
+
+    BootstrapCsvParser::BootstrapCsvParser(RowHandler handler, void *ctx)
+        : handler_(handler), ctx_(ctx)
+    {
+    }
+
+    void BootstrapCsvParser::feed(const char *data, std::size_t len)
+    {
+        if (!data || len == 0 || failed_)
+            return;
+
+        std::size_t pos = 0;
+
+        // Complete a line started in a previous chunk.
+        if (!carry_.empty())
+        {
+            const void *nl = std::memchr(data, '\n', len);
+            std::size_t take = nl ? static_cast<std::size_t>(static_cast<const char *>(nl) - data) : len;
+            // Overlong lines are clamped to kMaxLineLength and then rejected
+            // by process_line(), so the carry buffer never grows past it.
+            std::size_t room = kMaxLineLength - carry_.size();
+            carry_.append(data, take < room ? take : room);
+            if (!nl)
+                return;
+
+            process_line(carry_);
+            carry_.clear();
+            pos = take + 1;
+        }
+
+        // Lines fully inside this chunk are parsed in place.
+        while (pos < len)
+        {
+            const void *nl = std::memchr(data + pos, '\n', len - pos);
+            if (!nl)
+                break;
+            std::size_t end = static_cast<std::size_t>(static_cast<const char *>(nl) - data);
+            process_line(std::string_view(data + pos, end - pos));
+            pos = end + 1;
+        }
+
+        // Keep the unterminated tail for the next chunk.
+        if (pos < len)
+        {
+            std::size_t tail = len - pos;
+            if (tail > kMaxLineLength)
+                tail = kMaxLineLength;
+            carry_.assign(data + pos, tail);
+        }
+    }
+
+    bool BootstrapCsvParser::finish()
+    {
+        if (!carry_.empty())
+        {
+            process_line(carry_);
+            carry_.clear();
+        }
+        return header_ok_ && !failed_;
+    }
+
+    void BootstrapCsvParser::process_line(std::string_view raw)
+    {
+        ++line_no_;
+        if (failed_)
+            return;
+
+        std::string_view line = trim(raw);
+        if (line.empty())
+            return;
+
+        if (line.size() >= kMaxLineLength)
+        {
+            ESP_LOGW(TAG, "skip overlong line %d", static_cast<int>(line_no_));
+            ++skipped_;
+            return;
+        }
+
+        Row fields;
+        const std::size_t count = split_csv_line(line, fields);
+        if (!header_ok_)
+        {
+            if (count < kRequiredFieldCount ||
+                !eq_nocase(fields[AreaId], "AREA_ID") ||
+                !eq_nocase(fields[AreaName], "AREA_NAME") ||
+                !eq_nocase(fields[EntityId], "ENTITY_ID") ||
+                !eq_nocase(fields[EntityName], "ENTITY_NAME") ||
+                !eq_nocase(fields[State], "STATE") ||
+                (count > Attributes && !eq_nocase(fields[Attributes], "ATTRIBUTES")))
+            {
+                ESP_LOGW(TAG, "unexpected header '%.*s'", static_cast<int>(line.size()), line.data());
+                failed_ = true;
+                return;
+            }
+            field_count_ = count;
+            header_ok_ = true;
+            return;
+        }
+
+        if (count < kRequiredFieldCount || count > field_count_)
+        {
+            ESP_LOGW(TAG, "skip malformed line %d: '%.*s'",
+                     static_cast<int>(line_no_),
+                     static_cast<int>(line.size()),
+                     line.data());
+            ++skipped_;
+            return;
+        }
+
+        ++rows_;
+        if (handler_)
+            handler_(fields, ctx_);
+    }
+
+} // namespace state
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace state
+{
+
+    // Incremental parser for the bootstrap CSV returned by the HA template:
+    //
+    //   AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE[,ATTRIBUTES]
+    //   kitchen,Kitchen,switch.kitchen_light,Kitchen light,off
+    //   kitchen,Kitchen,light.ceiling,Ceiling,on,brightness=128;color_temp=370
+    //   ...
+    //
+    // ATTRIBUTES is optional (older templates do not send it); it is an
+    // empty view in rows without it.
+    //
+    // Input can be fed in arbitrary chunks. Lines that lie completely inside
+    // a chunk are split in place (fields are string_views into the caller's
+    // buffer); only a line crossing a chunk boundary is copied into a small
+    // carry buffer. Row fields are valid only for the duration of the callback.
+    class BootstrapCsvParser
+    {
+    public:
+        static constexpr std::size_t kFieldCount = 6;
+        static constexpr std::size_t kRequiredFieldCount = 5;
+
+        enum Field : std::size_t
+        {
+            AreaId = 0,
+            AreaName = 1,
+            EntityId = 2,
+            EntityName = 3,
+            State = 4,
+            Attributes = 5,
+        };
+
+        using Row = std::array<std::string_view, kFieldCount>;
+        using RowHandler = void (*)(const Row &row, void *ctx);
+
+        BootstrapCsvParser(RowHandler handler, void *ctx);
+
+        // Consume next chunk of input. Safe to call with len == 0.
+        void feed(const char *data, std::size_t len);
+
+        // Flush a trailing line without '\n'. Returns true if a valid header
+        // was seen (the input is a bootstrap CSV at all).
+        bool finish();
+
+        bool header_ok() const { return header_ok_; }
+        bool failed() const { return failed_; }
+        std::size_t rows() const { return rows_; }
+        std::size_t skipped() const { return skipped_; }
+
+    private:
+        void process_line(std::string_view line);
+
+        RowHandler handler_;
+        void *ctx_;
+        std::string carry_;
+        std::size_t field_count_ = kRequiredFieldCount; // columns in the header
+        bool header_ok_ = false;
+        bool failed_ = false;
+        std::size_t line_no_ = 0;
+        std::size_t rows_ = 0;
+        std::size_t skipped_ = 0;
+    };
+
+} // namespace state
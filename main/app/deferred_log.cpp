@@ -0,0 +1,200 @@
+#include "deferred_log.hpp"
+
+#include "app_config.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace deferred_log
+{
+
+    namespace detail
+    {
+        std::atomic<std::uint8_t> g_levels[kModuleCount] = {
+            {ESP_LOG_INFO},
+            {ESP_LOG_INFO},
+            {ESP_LOG_INFO},
+        };
+    } // namespace detail
+
+    namespace
+    {
+        static const char *TAG = "deferred_log";
+
+        // Indexed by Module; the tags the modules used with ESP_LOGx.
+        constexpr const char *kModuleTags[kModuleCount] = {
+            "APP_EVENT_BUS",
+            "router",
+            "http_utils",
+        };
+
+        struct Record
+        {
+            const Site *site;
+            detail::FormatFn format;
+            std::uint32_t time_ms; // esp_log_timestamp() at the call
+            unsigned char data[kMaxArgBytes];
+        };
+
+        // Bounded MPSC ring (Vyukov). Each slot's `turn` says whose move it
+        // is; it is stored relative to the slot index so that the
+        // zero-initialised ring is ready before init():
+        //   turn == pos - i      free for the producer at `pos`
+        //   turn == pos + 1 - i  holds the record written at `pos`
+        struct Slot
+        {
+            std::atomic<std::uint32_t> turn{0};
+            Record record;
+        };
+
+        constexpr std::size_t kSlots = app_config::kDeferredLogSlots;
+        static_assert((kSlots & (kSlots - 1)) == 0, "kDeferredLogSlots must be a power of two");
+
+        static Slot s_ring[kSlots];
+        static std::atomic<std::uint32_t> s_head{0}; // next producer position
+        static std::uint32_t s_tail = 0;             // consumer only
+        static std::atomic<std::uint32_t> s_dropped{0};
+        static TaskHandle_t s_task = nullptr;
+
+        static bool pop(Record &out)
+        {
+            const std::uint32_t i = s_tail & (kSlots - 1);
+            Slot &slot = s_ring[i];
+            if (slot.turn.load(std::memory_order_acquire) != s_tail + 1 - i)
+                return false;
+            out = slot.record;
+            slot.turn.store(s_tail + kSlots - i, std::memory_order_release);
+            ++s_tail;
+            return true;
+        }
+
+        static char level_letter(esp_log_level_t level)
+        {
+            switch (level)
+            {
+            case ESP_LOG_ERROR:
+                return 'E';
+            case ESP_LOG_WARN:
+                return 'W';
+            case ESP_LOG_INFO:
+                return 'I';
+            case ESP_LOG_DEBUG:
+                return 'D';
+            default:
+                return 'V';
+            }
+        }
+
+        static void drain_task(void * /*arg*/)
+        {
+            Record rec;
+            char line[app_config::kDeferredLogLineLength];
+            std::uint32_t reported_drops = 0;
+            for (;;)
+            {
+                while (pop(rec))
+                {
+                    const Site &site = *rec.site;
+                    const char *tag = kModuleTags[static_cast<std::size_t>(site.module)];
+                    (void)rec.format(line, sizeof(line), site.fmt, rec.data);
+                    // Same layout as ESP_LOGx, with the time of the call.
+                    esp_log_write(site.level, tag, "%c (%lu) %s: %s\n",
+                                  level_letter(site.level),
+                                  static_cast<unsigned long>(rec.time_ms),
+                                  tag,
+                                  line);
+                }
+
+                const std::uint32_t drops = s_dropped.load(std::memory_order_relaxed);
+                if (drops != reported_drops)
+                {
+                    ESP_LOGW(TAG, "%lu records dropped (ring full)", static_cast<unsigned long>(drops - reported_drops));
+                    reported_drops = drops;
+                }
+
+                vTaskDelay(pdMS_TO_TICKS(app_config::kDeferredLogFlushMs));
+            }
+        }
+
+    } // namespace
+
+    namespace detail
+    {
+
+        unsigned char *begin(const Site &site, FormatFn format, std::uint32_t &ticket)
+        {
+            std::uint32_t pos = s_head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                const std::uint32_t i = pos & (kSlots - 1);
+                Slot &slot = s_ring[i];
+                const std::int32_t diff = static_cast<std::int32_t>(slot.turn.load(std::memory_order_acquire) - (pos - i));
+                if (diff == 0)
+                {
+                    if (s_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        slot.record.site = &site;
+                        slot.record.format = format;
+                        slot.record.time_ms = esp_log_timestamp();
+                        ticket = pos;
+                        return slot.record.data;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    // The consumer has not freed this slot yet: full.
+                    s_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                else
+                {
+                    pos = s_head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void commit(std::uint32_t ticket)
+        {
+            const std::uint32_t i = ticket & (kSlots - 1);
+            s_ring[i].turn.store(ticket + 1 - i, std::memory_order_release);
+        }
+
+    } // namespace detail
+
+    esp_err_t init()
+    {
+        if (s_task)
+        {
+            return ESP_OK;
+        }
+
+        const BaseType_t ok = xTaskCreate(&drain_task,
+                                          "dlog",
+                                          app_config::kDeferredLogTaskStack,
+                                          nullptr,
+                                          app_config::kDeferredLogTaskPriority,
+                                          &s_task);
+        if (ok != pdPASS)
+        {
+            s_task = nullptr;
+            ESP_LOGE(TAG, "failed to start formatter task");
+            return ESP_ERR_NO_MEM;
+        }
+        return ESP_OK;
+    }
+
+    void set_level(Module module, esp_log_level_t level)
+    {
+        detail::g_levels[static_cast<std::size_t>(module)].store(static_cast<std::uint8_t>(level), std::memory_order_relaxed);
+    }
+
+    esp_log_level_t get_level(Module module)
+    {
+        return static_cast<esp_log_level_t>(detail::g_levels[static_cast<std::size_t>(module)].load(std::memory_order_relaxed));
+    }
+
+    std::uint32_t dropped()
+    {
+        return s_dropped.load(std::memory_order_relaxed);
+    }
+
+} // namespace deferred_log
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Deferred logging for hot paths (event dispatch, MQTT RX, HTTP). DLOGx()
+// copies the format site and the raw arguments into a lock-free ring; a
+// low-priority task formats them and writes them through esp_log. The
+// caller never waits for the UART. When the ring is full the record is
+// dropped and counted.
+//
+// Arguments are numbers or strings (const char *, std::string_view).
+// Strings are copied; if they do not all fit, each takes what the
+// arguments after it leave and the rest is cut.
+namespace deferred_log
+{
+
+    // Each module has a tag and a runtime level.
+    enum class Module : std::uint8_t
+    {
+        Events,
+        Router,
+        Http,
+        Count,
+    };
+    constexpr std::size_t kModuleCount = static_cast<std::size_t>(Module::Count);
+
+    // Starts the formatter task. Records written before are kept (up to
+    // the ring size) and printed once it runs.
+    esp_err_t init();
+
+    void set_level(Module module, esp_log_level_t level);
+    esp_log_level_t get_level(Module module);
+
+    // Records lost because the ring was full.
+    std::uint32_t dropped();
+
+    // One call site: everything about a record that is known at compile
+    // time.
+    struct Site
+    {
+        Module module;
+        esp_log_level_t level;
+        const char *fmt;
+    };
+
+    // Argument bytes per record (strings: one length byte plus the text).
+    constexpr std::size_t kMaxArgBytes = 80;
+
+    namespace detail
+    {
+        extern std::atomic<std::uint8_t> g_levels[kModuleCount];
+
+        struct Writer
+        {
+            unsigned char *data;
+            std::size_t used = 0;
+            // Minimum size of the arguments not written yet.
+            std::size_t reserved = 0;
+
+            void put(const void *p, std::size_t n)
+            {
+                std::memcpy(data + used, p, n);
+                used += n;
+            }
+        };
+
+        struct Reader
+        {
+            const unsigned char *data;
+            std::size_t pos = 0;
+            // Strings are rebuilt here with their terminator.
+            char text[kMaxArgBytes + 1];
+            std::size_t text_used = 0;
+
+            void get(void *p, std::size_t n)
+            {
+                std::memcpy(p, data + pos, n);
+                pos += n;
+            }
+        };
+
+        template <typename T>
+        struct Arg
+        {
+            static_assert(std::is_arithmetic_v<T>, "deferred_log: only numbers and strings can be logged");
+            using Decoded = T;
+
+            static constexpr std::size_t kMinSize = sizeof(T);
+
+            static void encode(Writer &w, T v)
+            {
+                w.reserved -= sizeof(v);
+                w.put(&v, sizeof(v));
+            }
+
+            static T decode(Reader &r)
+            {
+                T v;
+                r.get(&v, sizeof(v));
+                return v;
+            }
+        };
+
+        template <>
+        struct Arg<std::string_view>
+        {
+            using Decoded = const char *;
+
+            static constexpr std::size_t kMinSize = 1;
+
+            static void encode(Writer &w, std::string_view s)
+            {
+                w.reserved -= 1;
+                // What is left after this length byte and the later
+                // arguments' minimum.
+                const std::size_t room = kMaxArgBytes - w.used - w.reserved - 1;
+                const std::uint8_t n = static_cast<std::uint8_t>(s.size() < room ? s.size() : room);
+                w.put(&n, 1);
+                w.put(s.data(), n);
+            }
+
+            static const char *decode(Reader &r)
+            {
+                std::uint8_t n = 0;
+                r.get(&n, 1);
+                char *out = r.text + r.text_used;
+                r.get(out, n);
+                out[n] = '\0';
+                r.text_used += n + 1;
+                return out;
+            }
+        };
+
+        template <>
+        struct Arg<const char *> : Arg<std::string_view>
+        {
+            static void encode(Writer &w, const char *s)
+            {
+                Arg<std::string_view>::encode(w, s ? std::string_view(s) : std::string_view("(null)"));
+            }
+        };
+
+        template <>
+        struct Arg<char *> : Arg<const char *>
+        {
+        };
+
+        template <typename T>
+        using ArgOf = Arg<std::decay_t<T>>;
+
+        using FormatFn = int (*)(char *out, std::size_t cap, const char *fmt, const unsigned char *data);
+
+        template <typename... A>
+        int format_record(char *out, std::size_t cap, const char *fmt, const unsigned char *data)
+        {
+            if constexpr (sizeof...(A) == 0)
+            {
+                return std::snprintf(out, cap, "%s", fmt);
+            }
+            else
+            {
+                Reader r{data};
+                // Braced initialisation decodes left to right.
+                std::tuple<typename ArgOf<A>::Decoded...> args{ArgOf<A>::decode(r)...};
+                return std::apply([&](auto... a)
+                                  { return std::snprintf(out, cap, fmt, a...); },
+                                  args);
+            }
+        }
+
+        // Claims a ring slot; nullptr (and a drop) if the ring is full.
+        unsigned char *begin(const Site &site, FormatFn format, std::uint32_t &ticket);
+        void commit(std::uint32_t ticket);
+
+        template <typename... A>
+        void write(const Site &site, const A &...args)
+        {
+            constexpr std::size_t min_size = (std::size_t{0} + ... + ArgOf<A>::kMinSize);
+            static_assert(min_size <= kMaxArgBytes, "deferred_log: too many arguments");
+
+            std::uint32_t ticket = 0;
+            unsigned char *data = begin(site, &format_record<A...>, ticket);
+            if (!data)
+                return;
+            if constexpr (sizeof...(A) > 0)
+            {
+                Writer w{data, 0, min_size};
+                (ArgOf<A>::encode(w, args), ...);
+            }
+            commit(ticket);
+        }
+
+    } // namespace detail
+
+    inline bool enabled(Module module, esp_log_level_t level)
+    {
+        return level <= detail::g_levels[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+    }
+
+} // namespace deferred_log
+
+#define DLOG_LEVEL(level_, module_, fmt_, ...)                                       \
+    do                                                                               \
+    {                                                                                \
+        if (::deferred_log::enabled(module_, level_))                                \
+        {                                                                            \
+            static constexpr ::deferred_log::Site dlog_site_{module_, level_, fmt_}; \
+            ::deferred_log::detail::write(dlog_site_, ##__VA_ARGS__);                \
+        }                                                                            \
+    } while (0)
+
+#define DLOGE(module_, fmt_, ...) DLOG_LEVEL(ESP_LOG_ERROR, module_, fmt_, ##__VA_ARGS__)
+#define DLOGW(module_, fmt_, ...) DLOG_LEVEL(ESP_LOG_WARN, module_, fmt_, ##__VA_ARGS__)
+#define DLOGI(module_, fmt_, ...) DLOG_LEVEL(ESP_LOG_INFO, module_, fmt_, ##__VA_ARGS__)
+#define DLOGD(module_, fmt_, ...) DLOG_LEVEL(ESP_LOG_DEBUG, module_, fmt_, ##__VA_ARGS__)
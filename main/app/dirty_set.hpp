@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace state
+{
+
+    // Fixed-size atomic bitmap of "changed since last drain" flags, one bit
+    // per entity handle. mark() is wait-free and may be called from any
+    // task; drain() atomically takes and clears one 32-bit word at a time,
+    // so a mark racing with a drain is either seen now or on the next pass.
+    class DirtySet
+    {
+    public:
+        void init(std::size_t bits)
+        {
+            words_count_ = (bits + 31) / 32;
+            words_.reset(words_count_ ? new std::atomic<std::uint32_t>[words_count_] : nullptr);
+            for (std::size_t i = 0; i < words_count_; ++i)
+                words_[i].store(0, std::memory_order_relaxed);
+        }
+
+        void mark(std::size_t bit) const
+        {
+            const std::size_t w = bit / 32;
+            if (w < words_count_)
+                words_[w].fetch_or(1u << (bit % 32), std::memory_order_release);
+        }
+
+        // Calls fn(index) for every set bit and clears it. Returns the
+        // number of bits visited.
+        template <typename Fn>
+        std::size_t drain(Fn &&fn) const
+        {
+            std::size_t visited = 0;
+            for (std::size_t w = 0; w < words_count_; ++w)
+            {
+                if (words_[w].load(std::memory_order_relaxed) == 0)
+                    continue;
+                std::uint32_t bits = words_[w].exchange(0, std::memory_order_acquire);
+                while (bits)
+                {
+                    const unsigned b = static_cast<unsigned>(__builtin_ctz(bits));
+                    bits &= bits - 1;
+                    fn(w * 32 + b);
+                    ++visited;
+                }
+            }
+            return visited;
+        }
+
+    private:
+        std::unique_ptr<std::atomic<std::uint32_t>[]> words_;
+        std::size_t words_count_ = 0;
+    };
+
+} // namespace state
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "entity_domain.hpp"
+#include "entity_state.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+namespace state
+{
+
+    // Compact entity handle assigned at bootstrap: dense index into the
+    // model's entity list. Events, listeners and UI widgets refer to
+    // entities by handle; the string id is only needed at the MQTT/HTTP
+    // boundary.
+    using EntityHandle = std::uint16_t;
+    constexpr EntityHandle kInvalidEntity = 0xFFFF;
+
+    // Ids and names are views into the bootstrap string arena: each distinct
+    // string is stored once and shared by state, router and UI. The views are
+    // NUL-terminated and stay valid as long as the model holding them.
+    struct Area
+    {
+        std::string_view id;
+        std::string_view name;
+    };
+
+    struct Entity
+    {
+        EntityHandle handle = kInvalidEntity;
+        std::string_view id;
+        std::string_view name;
+        EntityDomain domain = EntityDomain::Unknown;
+        // The only part of a published model that changes; updated in place
+        // by apply_entity_updates().
+        mutable AtomicEntityState state;
+        std::string_view area_id;
+        // Range of this entity's slots in Model::attrs, sorted by key.
+        std::uint32_t attr_begin = 0;
+        std::uint8_t attr_count = 0;
+        // Tombstone: the entity disappeared in a later bootstrap. Its slot
+        // is kept so handles held elsewhere never point at another entity.
+        bool removed = false;
+    };
+
+} // namespace state
@@ -0,0 +1,82 @@
+#include "entity_attributes.hpp"
+
+#include <cstdlib>
+
+namespace state
+{
+
+    namespace
+    {
+
+        constexpr const char *kKeyNames[] = {
+            "brightness",
+            "color_temp",
+            "temperature",
+            "current_temperature",
+            "current_position",
+        };
+        static_assert(sizeof(kKeyNames) / sizeof(kKeyNames[0]) == static_cast<size_t>(AttrKey::Count),
+                      "kKeyNames out of sync with AttrKey");
+
+        bool parse_float(std::string_view text, float &out)
+        {
+            char buf[24];
+            if (text.empty() || text.size() >= sizeof(buf))
+                return false;
+            std::memcpy(buf, text.data(), text.size());
+            buf[text.size()] = '\0';
+
+            char *end = nullptr;
+            const float v = std::strtof(buf, &end);
+            if (end == buf || *end != '\0')
+                return false;
+            out = v;
+            return true;
+        }
+
+    } // namespace
+
+    const char *attr_key_name(AttrKey key)
+    {
+        const size_t i = static_cast<size_t>(key);
+        return i < static_cast<size_t>(AttrKey::Count) ? kKeyNames[i] : "?";
+    }
+
+    bool parse_attr_key(std::string_view name, AttrKey &out)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(AttrKey::Count); ++i)
+        {
+            if (name == kKeyNames[i])
+            {
+                out = static_cast<AttrKey>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool next_attribute(std::string_view &text, AttrKey &key, float &value)
+    {
+        while (!text.empty())
+        {
+            const size_t sep = text.find(';');
+            std::string_view pair = text.substr(0, sep);
+            text = (sep == std::string_view::npos) ? std::string_view() : text.substr(sep + 1);
+
+            const size_t eq = pair.find('=');
+            if (eq == std::string_view::npos)
+                continue;
+            std::string_view name = pair.substr(0, eq);
+            std::string_view val = pair.substr(eq + 1);
+            while (!name.empty() && name.front() == ' ')
+                name.remove_prefix(1);
+            while (!val.empty() && val.back() == ' ')
+                val.remove_suffix(1);
+
+            if (parse_attr_key(name, key) && parse_float(val, value))
+                return true;
+        }
+        return false;
+    }
+
+} // namespace state
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace state
+{
+
+    // Fixed vocabulary of the HA attributes the panel understands. All of
+    // them are numeric, in HA units (brightness 0..255, mireds, degrees,
+    // percent). The key id is what the attribute pool stores; names are
+    // only used when parsing.
+    enum class AttrKey : std::uint8_t
+    {
+        Brightness = 0,     // "brightness"
+        ColorTemp,          // "color_temp"
+        TargetTemperature,  // "temperature"
+        CurrentTemperature, // "current_temperature"
+        Position,           // "current_position"
+        Count,
+    };
+
+    const char *attr_key_name(AttrKey key);
+    bool parse_attr_key(std::string_view name, AttrKey &out);
+
+    // Bitmask of keys, bit = key id.
+    using AttrMask = std::uint32_t;
+    static_assert(static_cast<unsigned>(AttrKey::Count) <= 32, "AttrMask too small");
+
+    constexpr AttrMask attr_bit(AttrKey key)
+    {
+        return AttrMask{1} << static_cast<unsigned>(key);
+    }
+
+    // Read the next "key=value" pair of an attribute list such as
+    // "brightness=128;color_temp=370" and advance `text` past it. Unknown
+    // keys and non-numeric values are skipped. Returns false at the end.
+    bool next_attribute(std::string_view &text, AttrKey &key, float &value);
+
+    // One entry of a model's attribute pool. The value is atomic like
+    // AtomicEntityState, so MQTT updates land in the published model while
+    // other tasks read it; NaN means "not reported yet". Stores must be
+    // serialized by the caller (state_manager's writer lock).
+    class AttrSlot
+    {
+    public:
+        AttrSlot() = default;
+        AttrSlot(AttrKey key, float value) : key_(key), bits_(to_bits(value)) {}
+        AttrSlot(const AttrSlot &o) : key_(o.key_), bits_(o.bits_.load(std::memory_order_relaxed)) {}
+        AttrSlot &operator=(const AttrSlot &o)
+        {
+            key_ = o.key_;
+            bits_.store(o.bits_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        AttrKey key() const { return key_; }
+        float load() const { return from_bits(bits_.load(std::memory_order_acquire)); }
+        void store(float v) const { bits_.store(to_bits(v), std::memory_order_release); }
+        bool has_value() const { return !std::isnan(load()); }
+
+    private:
+        static std::uint32_t to_bits(float v)
+        {
+            std::uint32_t b = 0;
+            std::memcpy(&b, &v, sizeof(b));
+            return b;
+        }
+        static float from_bits(std::uint32_t b)
+        {
+            float v = 0.0f;
+            std::memcpy(&v, &b, sizeof(v));
+            return v;
+        }
+
+        AttrKey key_ = AttrKey::Count;
+        mutable std::atomic<std::uint32_t> bits_{0x7FC00000}; // quiet NaN
+    };
+
+} // namespace state
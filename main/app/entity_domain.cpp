@@ -0,0 +1,21 @@
+#include "entity_domain.hpp"
+
+namespace state
+{
+
+    EntityDomain parse_entity_domain(std::string_view entity_id)
+    {
+        const size_t dot = entity_id.find('.');
+        if (dot == std::string_view::npos || dot == 0)
+            return EntityDomain::Unknown;
+
+        const std::string_view name = entity_id.substr(0, dot);
+        for (size_t i = 1; i < kDomainCount; ++i)
+        {
+            if (name == kDomainTraits[i].name)
+                return kDomainTraits[i].domain;
+        }
+        return EntityDomain::Unknown;
+    }
+
+} // namespace state
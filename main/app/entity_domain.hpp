@@ -0,0 +1,95 @@
+#pragma once
+
+#include "entity_attributes.hpp"
+#include "entity_state.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace state
+{
+
+    // HA domain of an entity (the part of the id before the dot),
+    // classified once when the entity enters a model. Everything that
+    // depends on what an entity is (state parsing, widget, command) reads
+    // kDomainTraits instead of looking at the id again.
+    enum class EntityDomain : std::uint8_t
+    {
+        Unknown = 0,
+        Light,
+        Switch,
+        InputBoolean,
+        Sensor,
+        BinarySensor,
+        Cover,
+        Climate,
+        Count,
+    };
+
+    // Widget a room page builds for an entity.
+    enum class DomainWidget : std::uint8_t
+    {
+        Switch,  // on/off control
+        Readout, // read-only value label
+    };
+
+    // What a user action on the widget sends to HA.
+    enum class DomainCommand : std::uint8_t
+    {
+        None,
+        Toggle,
+    };
+
+    struct DomainTraits
+    {
+        EntityDomain domain;
+        const char *name; // HA domain, without the dot
+        StateShape shape;
+        DomainWidget widget;
+        DomainCommand command;
+        AttrMask default_attrs; // attribute slots every entity of the domain gets
+    };
+
+    // Indexed by EntityDomain.
+    constexpr DomainTraits kDomainTraits[] = {
+        {EntityDomain::Unknown, "", StateShape::Any, DomainWidget::Readout, DomainCommand::None, 0},
+        {EntityDomain::Light, "light", StateShape::Binary, DomainWidget::Switch, DomainCommand::Toggle,
+         attr_bit(AttrKey::Brightness) | attr_bit(AttrKey::ColorTemp)},
+        {EntityDomain::Switch, "switch", StateShape::Binary, DomainWidget::Switch, DomainCommand::Toggle, 0},
+        {EntityDomain::InputBoolean, "input_boolean", StateShape::Binary, DomainWidget::Switch, DomainCommand::Toggle, 0},
+        {EntityDomain::Sensor, "sensor", StateShape::Numeric, DomainWidget::Readout, DomainCommand::None, 0},
+        {EntityDomain::BinarySensor, "binary_sensor", StateShape::Binary, DomainWidget::Readout, DomainCommand::None, 0},
+        // Switch shows open/opening as "on"; toggle opens or closes.
+        {EntityDomain::Cover, "cover", StateShape::Mode, DomainWidget::Switch, DomainCommand::Toggle,
+         attr_bit(AttrKey::Position)},
+        {EntityDomain::Climate, "climate", StateShape::Mode, DomainWidget::Readout, DomainCommand::None,
+         attr_bit(AttrKey::TargetTemperature) | attr_bit(AttrKey::CurrentTemperature)},
+    };
+
+    constexpr std::size_t kDomainCount = static_cast<std::size_t>(EntityDomain::Count);
+    static_assert(sizeof(kDomainTraits) / sizeof(kDomainTraits[0]) == kDomainCount,
+                  "kDomainTraits out of sync with EntityDomain");
+
+    constexpr bool domain_traits_in_order()
+    {
+        for (std::size_t i = 0; i < kDomainCount; ++i)
+        {
+            if (static_cast<std::size_t>(kDomainTraits[i].domain) != i)
+                return false;
+        }
+        return true;
+    }
+    static_assert(domain_traits_in_order(), "kDomainTraits must be indexed by EntityDomain");
+
+    constexpr const DomainTraits &domain_traits(EntityDomain domain)
+    {
+        const std::size_t i = static_cast<std::size_t>(domain);
+        return kDomainTraits[i < kDomainCount ? i : 0];
+    }
+
+    // Domain of an HA entity id ("light.kitchen" -> Light); Unknown for
+    // domains the panel does not handle.
+    EntityDomain parse_entity_domain(std::string_view entity_id);
+
+} // namespace state
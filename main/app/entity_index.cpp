@@ -0,0 +1,128 @@
+#include "entity_index.hpp"
+
+#include "string_arena.hpp"
+
+#include "esp_heap_caps.h"
+
+#include <utility>
+
+namespace state
+{
+
+    namespace
+    {
+        inline std::uint16_t tag_of(std::uint32_t h)
+        {
+            return static_cast<std::uint16_t>(h >> 16);
+        }
+    } // namespace
+
+    EntityIndex::~EntityIndex()
+    {
+        clear();
+    }
+
+    EntityIndex::EntityIndex(EntityIndex &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    EntityIndex &EntityIndex::operator=(EntityIndex &&other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            slots_ = std::exchange(other.slots_, nullptr);
+            cap_ = std::exchange(other.cap_, 0);
+            entities_ = std::exchange(other.entities_, nullptr);
+            max_probe_ = std::exchange(other.max_probe_, 0);
+            avg_probe_ = std::exchange(other.avg_probe_, 0.0f);
+        }
+        return *this;
+    }
+
+    void EntityIndex::clear()
+    {
+        if (slots_)
+        {
+            heap_caps_free(slots_);
+            slots_ = nullptr;
+        }
+        cap_ = 0;
+        entities_ = nullptr;
+        max_probe_ = 0;
+        avg_probe_ = 0.0f;
+    }
+
+    bool EntityIndex::build(const Entity *entities, std::size_t count)
+    {
+        clear();
+        if (!entities || count == 0)
+            return true;
+
+        std::size_t cap = 16;
+        while (cap < count * 2)
+            cap <<= 1;
+
+        // Lookups run on every MQTT message; keep the table in internal RAM.
+        auto *slots = static_cast<Slot *>(heap_caps_malloc(cap * sizeof(Slot), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        if (!slots)
+            slots = static_cast<Slot *>(heap_caps_malloc(cap * sizeof(Slot), MALLOC_CAP_8BIT));
+        if (!slots)
+            return false;
+
+        for (std::size_t i = 0; i < cap; ++i)
+        {
+            slots[i].tag = 0;
+            slots[i].handle = kInvalidEntity;
+        }
+
+        std::size_t total_probe = 0;
+        std::size_t max_probe = 0;
+        std::size_t indexed = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (entities[i].removed)
+                continue;
+            ++indexed;
+            const std::uint32_t h = hash_fnv1a(entities[i].id);
+            std::size_t slot = h & (cap - 1);
+            std::size_t probe = 1;
+            while (slots[slot].handle != kInvalidEntity)
+            {
+                slot = (slot + 1) & (cap - 1);
+                ++probe;
+            }
+            slots[slot].tag = tag_of(h);
+            slots[slot].handle = static_cast<EntityHandle>(i);
+            total_probe += probe;
+            if (probe > max_probe)
+                max_probe = probe;
+        }
+
+        slots_ = slots;
+        cap_ = cap;
+        entities_ = entities;
+        max_probe_ = max_probe;
+        avg_probe_ = indexed ? static_cast<float>(total_probe) / static_cast<float>(indexed) : 0.0f;
+        return true;
+    }
+
+    EntityHandle EntityIndex::find(std::string_view id) const
+    {
+        if (!slots_)
+            return kInvalidEntity;
+
+        const std::uint32_t h = hash_fnv1a(id);
+        const std::uint16_t tag = tag_of(h);
+        std::size_t slot = h & (cap_ - 1);
+        while (slots_[slot].handle != kInvalidEntity)
+        {
+            if (slots_[slot].tag == tag && entities_[slots_[slot].handle].id == id)
+                return slots_[slot].handle;
+            slot = (slot + 1) & (cap_ - 1);
+        }
+        return kInvalidEntity;
+    }
+
+} // namespace state
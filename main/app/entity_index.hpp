@@ -0,0 +1,59 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace state
+{
+
+    // Immutable id -> handle index, built once per bootstrap.
+    //
+    // Open addressing with linear probing over a single contiguous array.
+    // Each slot holds the 16-bit handle plus the upper bits of the id hash,
+    // so most mismatching probes are rejected without touching the id bytes.
+    // The table is sized to a load factor <= 0.5; after build() it is
+    // read-only and find() needs no locking.
+    class EntityIndex
+    {
+    public:
+        EntityIndex() = default;
+        ~EntityIndex();
+
+        EntityIndex(const EntityIndex &) = delete;
+        EntityIndex &operator=(const EntityIndex &) = delete;
+        EntityIndex(EntityIndex &&other) noexcept;
+        EntityIndex &operator=(EntityIndex &&other) noexcept;
+
+        // Index `count` entities; entity i must have handle i. Removed
+        // (tombstoned) entities are not indexed. The entity array must
+        // outlive the index (it is not copied).
+        bool build(const Entity *entities, std::size_t count);
+
+        EntityHandle find(std::string_view id) const;
+
+        void clear();
+
+        std::size_t capacity() const { return cap_; }
+        std::size_t bytes() const { return cap_ * sizeof(Slot); }
+        // Longest probe sequence seen during build (1 = direct hit).
+        std::size_t max_probe() const { return max_probe_; }
+        float avg_probe() const { return avg_probe_; }
+
+    private:
+        struct Slot
+        {
+            std::uint16_t tag;
+            EntityHandle handle;
+        };
+
+        Slot *slots_ = nullptr;
+        std::size_t cap_ = 0;
+        const Entity *entities_ = nullptr;
+        std::size_t max_probe_ = 0;
+        float avg_probe_ = 0.0f;
+    };
+
+} // namespace state
@@ -0,0 +1,139 @@
+#include "entity_state.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace state
+{
+
+    namespace
+    {
+
+        constexpr std::uint8_t shape_bit(StateShape shape)
+        {
+            return static_cast<std::uint8_t>(1u << static_cast<unsigned>(shape));
+        }
+
+        constexpr std::uint8_t kAnyShape = 0xFF;
+        constexpr std::uint8_t kBinary = shape_bit(StateShape::Any) | shape_bit(StateShape::Binary);
+        constexpr std::uint8_t kMode = shape_bit(StateShape::Any) | shape_bit(StateShape::Mode);
+
+        struct Keyword
+        {
+            const char *text;
+            StateKind kind;
+            StateMode mode;
+            std::uint8_t shapes; // shape_bit() of the shapes it is valid for
+        };
+
+        // Matched case-insensitively. "true"/"1" are what some integrations
+        // report for binary entities.
+        constexpr Keyword kKeywords[] = {
+            {"on", StateKind::On, StateMode::None, kBinary},
+            {"off", StateKind::Off, StateMode::None, kBinary | kMode},
+            {"true", StateKind::On, StateMode::None, kBinary},
+            {"false", StateKind::Off, StateMode::None, kBinary},
+            {"unavailable", StateKind::Unavailable, StateMode::None, kAnyShape},
+            {"unknown", StateKind::Unknown, StateMode::None, kAnyShape},
+            {"heat", StateKind::Mode, StateMode::Heat, kMode},
+            {"cool", StateKind::Mode, StateMode::Cool, kMode},
+            {"heat_cool", StateKind::Mode, StateMode::HeatCool, kMode},
+            {"auto", StateKind::Mode, StateMode::Auto, kMode},
+            {"dry", StateKind::Mode, StateMode::Dry, kMode},
+            {"fan_only", StateKind::Mode, StateMode::FanOnly, kMode},
+            {"open", StateKind::Mode, StateMode::Open, kMode},
+            {"opening", StateKind::Mode, StateMode::Opening, kMode},
+            {"closed", StateKind::Mode, StateMode::Closed, kMode},
+            {"closing", StateKind::Mode, StateMode::Closing, kMode},
+        };
+
+        bool eq_nocase(std::string_view a, const char *b)
+        {
+            std::size_t blen = std::strlen(b);
+            if (a.size() != blen)
+                return false;
+            for (std::size_t i = 0; i < blen; ++i)
+            {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != b[i])
+                    return false;
+            }
+            return true;
+        }
+
+        bool parse_number(std::string_view text, float &out)
+        {
+            // Numeric states are short; anything longer is not a number.
+            char buf[32];
+            if (text.empty() || text.size() >= sizeof(buf))
+                return false;
+            std::memcpy(buf, text.data(), text.size());
+            buf[text.size()] = '\0';
+
+            char *end = nullptr;
+            float v = std::strtof(buf, &end);
+            if (end == buf || *end != '\0')
+                return false;
+            out = v;
+            return true;
+        }
+
+    } // namespace
+
+    EntityState parse_entity_state(std::string_view text, StateShape shape)
+    {
+        EntityState s;
+
+        for (const Keyword &k : kKeywords)
+        {
+            if ((k.shapes & shape_bit(shape)) && eq_nocase(text, k.text))
+            {
+                s.kind = k.kind;
+                s.mode = k.mode;
+                return s;
+            }
+        }
+
+        // Binary entities reporting 1/0 stay binary; for a sensor 1 is a
+        // number.
+        if (shape != StateShape::Numeric && shape != StateShape::Mode && (text == "1" || text == "0"))
+        {
+            s.kind = (text == "1") ? StateKind::On : StateKind::Off;
+            return s;
+        }
+
+        float v = 0.0f;
+        if ((shape == StateShape::Any || shape == StateShape::Numeric) && parse_number(text, v))
+        {
+            s.kind = StateKind::Numeric;
+            s.value = v;
+        }
+        return s;
+    }
+
+    const char *entity_state_name(const EntityState &s)
+    {
+        switch (s.kind)
+        {
+        case StateKind::Unavailable:
+            return "unavailable";
+        case StateKind::Off:
+            return "off";
+        case StateKind::On:
+            return "on";
+        case StateKind::Numeric:
+            return "numeric";
+        case StateKind::Mode:
+            for (const Keyword &k : kKeywords)
+            {
+                if (k.kind == StateKind::Mode && k.mode == s.mode)
+                    return k.text;
+            }
+            return "mode";
+        case StateKind::Unknown:
+        default:
+            return "unknown";
+        }
+    }
+
+} // namespace state
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace state
+{
+
+    // Entity state as received from HA, parsed once on arrival.
+    //
+    // Binary entities (light/switch/input_boolean) are the common case and
+    // need nothing beyond `kind`. Numeric sensors keep their value in
+    // `value`; climate and cover states map to `mode`. Anything else is
+    // Unknown. Comparing two states is a couple of integer compares, no
+    // heap string is kept per entity.
+    enum class StateKind : std::uint8_t
+    {
+        Unknown = 0,
+        Unavailable,
+        Off,
+        On,
+        Numeric,
+        Mode,
+    };
+
+    enum class StateMode : std::uint8_t
+    {
+        None = 0,
+        // climate hvac modes
+        Heat,
+        Cool,
+        HeatCool,
+        Auto,
+        Dry,
+        FanOnly,
+        // cover states
+        Open,
+        Opening,
+        Closed,
+        Closing,
+    };
+
+    // What an entity's state text can mean, from its domain. Keywords
+    // and numbers outside the shape parse as Unknown; Any accepts all.
+    enum class StateShape : std::uint8_t
+    {
+        Any = 0,
+        Binary,  // on/off (1/0, true/false)
+        Numeric, // a number, 0 and 1 included
+        Mode,    // hvac or cover keywords; "off" for climate
+    };
+
+    struct EntityState
+    {
+        StateKind kind = StateKind::Unknown;
+        StateMode mode = StateMode::None;
+        float value = 0.0f;
+
+        bool is_on() const { return kind == StateKind::On; }
+
+        // "On" for a switch widget: on, an hvac mode, or a cover that is
+        // open or opening.
+        bool is_active() const
+        {
+            if (kind == StateKind::Mode)
+                return mode != StateMode::Closed && mode != StateMode::Closing;
+            return kind == StateKind::On;
+        }
+
+        bool operator==(const EntityState &o) const
+        {
+            return kind == o.kind && mode == o.mode && value == o.value;
+        }
+        bool operator!=(const EntityState &o) const { return !(*this == o); }
+    };
+
+    // EntityState packed into one 64-bit atomic so readers on other tasks
+    // see either the old or the new state, never a mix. Copyable (by value)
+    // so entities can live in a std::vector.
+    //
+    // The spare bits hold a 16-bit generation bumped by every store(), so
+    // a reader can tell whether it has already seen the current value.
+    // Stores must be serialized by the caller (state_manager's writer lock).
+    class AtomicEntityState
+    {
+    public:
+        AtomicEntityState() = default;
+        AtomicEntityState(const EntityState &s) : bits_(pack(s)) {}
+        AtomicEntityState(const AtomicEntityState &o) : bits_(o.bits_.load(std::memory_order_relaxed)) {}
+        AtomicEntityState &operator=(const AtomicEntityState &o)
+        {
+            bits_.store(o.bits_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        EntityState load() const { return unpack(bits_.load(std::memory_order_acquire)); }
+        EntityState load(std::uint16_t &generation) const
+        {
+            const std::uint64_t bits = bits_.load(std::memory_order_acquire);
+            generation = static_cast<std::uint16_t>(bits >> 16);
+            return unpack(bits);
+        }
+        std::uint16_t generation() const
+        {
+            return static_cast<std::uint16_t>(bits_.load(std::memory_order_acquire) >> 16);
+        }
+
+        void store(const EntityState &s)
+        {
+            const std::uint64_t gen = ((bits_.load(std::memory_order_relaxed) >> 16) + 1) & 0xFFFF;
+            bits_.store(pack(s) | (gen << 16), std::memory_order_release);
+        }
+
+        bool is_on() const { return load().is_on(); }
+
+    private:
+        static std::uint64_t pack(const EntityState &s)
+        {
+            std::uint32_t v = 0;
+            std::memcpy(&v, &s.value, sizeof(v));
+            return static_cast<std::uint64_t>(s.kind) |
+                   (static_cast<std::uint64_t>(s.mode) << 8) |
+                   (static_cast<std::uint64_t>(v) << 32);
+        }
+
+        static EntityState unpack(std::uint64_t bits)
+        {
+            EntityState s;
+            s.kind = static_cast<StateKind>(bits & 0xFF);
+            s.mode = static_cast<StateMode>((bits >> 8) & 0xFF);
+            const std::uint32_t v = static_cast<std::uint32_t>(bits >> 32);
+            std::memcpy(&s.value, &v, sizeof(v));
+            return s;
+        }
+
+        std::atomic<std::uint64_t> bits_{0};
+    };
+
+    // Parse an HA state string ("on", "off", "unavailable", "21.5", "heat", ...)
+    // as a state of the given shape.
+    EntityState parse_entity_state(std::string_view text, StateShape shape = StateShape::Any);
+
+    // Short name of the state for logs ("on", "off", "heat", "numeric", ...).
+    const char *entity_state_name(const EntityState &s);
+
+} // namespace state
@@ -1,8 +1,9 @@
 #include "event_logger.hpp"
 
-#include "esp_event.h"
 #include "esp_log.h"
 #include "app_events.hpp"
+#include "deferred_log.hpp"
+#include "state_manager.hpp"
 
 namespace event_logger
 {
@@ -10,149 +11,135 @@ namespace event_logger
     namespace
     {
         static const char *TAG = "APP_EVENT_BUS";
-        static esp_event_handler_instance_t s_any_instance = nullptr;
 
-        static void log_event(void * /*arg*/,
-                              esp_event_base_t event_base,
-                              int32_t event_id,
-                              void *event_data)
+        // Formatted on the deferred_log task; the event lanes only copy
+        // the arguments.
+        constexpr deferred_log::Module kModule = deferred_log::Module::Events;
+
+        static const char *entity_name(const state::Model &model, std::uint16_t handle)
         {
-            const char *base_str = event_base ? event_base : "NULL";
-            if (event_base == APP_EVENTS)
+            const state::Entity *e = model.find(handle);
+            return e ? e->id.data() : "<null>";
+        }
+
+        static void log_event(app_events::Id event_id, const void *event_data)
+        {
+            if (!deferred_log::enabled(kModule, ESP_LOG_INFO))
+                return;
+            // Keeps entity id strings alive until they are copied.
+            const state::ModelPtr model = state::snapshot();
+            switch (event_id)
+            {
+            case app_events::KNOB:
+            {
+                auto *p = static_cast<const app_events::KnobPayload *>(event_data);
+                int code = p ? p->code : -1;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=KNOB code=%d",
+                      code);
+                break;
+            }
+            case app_events::BUTTON:
+            {
+                auto *p = static_cast<const app_events::ButtonPayload *>(event_data);
+                int code = p ? p->code : -1;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=BUTTON code=%d",
+                      code);
+                break;
+            }
+            case app_events::GESTURE:
             {
-                switch (event_id)
-                {
-                case app_events::KNOB:
-                {
-                    auto *p = static_cast<const app_events::KnobPayload *>(event_data);
-                    int code = p ? p->code : -1;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=KNOB code=%d",
-                             base_str,
-                             code);
-                    break;
-                }
-                case app_events::BUTTON:
-                {
-                    auto *p = static_cast<const app_events::ButtonPayload *>(event_data);
-                    int code = p ? p->code : -1;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=BUTTON code=%d",
-                             base_str,
-                             code);
-                    break;
-                }
-                case app_events::GESTURE:
-                {
-                    auto *p = static_cast<const app_events::GesturePayload *>(event_data);
-                    int code = p ? p->code : -1;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=GESTURE code=%d",
-                             base_str,
-                             code);
-                    break;
-                }
-                case app_events::NAVIGATE_ROOM:
-                {
-                    auto *p = static_cast<const app_events::NavigateRoomPayload *>(event_data);
-                    int delta = p ? p->delta : 0;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=NAVIGATE_ROOM delta=%d",
-                             base_str,
-                             delta);
-                    break;
-                }
-                case app_events::TOGGLE_CURRENT_ENTITY:
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=TOGGLE_CURRENT_ENTITY",
-                             base_str);
-                    break;
-                case app_events::ENTITY_STATE_CHANGED:
-                {
-                    auto *p = static_cast<const app_events::EntityStateChangedPayload *>(event_data);
-                    const char *id_str = (p && p->entity_id[0]) ? p->entity_id : "<null>";
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=ENTITY_STATE_CHANGED entity_id=%s",
-                             base_str,
-                             id_str);
-                    break;
-                }
-                case app_events::TOGGLE_REQUEST:
-                {
-                    auto *p = static_cast<const app_events::ToggleRequestPayload *>(event_data);
-                    const char *id_str = (p && p->entity_id[0]) ? p->entity_id : "<null>";
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=TOGGLE_REQUEST entity_id=%s",
-                             base_str,
-                             id_str);
-                    break;
-                }
-                case app_events::TOGGLE_RESULT:
-                {
-                    auto *p = static_cast<const app_events::ToggleResultPayload *>(event_data);
-                    const char *id_str = (p && p->entity_id[0]) ? p->entity_id : "<null>";
-                    bool ok = p ? p->success : false;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=TOGGLE_RESULT entity_id=%s success=%d",
-                             base_str,
-                             id_str,
-                             (int)ok);
-                    break;
-                }
-                case app_events::APP_STATE_CHANGED:
-                {
-                    auto *p = static_cast<const app_events::AppStateChangedPayload *>(event_data);
-                    int old_state = p ? p->old_state : -1;
-                    int new_state = p ? p->new_state : -1;
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=APP_STATE_CHANGED old=%d new=%d",
-                             base_str,
-                             old_state,
-                             new_state);
-                    break;
-                }
-                case app_events::REQUEST_CONFIG_MODE:
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=REQUEST_CONFIG_MODE",
-                             base_str);
-                    break;
-                case app_events::REQUEST_SLEEP:
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=REQUEST_SLEEP",
-                             base_str);
-                    break;
-                case app_events::REQUEST_WAKE:
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=REQUEST_WAKE",
-                             base_str);
-                    break;
-                default:
-                    ESP_LOGI(TAG,
-                             "event: base=%s id=%s (%ld)",
-                             base_str,
-                             app_events::id_to_string(event_id),
-                             static_cast<long>(event_id));
-                    break;
-                }
+                auto *p = static_cast<const app_events::GesturePayload *>(event_data);
+                int code = p ? p->code : -1;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=GESTURE code=%d",
+                      code);
+                break;
             }
-            else
+            case app_events::NAVIGATE_ROOM:
             {
-                ESP_LOGI(TAG, "event: base=%s id=%ld",
-                         base_str,
-                         static_cast<long>(event_id));
+                auto *p = static_cast<const app_events::NavigateRoomPayload *>(event_data);
+                int delta = p ? p->delta : 0;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=NAVIGATE_ROOM delta=%d",
+                      delta);
+                break;
+            }
+            case app_events::TOGGLE_CURRENT_ENTITY:
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=TOGGLE_CURRENT_ENTITY");
+                break;
+            case app_events::ENTITIES_CHANGED:
+            {
+                auto *p = static_cast<const app_events::EntitiesChangedPayload *>(event_data);
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=ENTITIES_CHANGED count=%d%s",
+                      p ? (int)p->count : 0,
+                      (p && p->overflow) ? " (overflow)" : "");
+                break;
+            }
+            case app_events::TOGGLE_REQUEST:
+            {
+                auto *p = static_cast<const app_events::ToggleRequestPayload *>(event_data);
+                int handle = p ? p->entity : -1;
+                const char *id_str = p ? entity_name(*model, p->entity) : "<null>";
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=TOGGLE_REQUEST entity=%d (%s)",
+                      handle,
+                      id_str);
+                break;
+            }
+            case app_events::TOGGLE_RESULT:
+            {
+                auto *p = static_cast<const app_events::ToggleResultPayload *>(event_data);
+                int handle = p ? p->entity : -1;
+                const char *id_str = p ? entity_name(*model, p->entity) : "<null>";
+                bool ok = p ? p->success : false;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=TOGGLE_RESULT entity=%d (%s) success=%d",
+                      handle,
+                      id_str,
+                      (int)ok);
+                break;
+            }
+            case app_events::APP_STATE_CHANGED:
+            {
+                auto *p = static_cast<const app_events::AppStateChangedPayload *>(event_data);
+                int old_state = p ? p->old_state : -1;
+                int new_state = p ? p->new_state : -1;
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=APP_STATE_CHANGED old=%d new=%d",
+                      old_state,
+                      new_state);
+                break;
+            }
+            case app_events::REQUEST_CONFIG_MODE:
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=REQUEST_CONFIG_MODE");
+                break;
+            case app_events::REQUEST_SLEEP:
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=REQUEST_SLEEP");
+                break;
+            case app_events::REQUEST_WAKE:
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=REQUEST_WAKE");
+                break;
+            default:
+                DLOGI(kModule,
+                      "event: base=APP_EVENTS id=%s (%ld)",
+                      app_events::id_to_string(event_id),
+                      static_cast<long>(event_id));
+                break;
             }
         }
     } // namespace
 
     esp_err_t init()
     {
-        // Subscribe only to application-level events on the default loop
-        esp_err_t err = esp_event_handler_instance_register(
-            APP_EVENTS,
-            ESP_EVENT_ANY_ID,
-            &log_event,
-            nullptr,
-            &s_any_instance);
+        // Sees every application-level event after its subscribers.
+        esp_err_t err = app_events::add_monitor(&log_event);
 
         if (err != ESP_OK)
         {
@@ -0,0 +1,268 @@
+#include "event_metrics.hpp"
+
+#include "app_config.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include <atomic>
+#include <climits>
+
+namespace event_metrics
+{
+
+    namespace
+    {
+        static const char *TAG = "event_metrics";
+
+        using Counter = std::atomic<std::uint32_t>;
+
+        // Updated from the lane tasks and from posters (ISRs included),
+        // hence atomics; 32-bit ones are lock-free on the S3.
+        struct LiveHistogram
+        {
+            Counter buckets[kHistogramBuckets] = {};
+            Counter count{0};
+            Counter max_us{0};
+        };
+
+        struct LiveEvent
+        {
+            LiveHistogram latency;
+            LiveHistogram handler;
+            Counter coalesced{0};
+            Counter dropped{0};
+        };
+
+        struct LiveLane
+        {
+            Counter depth{0};
+            Counter high_water{0};
+        };
+
+        // Indexed by app_events::Lane.
+        constexpr const app_config::EventLaneConfig *kLaneConfigs[app_events::kLaneCount] = {
+            &app_config::kInputEventLane,
+            &app_config::kStateEventLane,
+        };
+
+        static LiveEvent s_events[app_events::kEventCount];
+        static LiveLane s_lanes[app_events::kLaneCount];
+        static std::int64_t s_since_us = 0; // reset() and snapshot() only
+        static esp_timer_handle_t s_log_timer = nullptr;
+
+        static std::size_t bucket_of(std::uint32_t us)
+        {
+            std::size_t b = 0;
+            while (b + 1 < kHistogramBuckets && us >= bucket_limit_us(b))
+                ++b;
+            return b;
+        }
+
+        static std::uint32_t clamp_us(std::int64_t us)
+        {
+            if (us < 0)
+                return 0;
+            return us > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(us);
+        }
+
+        static void raise_to(Counter &c, std::uint32_t v)
+        {
+            std::uint32_t cur = c.load(std::memory_order_relaxed);
+            while (v > cur && !c.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        static void record(LiveHistogram &h, std::uint32_t us)
+        {
+            h.buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+            h.count.fetch_add(1, std::memory_order_relaxed);
+            raise_to(h.max_us, us);
+        }
+
+        static void copy(const LiveHistogram &from, Histogram &to)
+        {
+            for (std::size_t b = 0; b < kHistogramBuckets; ++b)
+                to.buckets[b] = from.buckets[b].load(std::memory_order_relaxed);
+            to.count = from.count.load(std::memory_order_relaxed);
+            to.max_us = from.max_us.load(std::memory_order_relaxed);
+        }
+
+        static void clear(LiveHistogram &h)
+        {
+            for (auto &b : h.buckets)
+                b.store(0, std::memory_order_relaxed);
+            h.count.store(0, std::memory_order_relaxed);
+            h.max_us.store(0, std::memory_order_relaxed);
+        }
+
+        static void log_timer_cb(void * /*arg*/)
+        {
+            log_summary();
+        }
+
+    } // namespace
+
+    std::uint32_t Histogram::percentile_us(unsigned pct) const
+    {
+        if (count == 0)
+            return 0;
+        // Rank of the sample, rounded up.
+        const std::uint64_t rank = (static_cast<std::uint64_t>(count) * pct + 99) / 100;
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < kHistogramBuckets; ++b)
+        {
+            seen += buckets[b];
+            if (seen >= rank && seen > 0)
+                return (b + 1 < kHistogramBuckets) ? bucket_limit_us(b) : UINT32_MAX;
+        }
+        return UINT32_MAX;
+    }
+
+    void snapshot(Snapshot &out)
+    {
+        for (std::size_t slot = 0; slot < app_events::kEventCount; ++slot)
+        {
+            const LiveEvent &live = s_events[slot];
+            EventStats &e = out.events[slot];
+            e.id = app_events::kEventIds[slot];
+            copy(live.latency, e.latency);
+            copy(live.handler, e.handler);
+            e.dispatched = e.handler.count;
+            e.coalesced = live.coalesced.load(std::memory_order_relaxed);
+            e.dropped = live.dropped.load(std::memory_order_relaxed);
+        }
+        for (std::size_t lane = 0; lane < app_events::kLaneCount; ++lane)
+        {
+            LaneStats &l = out.lanes[lane];
+            l.name = kLaneConfigs[lane]->task_name;
+            l.capacity = static_cast<std::uint32_t>(kLaneConfigs[lane]->queue_size);
+            l.depth = s_lanes[lane].depth.load(std::memory_order_relaxed);
+            l.high_water = s_lanes[lane].high_water.load(std::memory_order_relaxed);
+        }
+        out.since_us = s_since_us;
+    }
+
+    void reset()
+    {
+        for (LiveEvent &e : s_events)
+        {
+            clear(e.latency);
+            clear(e.handler);
+            e.coalesced.store(0, std::memory_order_relaxed);
+            e.dropped.store(0, std::memory_order_relaxed);
+        }
+        // Depth tracks what is queued right now and is not reset.
+        for (LiveLane &l : s_lanes)
+            l.high_water.store(l.depth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        s_since_us = esp_timer_get_time();
+    }
+
+    void log_summary()
+    {
+        // ~2.5 KB; kept off the caller's stack (timer task, HTTP handler).
+        static Snapshot snap;
+        static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+        static bool busy = false;
+
+        portENTER_CRITICAL(&mux);
+        const bool skip = busy;
+        busy = true;
+        portEXIT_CRITICAL(&mux);
+        if (skip)
+            return;
+
+        snapshot(snap);
+        const std::int64_t window_ms = (esp_timer_get_time() - snap.since_us) / 1000;
+        ESP_LOGI(TAG, "event bus over %lld ms", static_cast<long long>(window_ms));
+        for (const LaneStats &l : snap.lanes)
+        {
+            ESP_LOGI(TAG, "  lane %-8s depth %u/%u, high water %u",
+                     l.name,
+                     static_cast<unsigned>(l.depth),
+                     static_cast<unsigned>(l.capacity),
+                     static_cast<unsigned>(l.high_water));
+        }
+        for (const EventStats &e : snap.events)
+        {
+            if (e.dispatched == 0 && e.dropped == 0 && e.coalesced == 0)
+                continue;
+            ESP_LOGI(TAG, "  %-21s n=%u coalesced=%u dropped=%u | wait p50<%u p99<%u max %u us | handler p50<%u p99<%u max %u us",
+                     app_events::id_to_string(e.id),
+                     static_cast<unsigned>(e.dispatched),
+                     static_cast<unsigned>(e.coalesced),
+                     static_cast<unsigned>(e.dropped),
+                     static_cast<unsigned>(e.latency.percentile_us(50)),
+                     static_cast<unsigned>(e.latency.percentile_us(99)),
+                     static_cast<unsigned>(e.latency.max_us),
+                     static_cast<unsigned>(e.handler.percentile_us(50)),
+                     static_cast<unsigned>(e.handler.percentile_us(99)),
+                     static_cast<unsigned>(e.handler.max_us));
+        }
+
+        portENTER_CRITICAL(&mux);
+        busy = false;
+        portEXIT_CRITICAL(&mux);
+    }
+
+    esp_err_t start_periodic_log(std::uint32_t interval_ms)
+    {
+        if (!s_log_timer)
+        {
+            if (interval_ms == 0)
+                return ESP_OK;
+            esp_timer_create_args_t args = {};
+            args.callback = &log_timer_cb;
+            args.name = "ev_metrics";
+            esp_err_t err = esp_timer_create(&args, &s_log_timer);
+            if (err != ESP_OK)
+            {
+                ESP_LOGW(TAG, "log timer create failed: %s", esp_err_to_name(err));
+                s_log_timer = nullptr;
+                return err;
+            }
+        }
+
+        (void)esp_timer_stop(s_log_timer);
+        if (interval_ms == 0)
+            return ESP_OK;
+        return esp_timer_start_periodic(s_log_timer, static_cast<std::uint64_t>(interval_ms) * 1000);
+    }
+
+    std::uint32_t on_enqueue(app_events::Lane lane)
+    {
+        return s_lanes[static_cast<std::size_t>(lane)].depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void on_post_result(app_events::Lane lane, std::size_t slot, std::uint32_t depth, bool ok)
+    {
+        LiveLane &l = s_lanes[static_cast<std::size_t>(lane)];
+        if (ok)
+        {
+            raise_to(l.high_water, depth);
+            return;
+        }
+        l.depth.fetch_sub(1, std::memory_order_relaxed);
+        if (slot < app_events::kEventCount)
+            s_events[slot].dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_coalesced(std::size_t slot)
+    {
+        if (slot < app_events::kEventCount)
+            s_events[slot].coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_dispatched(app_events::Lane lane, std::size_t slot, std::int64_t latency_us, std::int64_t handler_us)
+    {
+        s_lanes[static_cast<std::size_t>(lane)].depth.fetch_sub(1, std::memory_order_relaxed);
+        if (slot >= app_events::kEventCount)
+            return;
+        LiveEvent &e = s_events[slot];
+        if (latency_us >= 0)
+            record(e.latency, clamp_us(latency_us));
+        record(e.handler, clamp_us(handler_us));
+    }
+
+} // namespace event_metrics
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "app_events.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Event bus telemetry: per-id queue latency and handler time histograms,
+// coalesced/dropped counters and per-lane queue depth. Fixed memory,
+// recorded by app_events on every post and dispatch.
+namespace event_metrics
+{
+
+    // Bucket b counts samples below bucket_limit_us(b) (and at or above
+    // the previous limit); the last bucket is open-ended.
+    constexpr std::size_t kHistogramBuckets = 12;
+
+    constexpr std::uint32_t bucket_limit_us(std::size_t bucket)
+    {
+        return 32u << bucket; // 32 us .. 65 ms
+    }
+
+    struct Histogram
+    {
+        std::uint32_t buckets[kHistogramBuckets] = {};
+        std::uint32_t count = 0;
+        std::uint32_t max_us = 0;
+
+        // Upper bound of the bucket holding the given percentile (0..100);
+        // 0 if empty, UINT32_MAX if it falls in the open bucket.
+        std::uint32_t percentile_us(unsigned pct) const;
+    };
+
+    struct EventStats
+    {
+        app_events::Id id = app_events::KNOB;
+        // Queue wait: dispatch time minus the payload's timestamp_us.
+        // Derived events (NAVIGATE_ROOM) carry the originating input time,
+        // so for them this is input-to-dispatch.
+        Histogram latency;
+        // All subscribers of one dispatch together.
+        Histogram handler;
+        std::uint32_t dispatched = 0;
+        std::uint32_t coalesced = 0; // folded into an already queued event
+        std::uint32_t dropped = 0;   // post failed (queue full, no loop)
+    };
+
+    struct LaneStats
+    {
+        const char *name = "";
+        std::uint32_t capacity = 0;
+        std::uint32_t depth = 0; // queued right now
+        std::uint32_t high_water = 0;
+    };
+
+    struct Snapshot
+    {
+        EventStats events[app_events::kEventCount];
+        LaneStats lanes[app_events::kLaneCount];
+        std::int64_t since_us = 0; // esp_timer time of the last reset
+    };
+
+    // Copy of the counters; values of one event may be a dispatch apart.
+    void snapshot(Snapshot &out);
+    void reset();
+
+    // Dumps the snapshot to the log (serial console).
+    void log_summary();
+
+    // Starts logging the summary every interval_ms; 0 stops it.
+    esp_err_t start_periodic_log(std::uint32_t interval_ms);
+
+    // ---- recording (app_events) -------------------------------------------
+
+    // Before the event is handed to the lane queue, so the dispatcher never
+    // sees the depth go negative; returns the depth including this event.
+    std::uint32_t on_enqueue(app_events::Lane lane);
+    // After the post, with on_enqueue's depth; `ok` false undoes
+    // on_enqueue and counts a drop.
+    void on_post_result(app_events::Lane lane, std::size_t slot, std::uint32_t depth, bool ok);
+    void on_coalesced(std::size_t slot);
+    void on_dispatched(app_events::Lane lane, std::size_t slot, std::int64_t latency_us, std::int64_t handler_us);
+
+} // namespace event_metrics
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "app_events.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// Subscriber table behind the app event loops (see app_events.cpp): id to
+// slot by one array read, then the slot's subscribers through their typed
+// invokers. In a header of its own so the host dispatch bench runs the
+// same code.
+namespace app_events
+{
+
+    namespace detail
+    {
+
+        // Ids are small (see Id).
+        constexpr int32_t kMaxId = 127;
+
+        struct SlotTable
+        {
+            std::uint8_t slot[kMaxId + 1];
+        };
+
+        constexpr SlotTable make_slot_table()
+        {
+            SlotTable t{};
+            for (int32_t id = 0; id <= kMaxId; ++id)
+                t.slot[id] = static_cast<std::uint8_t>(slot_of(id));
+            return t;
+        }
+
+        constexpr SlotTable kSlotById = make_slot_table();
+
+        constexpr bool ids_in_range()
+        {
+            for (Id id : kEventIds)
+            {
+                if (id < 0 || id > kMaxId)
+                    return false;
+            }
+            return true;
+        }
+        static_assert(ids_in_range(), "event id outside kSlotById");
+
+        struct Subscriber
+        {
+            ErasedFn fn = nullptr;
+            Invoker invoke = nullptr;
+        };
+
+        // Subscribers per slot. Entries are written before the count is
+        // published, so the loop task reads them without a lock.
+        struct SubscriberTable
+        {
+            Subscriber subs[kEventCount][kMaxSubscribersPerEvent];
+            std::atomic<std::uint8_t> counts[kEventCount] = {};
+
+            bool add(std::size_t slot, const Subscriber &s)
+            {
+                const std::uint8_t n = counts[slot].load(std::memory_order_relaxed);
+                if (n >= kMaxSubscribersPerEvent)
+                    return false;
+                subs[slot][n] = s;
+                counts[slot].store(n + 1, std::memory_order_release);
+                return true;
+            }
+
+            void dispatch_slot(std::size_t slot, const void *payload) const
+            {
+                const std::uint8_t n = counts[slot].load(std::memory_order_acquire);
+                for (std::uint8_t i = 0; i < n; ++i)
+                {
+                    subs[slot][i].invoke(subs[slot][i].fn, payload);
+                }
+            }
+        };
+
+    } // namespace detail
+
+} // namespace app_events
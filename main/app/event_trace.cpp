@@ -0,0 +1,501 @@
+#include "event_trace.hpp"
+
+#include "app_events.hpp"
+#include "event_metrics.hpp"
+#include "state_manager.hpp"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace event_trace
+{
+
+    namespace
+    {
+        static const char *TAG = "event_trace";
+
+        using RepostFn = esp_err_t (*)(const void *payload);
+
+        // Posts a recorded payload again, stamped with the replay time so
+        // the queue latency metrics stay meaningful.
+        template <app_events::Id E>
+        esp_err_t repost(const void *data)
+        {
+            app_events::PayloadOf<E> payload;
+            std::memcpy(&payload, data, sizeof(payload));
+            payload.timestamp_us = esp_timer_get_time();
+            return app_events::post<E>(payload);
+        }
+
+        struct Traced
+        {
+            app_events::Id id;
+            std::size_t size;
+            RepostFn repost;
+        };
+
+        template <app_events::Id E>
+        constexpr Traced traced()
+        {
+            static_assert(sizeof(app_events::PayloadOf<E>) <= UINT8_MAX, "payload too large for a trace record");
+            return Traced{E, sizeof(app_events::PayloadOf<E>), &repost<E>};
+        }
+
+        // Source events; everything else is derived from these.
+        constexpr Traced kTraced[] = {
+            traced<app_events::KNOB>(),
+            traced<app_events::BUTTON>(),
+            traced<app_events::GESTURE>(),
+            traced<app_events::TOGGLE_RESULT>(),
+        };
+
+        struct TracedUpdate
+        {
+            std::uint16_t entity;
+            std::uint8_t kind;
+            std::uint8_t mode;
+            float value;
+        };
+        static_assert(sizeof(TracedUpdate) == kEntityUpdateSize, "trace format");
+
+        static const Traced *find_traced(std::int32_t id)
+        {
+            for (const Traced &t : kTraced)
+            {
+                if (t.id == id)
+                    return &t;
+            }
+            return nullptr;
+        }
+
+        // Byte ring of records. head/tail are running offsets; the data
+        // index is offset % s_capacity. Guarded by s_mux (posts may come
+        // from ISRs).
+        static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+        static unsigned char *s_buf = nullptr;
+        static std::size_t s_capacity = 0;
+        static std::uint32_t s_head = 0;
+        static std::uint32_t s_tail = 0;
+        static std::uint32_t s_records = 0;
+        static std::int64_t s_last_us = 0;
+        static std::atomic<bool> s_recording{false};
+        static std::atomic<bool> s_replaying{false};
+        // Recording was on when load_blob() or replay() stopped it; the
+        // replay restarts it when done.
+        static std::atomic<bool> s_resume_recording{false};
+
+        static void ring_write(std::uint32_t at, const void *src, std::size_t len)
+        {
+            const auto *p = static_cast<const unsigned char *>(src);
+            for (std::size_t i = 0; i < len; ++i)
+                s_buf[(at + i) % s_capacity] = p[i];
+        }
+
+        static void ring_read(std::uint32_t at, void *dst, std::size_t len)
+        {
+            auto *p = static_cast<unsigned char *>(dst);
+            for (std::size_t i = 0; i < len; ++i)
+                p[i] = s_buf[(at + i) % s_capacity];
+        }
+
+        static std::size_t record_size_at(std::uint32_t at)
+        {
+            unsigned char size = 0;
+            ring_read(at + 5, &size, 1);
+            return kRecordHeaderSize + size;
+        }
+
+        static bool should_record()
+        {
+            return s_recording.load(std::memory_order_relaxed) && !s_replaying.load(std::memory_order_relaxed);
+        }
+
+        static void append_record(unsigned char id, const void *payload, std::size_t size)
+        {
+            const std::int64_t now_us = esp_timer_get_time();
+            const std::size_t need = kRecordHeaderSize + size;
+
+            portENTER_CRITICAL_SAFE(&s_mux);
+            if (s_buf && need <= s_capacity)
+            {
+                // Make room by dropping the oldest records.
+                while (s_capacity - (s_head - s_tail) < need)
+                {
+                    s_tail += record_size_at(s_tail);
+                    --s_records;
+                }
+
+                const std::int64_t delta = s_records > 0 ? now_us - s_last_us : 0;
+                const std::uint32_t delta_us = delta < 0 ? 0 : (delta > UINT32_MAX ? UINT32_MAX : static_cast<std::uint32_t>(delta));
+                const unsigned char size_byte = static_cast<unsigned char>(size);
+                ring_write(s_head, &delta_us, 4);
+                ring_write(s_head + 4, &id, 1);
+                ring_write(s_head + 5, &size_byte, 1);
+                ring_write(s_head + kRecordHeaderSize, payload, size);
+                s_head += need;
+                ++s_records;
+                s_last_us = now_us;
+            }
+            portEXIT_CRITICAL_SAFE(&s_mux);
+        }
+
+        static void on_post(app_events::Id id, const void *payload, std::size_t size)
+        {
+            if (!should_record() || !find_traced(id))
+                return;
+            append_record(static_cast<unsigned char>(id), payload, size);
+        }
+
+        // States are read back from the model; a newer update racing in
+        // records the newer value twice, which replays the same.
+        static void on_entity_updates(const state::Model &model, const state::EntityHandle *changed, std::size_t count)
+        {
+            if (!should_record())
+                return;
+
+            TracedUpdate batch[kUpdatesPerRecord];
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const state::Entity *e = model.find(changed[i]);
+                if (!e || e->removed)
+                    continue;
+                const state::EntityState st = e->state.load();
+                batch[n++] = TracedUpdate{e->handle, static_cast<std::uint8_t>(st.kind), static_cast<std::uint8_t>(st.mode), st.value};
+                if (n == kUpdatesPerRecord)
+                {
+                    append_record(kEntityUpdatesRecord, batch, n * sizeof(TracedUpdate));
+                    n = 0;
+                }
+            }
+            if (n > 0)
+                append_record(kEntityUpdatesRecord, batch, n * sizeof(TracedUpdate));
+        }
+
+        // Re-applies a recorded state batch; false if the record is malformed.
+        static bool apply_updates(const unsigned char *payload, std::size_t size)
+        {
+            if (size == 0 || size % sizeof(TracedUpdate) != 0)
+                return false;
+
+            state::EntityUpdate updates[kUpdatesPerRecord];
+            const std::size_t n = size / sizeof(TracedUpdate);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                TracedUpdate u;
+                std::memcpy(&u, payload + i * sizeof(TracedUpdate), sizeof(u));
+                if (u.kind > static_cast<std::uint8_t>(state::StateKind::Mode) ||
+                    u.mode > static_cast<std::uint8_t>(state::StateMode::Closing))
+                {
+                    return false;
+                }
+                updates[i].entity = u.entity;
+                updates[i].state.kind = static_cast<state::StateKind>(u.kind);
+                updates[i].state.mode = static_cast<state::StateMode>(u.mode);
+                updates[i].state.value = u.value;
+            }
+            (void)state::apply_entity_updates(updates, n);
+            return true;
+        }
+
+        static void free_buffer()
+        {
+            portENTER_CRITICAL(&s_mux);
+            unsigned char *buf = s_buf;
+            s_buf = nullptr;
+            s_capacity = 0;
+            s_head = s_tail = s_records = 0;
+            portEXIT_CRITICAL(&s_mux);
+            if (buf)
+                heap_caps_free(buf);
+        }
+
+        static esp_err_t ensure_buffer(std::size_t capacity_bytes)
+        {
+            if (s_buf && s_capacity == capacity_bytes)
+                return ESP_OK;
+            free_buffer();
+
+            void *b = nullptr;
+#if CONFIG_SPIRAM
+            b = heap_caps_malloc(capacity_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+            if (!b)
+                b = heap_caps_malloc(capacity_bytes, MALLOC_CAP_8BIT);
+            if (!b)
+                return ESP_ERR_NO_MEM;
+
+            portENTER_CRITICAL(&s_mux);
+            s_buf = static_cast<unsigned char *>(b);
+            s_capacity = capacity_bytes;
+            s_head = s_tail = s_records = 0;
+            portEXIT_CRITICAL(&s_mux);
+            return ESP_OK;
+        }
+
+        static void replay_task(void *arg)
+        {
+            const std::uint32_t speed = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(arg));
+
+            event_metrics::reset();
+            const std::int64_t start_us = esp_timer_get_time();
+            std::int64_t target_us = start_us;
+            std::uint64_t recorded_us = 0;
+            std::uint32_t posted = 0;
+            std::uint32_t skipped = 0;
+
+            // Recording is off while replaying, so the ring is not written.
+            std::uint32_t at = s_tail;
+            const std::uint32_t end = s_head;
+            bool first = true;
+            while (at != end)
+            {
+                std::uint32_t delta_us = 0;
+                unsigned char id = 0;
+                unsigned char size = 0;
+                ring_read(at, &delta_us, 4);
+                ring_read(at + 4, &id, 1);
+                ring_read(at + 5, &size, 1);
+
+                alignas(8) unsigned char payload[UINT8_MAX];
+                ring_read(at + kRecordHeaderSize, payload, size);
+                at += kRecordHeaderSize + size;
+
+                if (!first)
+                {
+                    recorded_us += delta_us;
+                    if (speed > 0)
+                    {
+                        target_us += static_cast<std::int64_t>(delta_us) * 100 / speed;
+                        const std::int64_t wait_us = target_us - esp_timer_get_time();
+                        if (wait_us >= 1000)
+                            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+                    }
+                }
+                first = false;
+
+                if (id == kEntityUpdatesRecord)
+                {
+                    if (!apply_updates(payload, size))
+                    {
+                        ++skipped;
+                        continue;
+                    }
+                    ++posted;
+                    continue;
+                }
+
+                const Traced *t = find_traced(id);
+                if (!t || t->size != size || t->repost(payload) != ESP_OK)
+                {
+                    ++skipped;
+                    continue;
+                }
+                ++posted;
+            }
+
+            // Let the lanes finish the last events before reporting.
+            vTaskDelay(pdMS_TO_TICKS(500));
+            ESP_LOGI(TAG, "replayed %u records (%u skipped) in %lld ms; recorded span %llu ms, speed %u%%",
+                     static_cast<unsigned>(posted),
+                     static_cast<unsigned>(skipped),
+                     static_cast<long long>((esp_timer_get_time() - start_us) / 1000),
+                     static_cast<unsigned long long>(recorded_us / 1000),
+                     static_cast<unsigned>(speed));
+            event_metrics::log_summary();
+
+            s_replaying.store(false, std::memory_order_release);
+            if (s_resume_recording.exchange(false, std::memory_order_acq_rel))
+                (void)start(s_capacity);
+            vTaskDelete(nullptr);
+        }
+
+    } // namespace
+
+    esp_err_t start(std::size_t capacity_bytes)
+    {
+        if (capacity_bytes < kRecordHeaderSize + UINT8_MAX)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (s_replaying.load(std::memory_order_acquire))
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        esp_err_t err = ensure_buffer(capacity_bytes);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "no memory for a %u byte trace", static_cast<unsigned>(capacity_bytes));
+            return err;
+        }
+
+        app_events::set_post_hook(&on_post);
+        state::set_update_hook(&on_entity_updates);
+        s_recording.store(true, std::memory_order_release);
+        ESP_LOGI(TAG, "recording, %u byte ring", static_cast<unsigned>(capacity_bytes));
+        return ESP_OK;
+    }
+
+    void stop()
+    {
+        s_recording.store(false, std::memory_order_release);
+    }
+
+    bool recording()
+    {
+        return s_recording.load(std::memory_order_acquire);
+    }
+
+    void clear()
+    {
+        portENTER_CRITICAL(&s_mux);
+        s_head = s_tail = s_records = 0;
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    std::size_t blob_size()
+    {
+        portENTER_CRITICAL(&s_mux);
+        const std::size_t bytes = s_head - s_tail;
+        portEXIT_CRITICAL(&s_mux);
+        return sizeof(TraceHeader) + bytes;
+    }
+
+    std::size_t read_blob(std::size_t offset, void *out, std::size_t len)
+    {
+        if (!out || recording())
+        {
+            return 0;
+        }
+
+        TraceHeader header{};
+        header.magic = kTraceMagic;
+        header.version = kTraceVersion;
+        header.header_size = sizeof(TraceHeader);
+        header.bytes = s_head - s_tail;
+        header.records = s_records;
+
+        const std::size_t total = sizeof(TraceHeader) + header.bytes;
+        if (offset >= total)
+        {
+            return 0;
+        }
+        if (len > total - offset)
+        {
+            len = total - offset;
+        }
+
+        auto *dst = static_cast<unsigned char *>(out);
+        std::size_t done = 0;
+        if (offset < sizeof(TraceHeader))
+        {
+            done = sizeof(TraceHeader) - offset;
+            if (done > len)
+                done = len;
+            std::memcpy(dst, reinterpret_cast<const unsigned char *>(&header) + offset, done);
+        }
+        if (done < len)
+        {
+            ring_read(s_tail + static_cast<std::uint32_t>(offset + done - sizeof(TraceHeader)), dst + done, len - done);
+        }
+        return len;
+    }
+
+    esp_err_t load_blob(const void *blob, std::size_t len)
+    {
+        if (!blob || len < sizeof(TraceHeader) || s_replaying.load(std::memory_order_acquire))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        TraceHeader header;
+        std::memcpy(&header, blob, sizeof(header));
+        if (header.magic != kTraceMagic || header.version != kTraceVersion ||
+            header.header_size < sizeof(TraceHeader) || header.header_size + static_cast<std::size_t>(header.bytes) != len)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        // Walk the records before taking them.
+        const auto *records = static_cast<const unsigned char *>(blob) + header.header_size;
+        std::size_t at = 0;
+        std::uint32_t count = 0;
+        while (at < header.bytes)
+        {
+            if (header.bytes - at < kRecordHeaderSize)
+                return ESP_ERR_INVALID_SIZE;
+            const std::size_t size = kRecordHeaderSize + records[at + 5];
+            if (header.bytes - at < size)
+                return ESP_ERR_INVALID_SIZE;
+            at += size;
+            ++count;
+        }
+        if (count != header.records)
+        {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        if (recording())
+        {
+            s_resume_recording.store(true, std::memory_order_release);
+            stop();
+        }
+        const std::size_t capacity = s_capacity > header.bytes ? s_capacity : header.bytes;
+        esp_err_t err = ensure_buffer(capacity);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        clear();
+        ring_write(0, records, header.bytes);
+        portENTER_CRITICAL(&s_mux);
+        s_head = header.bytes;
+        s_records = count;
+        portEXIT_CRITICAL(&s_mux);
+        ESP_LOGI(TAG, "loaded trace: %u records, %u bytes", static_cast<unsigned>(count), static_cast<unsigned>(header.bytes));
+        return ESP_OK;
+    }
+
+    esp_err_t replay(const ReplayOptions &options)
+    {
+        if (s_records == 0)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        bool expected = false;
+        if (!s_replaying.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        // The task reads the ring; nothing may append to it meanwhile.
+        if (recording())
+        {
+            s_resume_recording.store(true, std::memory_order_release);
+            stop();
+        }
+
+        void *arg = reinterpret_cast<void *>(static_cast<std::uintptr_t>(options.speed_percent));
+        if (xTaskCreate(&replay_task, "ev_replay", 4096, arg, 3, nullptr) != pdPASS)
+        {
+            s_replaying.store(false, std::memory_order_release);
+            if (s_resume_recording.exchange(false, std::memory_order_acq_rel))
+                (void)start(s_capacity);
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGI(TAG, "replaying %u events at %u%%", static_cast<unsigned>(s_records), static_cast<unsigned>(options.speed_percent));
+        return ESP_OK;
+    }
+
+    bool replaying()
+    {
+        return s_replaying.load(std::memory_order_acquire);
+    }
+
+} // namespace event_trace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esp_err.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Record and replay of the app event stream. Recording keeps the source
+// events (knob, button, gesture, toggle results) and the entity state
+// changes (handle and new EntityState, one record per applied batch) in
+// a RAM ring, oldest dropped first. The trace can be downloaded, loaded
+// back (on this or another build) and replayed with the original or
+// scaled timing, so a field session's handler cost can be reproduced
+// and compared.
+//
+// Derived events (NAVIGATE_ROOM, TOGGLE_REQUEST, ENTITIES_CHANGED, ...)
+// are not recorded: replaying the sources produces them again. State
+// changes are re-applied through state::apply_entity_updates, so the
+// dirty set, ENTITIES_CHANGED and the room refresh timer run as they did
+// live. Handles index the model, so replay needs the same bootstrap;
+// unknown handles are skipped.
+namespace event_trace
+{
+
+    // Trace blob: TraceHeader, then `records` records, oldest first:
+    //   uint32 delta_us   time since the previous record (saturated)
+    //   uint8  id         app_events::Id, or kEntityUpdatesRecord
+    //   uint8  size       payload bytes
+    //   payload           PayloadOf<id> as posted, or for state changes
+    //                     up to kUpdatesPerRecord entries of
+    //                     {uint16 entity, uint8 kind, uint8 mode, float value}
+    // Little endian, packed.
+    constexpr std::uint32_t kTraceMagic = 0x52545645; // "EVTR"
+    constexpr std::uint16_t kTraceVersion = 2;
+
+    constexpr std::uint8_t kEntityUpdatesRecord = 0xFF;
+    constexpr std::size_t kEntityUpdateSize = 8;
+    // Larger batches are split over several records.
+    constexpr std::size_t kUpdatesPerRecord = 255 / kEntityUpdateSize;
+
+    struct TraceHeader
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t header_size;
+        std::uint32_t bytes; // records only
+        std::uint32_t records;
+    };
+
+    constexpr std::size_t kRecordHeaderSize = 6;
+
+    // Starts (or resumes) recording into a ring of capacity_bytes, in
+    // PSRAM when available. A different capacity drops the current trace.
+    esp_err_t start(std::size_t capacity_bytes);
+    // Stops recording; the trace is kept.
+    void stop();
+    bool recording();
+    void clear();
+
+    // The trace as a blob (header + records). Read while not recording.
+    std::size_t blob_size();
+    std::size_t read_blob(std::size_t offset, void *out, std::size_t len);
+
+    // Replaces the trace with a blob from read_blob(). Stops recording;
+    // the next replay() restarts it when done.
+    esp_err_t load_blob(const void *blob, std::size_t len);
+
+    struct ReplayOptions
+    {
+        // 100 = recorded timing, 200 = twice as fast, 0 = no waits.
+        std::uint32_t speed_percent = 100;
+    };
+
+    // Replays the trace on a background task. Event metrics are reset at
+    // the start and logged at the end. Recording pauses for the replay and
+    // resumes (appending to the same ring) when it ends. Toggles are not
+    // sent to HA while replaying (see replaying()).
+    esp_err_t replay(const ReplayOptions &options);
+    bool replaying();
+
+} // namespace event_trace
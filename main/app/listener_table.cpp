@@ -0,0 +1,95 @@
+#include "listener_table.hpp"
+
+namespace state
+{
+
+    namespace
+    {
+        // Subscription ids carry the slot generation so a stale id cannot
+        // remove a listener that reused the slot.
+        int make_subscription_id(std::uint16_t slot, std::uint16_t generation)
+        {
+            return (static_cast<int>(generation & 0x7FFF) << 16) | (slot + 1);
+        }
+    } // namespace
+
+    int ListenerTable::add(EntityHandle handle, EntityListener cb)
+    {
+        if (!cb.fn || handle == kInvalidEntity)
+            return 0;
+
+        if (handle >= head_.size())
+            head_.resize(static_cast<std::size_t>(handle) + 1, kNoSlot);
+
+        std::uint16_t slot = free_;
+        if (slot != kNoSlot)
+        {
+            free_ = entries_[slot].next;
+        }
+        else
+        {
+            if (entries_.size() >= kNoSlot)
+                return 0;
+            slot = static_cast<std::uint16_t>(entries_.size());
+            entries_.emplace_back();
+        }
+
+        Entry &e = entries_[slot];
+        e.cb = cb;
+        e.entity = handle;
+        e.next = head_[handle];
+        head_[handle] = slot;
+        return make_subscription_id(slot, e.generation);
+    }
+
+    void ListenerTable::remove(int subscription_id)
+    {
+        if (subscription_id <= 0)
+            return;
+        const std::size_t slot_plus_one = static_cast<std::size_t>(subscription_id & 0xFFFF);
+        const std::uint16_t generation = static_cast<std::uint16_t>(subscription_id >> 16);
+        if (slot_plus_one == 0 || slot_plus_one > entries_.size())
+            return;
+
+        const std::uint16_t slot = static_cast<std::uint16_t>(slot_plus_one - 1);
+        Entry &e = entries_[slot];
+        if (e.entity == kInvalidEntity || (e.generation & 0x7FFF) != generation)
+            return;
+
+        // Unlink from the entity's list
+        std::uint16_t *link = &head_[e.entity];
+        while (*link != kNoSlot && *link != slot)
+            link = &entries_[*link].next;
+        if (*link == slot)
+            *link = e.next;
+
+        e.cb = EntityListener{};
+        e.entity = kInvalidEntity;
+        ++e.generation;
+        e.next = free_;
+        free_ = slot;
+    }
+
+    std::size_t ListenerTable::count(EntityHandle handle) const
+    {
+        std::size_t n = 0;
+        if (handle < head_.size())
+        {
+            for (std::uint16_t s = head_[handle]; s != kNoSlot; s = entries_[s].next)
+                ++n;
+        }
+        return n;
+    }
+
+    std::size_t ListenerTable::collect(EntityHandle handle, EntityListener *out, std::size_t max) const
+    {
+        std::size_t n = 0;
+        if (handle < head_.size())
+        {
+            for (std::uint16_t s = head_[handle]; s != kNoSlot && n < max; s = entries_[s].next)
+                out[n++] = entries_[s].cb;
+        }
+        return n;
+    }
+
+} // namespace state
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace state
+{
+
+    // Plain function + context so registering and notifying never allocate
+    // a closure. Called on the task that updated the state, outside locks.
+    struct EntityListener
+    {
+        void (*fn)(const Entity &entity, void *ctx) = nullptr;
+        void *ctx = nullptr;
+    };
+
+    // Listener registry with one singly linked list per entity: heads are
+    // indexed by handle, slots live in one vector and freed slots are
+    // chained through `next` as well. Adding may grow the vectors;
+    // collecting only walks the list of one entity and never allocates.
+    // Not synchronized; the owner serializes access.
+    class ListenerTable
+    {
+    public:
+        // Returns a subscription id (> 0), or 0 if no slot is left.
+        int add(EntityHandle handle, EntityListener cb);
+        // Ids of removed listeners are ignored, also once their slot
+        // is reused.
+        void remove(int subscription_id);
+
+        std::size_t count(EntityHandle handle) const;
+        // Copy up to `max` listeners of `handle` to `out`; returns the
+        // number copied.
+        std::size_t collect(EntityHandle handle, EntityListener *out, std::size_t max) const;
+
+    private:
+        static constexpr std::uint16_t kNoSlot = 0xFFFF;
+
+        struct Entry
+        {
+            EntityListener cb;
+            std::uint16_t next = kNoSlot;
+            std::uint16_t generation = 0;
+            EntityHandle entity = kInvalidEntity;
+        };
+
+        std::vector<Entry> entries_;
+        std::vector<std::uint16_t> head_; // by entity handle
+        std::uint16_t free_ = kNoSlot;
+    };
+
+} // namespace state
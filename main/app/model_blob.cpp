@@ -0,0 +1,174 @@
+#include "model_blob.hpp"
+
+#include "state_manager.hpp"
+
+#include "esp_rom_crc.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace state
+{
+
+    namespace
+    {
+
+        constexpr std::uint32_t align4(std::uint32_t v)
+        {
+            return (v + 3u) & ~3u;
+        }
+
+        // Deduplicating string table writer.
+        class StringTable
+        {
+        public:
+            BlobString add(std::string_view s)
+            {
+                auto it = offsets_.find(s);
+                if (it != offsets_.end())
+                    return BlobString{it->second, static_cast<std::uint32_t>(s.size())};
+
+                const std::uint32_t offset = static_cast<std::uint32_t>(bytes_.size());
+                bytes_.append(s.data(), s.size());
+                bytes_.push_back('\0');
+                // Key views point into the model, which outlives the encoder.
+                offsets_.emplace(s, offset);
+                return BlobString{offset, static_cast<std::uint32_t>(s.size())};
+            }
+
+            const std::string &bytes() const { return bytes_; }
+
+        private:
+            std::string bytes_;
+            std::unordered_map<std::string_view, std::uint32_t> offsets_;
+        };
+
+        bool string_ok(const BlobHeader &hdr, const BlobString &s)
+        {
+            if (s.offset >= hdr.strings_size || s.length >= hdr.strings_size - s.offset)
+                return false;
+            const char *base = reinterpret_cast<const char *>(&hdr) + hdr.strings_offset;
+            return base[s.offset + s.length] == '\0';
+        }
+
+        bool table_ok(const BlobHeader &hdr, std::uint32_t offset, std::uint32_t count, std::size_t item_size)
+        {
+            if (offset % 4 != 0 || offset < hdr.header_size || offset > hdr.total_size)
+                return false;
+            return count <= (hdr.total_size - offset) / item_size;
+        }
+
+    } // namespace
+
+    std::uint32_t model_blob_crc(const BlobHeader &hdr)
+    {
+        BlobHeader covered = hdr;
+        covered.crc = 0;
+        covered.sequence = 0;
+        const std::uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const std::uint8_t *>(&covered), sizeof(covered));
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(&hdr);
+        return esp_rom_crc32_le(crc, bytes + hdr.header_size, hdr.total_size - hdr.header_size);
+    }
+
+    void encode_model_blob(const Model &model, std::string &out)
+    {
+        StringTable strings;
+        std::vector<BlobArea> areas;
+        std::vector<BlobEntity> entities;
+        std::unordered_map<std::string_view, std::uint32_t> area_by_id;
+
+        areas.reserve(model.areas.size());
+        for (const Area &a : model.areas)
+        {
+            area_by_id.emplace(a.id, static_cast<std::uint32_t>(areas.size()));
+            areas.push_back(BlobArea{strings.add(a.id), strings.add(a.name)});
+        }
+
+        entities.reserve(model.entities.size());
+        for (const Entity &e : model.entities)
+        {
+            auto area = area_by_id.find(e.area_id);
+            if (e.removed || area == area_by_id.end())
+                continue;
+
+            const EntityState st = e.state.load();
+            BlobEntity be{};
+            be.id = strings.add(e.id);
+            be.name = strings.add(e.name);
+            be.area = area->second;
+            be.kind = static_cast<std::uint8_t>(st.kind);
+            be.mode = static_cast<std::uint8_t>(st.mode);
+            be.domain = static_cast<std::uint8_t>(e.domain);
+            be.value = st.value;
+            entities.push_back(be);
+        }
+
+        BlobHeader hdr{};
+        hdr.magic = kBlobMagic;
+        hdr.version = kBlobVersion;
+        hdr.header_size = sizeof(BlobHeader);
+        hdr.area_count = static_cast<std::uint32_t>(areas.size());
+        hdr.entity_count = static_cast<std::uint32_t>(entities.size());
+        hdr.areas_offset = align4(sizeof(BlobHeader));
+        hdr.entities_offset = align4(hdr.areas_offset + hdr.area_count * sizeof(BlobArea));
+        hdr.strings_offset = align4(hdr.entities_offset + hdr.entity_count * sizeof(BlobEntity));
+        hdr.strings_size = static_cast<std::uint32_t>(strings.bytes().size());
+        hdr.total_size = hdr.strings_offset + hdr.strings_size;
+
+        out.assign(hdr.total_size, '\0');
+        char *base = out.data();
+        if (!areas.empty())
+            std::memcpy(base + hdr.areas_offset, areas.data(), areas.size() * sizeof(BlobArea));
+        if (!entities.empty())
+            std::memcpy(base + hdr.entities_offset, entities.data(), entities.size() * sizeof(BlobEntity));
+        std::memcpy(base + hdr.strings_offset, strings.bytes().data(), hdr.strings_size);
+        std::memcpy(base, &hdr, sizeof(hdr));
+
+        hdr.crc = model_blob_crc(*reinterpret_cast<const BlobHeader *>(base));
+        std::memcpy(base, &hdr, sizeof(hdr));
+    }
+
+    const BlobHeader *validate_model_blob(const void *data, std::size_t size)
+    {
+        if (!data || size < sizeof(BlobHeader) || reinterpret_cast<std::uintptr_t>(data) % 4 != 0)
+            return nullptr;
+
+        const auto *hdr = static_cast<const BlobHeader *>(data);
+        if (hdr->magic != kBlobMagic || hdr->version != kBlobVersion ||
+            hdr->header_size != sizeof(BlobHeader) ||
+            hdr->total_size > size || hdr->total_size < hdr->header_size)
+        {
+            return nullptr;
+        }
+        if (!table_ok(*hdr, hdr->areas_offset, hdr->area_count, sizeof(BlobArea)) ||
+            !table_ok(*hdr, hdr->entities_offset, hdr->entity_count, sizeof(BlobEntity)) ||
+            !table_ok(*hdr, hdr->strings_offset, hdr->strings_size, 1))
+        {
+            return nullptr;
+        }
+        if (model_blob_crc(*hdr) != hdr->crc)
+            return nullptr;
+
+        const char *base = static_cast<const char *>(data);
+        const auto *areas = reinterpret_cast<const BlobArea *>(base + hdr->areas_offset);
+        for (std::uint32_t i = 0; i < hdr->area_count; ++i)
+        {
+            if (!string_ok(*hdr, areas[i].id) || !string_ok(*hdr, areas[i].name))
+                return nullptr;
+        }
+        const auto *entities = reinterpret_cast<const BlobEntity *>(base + hdr->entities_offset);
+        for (std::uint32_t i = 0; i < hdr->entity_count; ++i)
+        {
+            if (!string_ok(*hdr, entities[i].id) || !string_ok(*hdr, entities[i].name) ||
+                entities[i].area >= hdr->area_count ||
+                entities[i].kind > static_cast<std::uint8_t>(StateKind::Mode) ||
+                entities[i].mode > static_cast<std::uint8_t>(StateMode::Closing) ||
+                entities[i].domain >= static_cast<std::uint8_t>(EntityDomain::Count))
+            {
+                return nullptr;
+            }
+        }
+        return hdr;
+    }
+
+} // namespace state
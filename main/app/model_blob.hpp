@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace state
+{
+
+    struct Model;
+
+    // Binary image of a state model, used for the warm-boot snapshot. The
+    // layout is read in place (e.g. from memory-mapped flash): every table
+    // is 4-byte aligned, strings are NUL-terminated, and a model loaded
+    // from it keeps string_views straight into the image. Writer
+    // (encode_model_blob) and reader (validate_model_blob and
+    // state::load_model_blob) share the structs below; bump kBlobVersion
+    // on any change to them.
+    //
+    //   BlobHeader
+    //   BlobArea[area_count]       at areas_offset
+    //   BlobEntity[entity_count]   at entities_offset
+    //   char strings[strings_size] at strings_offset
+    constexpr std::uint32_t kBlobMagic = 0x42534148; // "HASB"
+    constexpr std::uint16_t kBlobVersion = 3;
+
+    struct BlobHeader
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t header_size;
+        std::uint32_t total_size; // header + tables + strings
+        std::uint32_t crc;        // CRC32 of the whole image, crc and sequence read as 0
+        std::uint32_t sequence;   // set by the storage layer, not covered by crc
+        std::uint32_t area_count;
+        std::uint32_t entity_count;
+        std::uint32_t areas_offset;
+        std::uint32_t entities_offset;
+        std::uint32_t strings_offset;
+        std::uint32_t strings_size;
+        std::uint32_t reserved;
+    };
+
+    // Offset into the string table; the byte at offset + length is '\0'.
+    struct BlobString
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct BlobArea
+    {
+        BlobString id;
+        BlobString name;
+    };
+
+    struct BlobEntity
+    {
+        BlobString id;
+        BlobString name;
+        std::uint32_t area; // index into the area table
+        std::uint8_t kind;  // StateKind
+        std::uint8_t mode;  // StateMode
+        std::uint8_t domain; // EntityDomain
+        std::uint8_t reserved;
+        float value;
+    };
+
+    static_assert(sizeof(BlobHeader) == 48, "BlobHeader layout changed, bump kBlobVersion");
+    static_assert(sizeof(BlobArea) == 16, "BlobArea layout changed, bump kBlobVersion");
+    static_assert(sizeof(BlobEntity) == 28, "BlobEntity layout changed, bump kBlobVersion");
+
+    // Serialize the live (non-removed) entities of `model` with their
+    // current states. `out` receives the complete image, sequence 0.
+    void encode_model_blob(const Model &model, std::string &out);
+
+    // Check magic, version, bounds of every table and string, and the CRC.
+    // Returns the header on success, nullptr otherwise.
+    const BlobHeader *validate_model_blob(const void *data, std::size_t size);
+
+    // View of a string in a validated image.
+    inline std::string_view blob_string(const BlobHeader &hdr, const BlobString &s)
+    {
+        const char *base = reinterpret_cast<const char *>(&hdr) + hdr.strings_offset;
+        return std::string_view(base + s.offset, s.length);
+    }
+
+    // CRC32 over the part of the image covered by BlobHeader::crc (the
+    // header fields included, so a damaged count or offset is caught).
+    std::uint32_t model_blob_crc(const BlobHeader &hdr);
+
+} // namespace state
@@ -1,66 +1,183 @@
 #include "app/router.hpp"
 #include "ha_mqtt.hpp"
-#include "app/entities.hpp"
+#include "app/app_config.hpp"
+#include "app/alloc_probe.hpp"
+#include "app/app_events.hpp"
+#include "app/deferred_log.hpp"
 #include "state_manager.hpp"
-#include <cstring>
-#include <cstdio>
-#include <string>
+#include <string_view>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
 
 namespace
 {
     static const char *TAG = "router";
 
-    void on_mqtt_msg(const char *topic, const char *data, int len)
+    // Incoming states are parsed right away and coalesced for
+    // kStateBatchWindowMs, then applied with one apply_entity_updates()
+    // call. A retained-message replay after reconnect thus costs one
+    // notification per batch instead of one per entity.
+    constexpr size_t kMaxPendingUpdates = app_events::kMaxEntitiesPerChange;
+
+    static portMUX_TYPE s_pending_mux = portMUX_INITIALIZER_UNLOCKED;
+    static state::EntityUpdate s_pending[kMaxPendingUpdates];
+    static size_t s_pending_count = 0;
+    static esp_timer_handle_t s_flush_timer = nullptr;
+
+    // Allocations seen on the state path (alloc_probe); it should
+    // never allocate once the model is loaded.
+    static std::uint32_t s_path_allocs = 0;
+
+    void report_allocs(const alloc_probe::Scope &probe, const char *where)
     {
-        if (!topic)
+        if (probe.count() == 0)
             return;
+        s_path_allocs += probe.count();
+        ESP_LOGW(TAG, "%s allocated %u times (state path total %u)",
+                 where,
+                 static_cast<unsigned>(probe.count()),
+                 static_cast<unsigned>(s_path_allocs));
+    }
 
-        ESP_LOGI(TAG, "MQTT RX topic='%s' payload='%.*s' (len=%d)",
-                 topic,
-                 len,
-                 (const char *)data,
-                 len);
+    void flush_pending_updates()
+    {
+        state::EntityUpdate batch[kMaxPendingUpdates];
+        size_t count = 0;
+
+        portENTER_CRITICAL(&s_pending_mux);
+        count = s_pending_count;
+        for (size_t i = 0; i < count; ++i)
+            batch[i] = s_pending[i];
+        s_pending_count = 0;
+        portEXIT_CRITICAL(&s_pending_mux);
+
+        if (count > 0)
+            (void)state::apply_entity_updates(batch, count);
+    }
 
-        const char prefix[] = "ha/state/";
-        const size_t pfx_len = sizeof(prefix) - 1;
-        if (std::strncmp(topic, prefix, pfx_len) != 0)
-            return;
-        const char *entity = topic + pfx_len;
+    void flush_timer_cb(void * /*arg*/)
+    {
+        // Only counts if the MQTT task has no scope open at the moment.
+        alloc_probe::Scope probe;
+        flush_pending_updates();
+        report_allocs(probe, "state batch flush");
+    }
 
-        if (data && len >= 0)
+    void queue_update(state::EntityHandle entity, const state::EntityState &value)
+    {
+        bool first = false;
+        bool full = false;
+
+        portENTER_CRITICAL(&s_pending_mux);
+        size_t i = 0;
+        while (i < s_pending_count && s_pending[i].entity != entity)
+            ++i;
+        if (i == s_pending_count && s_pending_count < kMaxPendingUpdates)
+            ++s_pending_count;
+        if (i < s_pending_count)
         {
-            std::string value(data, data + len);
-            state::set_entity_state(entity, value);
+            // Later message for the same entity wins.
+            s_pending[i].entity = entity;
+            s_pending[i].state = value;
         }
-    }
+        first = (s_pending_count == 1);
+        full = (s_pending_count == kMaxPendingUpdates);
+        portEXIT_CRITICAL(&s_pending_mux);
 
-} // namespace
+        if (full || !s_flush_timer)
+        {
+            if (s_flush_timer)
+                (void)esp_timer_stop(s_flush_timer);
+            flush_pending_updates();
+        }
+        else if (first)
+        {
+            (void)esp_timer_start_once(s_flush_timer,
+                                       static_cast<std::uint64_t>(app_config::kStateBatchWindowMs) * 1000);
+        }
+    }
 
-namespace router
-{
+    // Command senders, indexed by DomainCommand; nullptr for read-only
+    // domains.
+    using CommandFn = esp_err_t (*)(const state::Entity &e);
 
-    esp_err_t start()
+    esp_err_t send_toggle(const state::Entity &e)
     {
-        const auto &ents = state::entities();
-        bool use_state_entities = !ents.empty();
-
-        // Ограничиваем количество сущностей для подписки, чтобы не выходить
-        // за пределы внутренних структур MQTT-клиента.
-        constexpr int kMaxTrackedEntities = 8;
-        int count = 0;
+        return ha_mqtt::publish_toggle(e.id.data());
+    }
 
-        if (use_state_entities)
+    constexpr CommandFn kCommands[] = {
+        nullptr,      // DomainCommand::None
+        &send_toggle, // DomainCommand::Toggle
+    };
+    static_assert(sizeof(kCommands) / sizeof(kCommands[0]) == static_cast<size_t>(state::DomainCommand::Toggle) + 1,
+                  "kCommands out of sync with DomainCommand");
+
+    // Two wildcard filters cover every entity, however many the model
+    // has; on_mqtt_msg() resolves the id through the entity index and
+    // drops topics for entities it does not know.
+    constexpr esp_mqtt_topic_t kSubscriptions[] = {
+        {"ha/state/#", 2},
+        // Attribute lists ("brightness=128;color_temp=370").
+        {"ha/attr/#", 1},
+    };
+
+    void handle_message(std::string_view topic, std::string_view data)
+    {
+        // Deferred: this runs for every retained message after a reconnect.
+        DLOGI(deferred_log::Module::Router, "MQTT RX topic='%s' payload='%s' (len=%d)",
+              topic,
+              data,
+              static_cast<int>(data.size()));
+
+        constexpr std::string_view kAttrPrefix = "ha/attr/";
+        if (topic.substr(0, kAttrPrefix.size()) == kAttrPrefix)
         {
-            count = static_cast<int>(ents.size());
+            // Attributes change rarely (dimming, setpoints); applied directly.
+            const state::EntityHandle entity = state::find_handle(topic.substr(kAttrPrefix.size()));
+            if (entity != state::kInvalidEntity)
+            {
+                (void)state::set_entity_attributes(entity, data);
+            }
+            return;
         }
-        else
+
+        constexpr std::string_view kStatePrefix = "ha/state/";
+        if (topic.substr(0, kStatePrefix.size()) != kStatePrefix)
+            return;
+        const std::string_view entity_id = topic.substr(kStatePrefix.size());
+
+        const state::ModelPtr model = state::snapshot();
+        const state::Entity *e = model->find(model->index.find(entity_id));
+        if (!e)
         {
-            count = app::g_entity_count;
+            ESP_LOGD(TAG, "state for unknown entity '%.*s'", static_cast<int>(entity_id.size()), entity_id.data());
+            return;
         }
-        if (count > kMaxTrackedEntities)
-            count = kMaxTrackedEntities;
+        const state::StateShape shape = state::domain_traits(e->domain).shape;
+        queue_update(e->handle, state::parse_entity_state(data, shape));
+    }
+
+    // Topic and payload point into the MQTT client's buffer and are
+    // parsed in place. The probe also covers inline flushes (full batch,
+    // no timer) and ha/attr updates; ENTITIES_CHANGED is a merge slot
+    // (app_events), so posting it does not allocate either, and the
+    // history store is allocated at startup (state::init_history()).
+    void on_mqtt_msg(std::string_view topic, std::string_view data)
+    {
+        alloc_probe::Scope probe;
+        handle_message(topic, data);
+        report_allocs(probe, "MQTT message");
+    }
 
+} // namespace
+
+namespace router
+{
+
+    esp_err_t start()
+    {
         esp_err_t err = ha_mqtt::start();
         if (err != ESP_OK)
         {
@@ -68,25 +185,26 @@ namespace router
             return err;
         }
 
-        ha_mqtt::set_message_handler(&on_mqtt_msg);
-
-        for (int i = 0; i < count; ++i)
+        if (!s_flush_timer)
         {
-            const char *entity_id = nullptr;
-            if (use_state_entities)
+            esp_timer_create_args_t args = {};
+            args.callback = &flush_timer_cb;
+            args.name = "state_batch";
+            if (esp_timer_create(&args, &s_flush_timer) != ESP_OK)
             {
-                entity_id = ents[static_cast<size_t>(i)].id.c_str();
-            }
-            else
-            {
-                entity_id = app::g_entities[i].entity_id;
+                ESP_LOGW(TAG, "batch timer create failed; applying updates one by one");
+                s_flush_timer = nullptr;
             }
+        }
 
-            char topic[128];
-            std::snprintf(topic, sizeof(topic), "ha/state/%s", entity_id);
-            ha_mqtt::subscribe(topic, 2);
+        if (!alloc_probe::available())
+        {
+            ESP_LOGI(TAG, "CONFIG_HEAP_USE_HOOKS is off: MQTT state path allocations are not checked");
         }
 
+        ha_mqtt::set_message_handler(&on_mqtt_msg);
+        (void)ha_mqtt::set_subscriptions(kSubscriptions, static_cast<int>(sizeof(kSubscriptions) / sizeof(kSubscriptions[0])));
+
         return ESP_OK;
     }
 
@@ -95,9 +213,22 @@ namespace router
         return ha_mqtt::is_connected();
     }
 
-    esp_err_t toggle(const char *entity_id)
+    esp_err_t toggle(state::EntityHandle entity)
     {
-        esp_err_t err = ha_mqtt::publish_toggle(entity_id);
+        // The handle is resolved to the HA id only here, at the MQTT boundary.
+        const state::ModelPtr model = state::snapshot();
+        const state::Entity *e = model->find(entity);
+        if (!e)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+        const CommandFn send = kCommands[static_cast<size_t>(state::domain_traits(e->domain).command)];
+        if (!send)
+        {
+            ESP_LOGW(TAG, "%s is read-only", e->id.data());
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        esp_err_t err = send(*e);
         if (err != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed to publish toggle: %s", esp_err_to_name(err));
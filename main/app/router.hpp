@@ -1,6 +1,7 @@
 #pragma once
 
 #include "esp_err.h"
+#include "state_manager.hpp"
 
 namespace router {
 
@@ -10,8 +11,9 @@ esp_err_t start();
 // Current connectivity status.
 bool is_connected();
 
-// UI action: toggle entity via server.
-esp_err_t toggle(const char* entity_id);
+// UI action: toggle entity via server; ESP_ERR_NOT_SUPPORTED for
+// read-only domains (sensors, climate).
+esp_err_t toggle(state::EntityHandle entity);
 
 } // namespace router
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace state
+{
+
+    // Single-value seqlock for small trivially copyable structs.
+    //
+    // Writers copy the value inside a short critical section (so a writer
+    // is never preempted half way) and bump the sequence counter around
+    // it. Readers never block the writer: they copy the value and retry if
+    // the counter was odd or changed meanwhile. Neither side allocates.
+    template <typename T>
+    class Seqlock
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Seqlock value must be trivially copyable");
+
+    public:
+        void store(const T &value)
+        {
+            portENTER_CRITICAL(&mux_);
+            const unsigned seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&value_, &value, sizeof(T));
+            seq_.store(seq + 2, std::memory_order_release);
+            portEXIT_CRITICAL(&mux_);
+        }
+
+        T load() const
+        {
+            T out;
+            unsigned before = 0;
+            unsigned after = 0;
+            do
+            {
+                before = seq_.load(std::memory_order_acquire);
+                std::memcpy(&out, &value_, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = seq_.load(std::memory_order_relaxed);
+            } while ((before & 1u) != 0 || before != after);
+            return out;
+        }
+
+    private:
+        T value_{};
+        std::atomic<unsigned> seq_{0};
+        portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+    };
+
+} // namespace state
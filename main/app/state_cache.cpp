@@ -0,0 +1,224 @@
+#include "state_cache.hpp"
+
+#include "model_blob.hpp"
+#include "state_manager.hpp"
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace state_cache
+{
+
+    namespace
+    {
+        static const char *TAG = "state_cache";
+        static const char *kPartitionLabel = "state";
+
+        // The partition is split into two slots written alternately, so a
+        // power loss during a save leaves the previous snapshot intact.
+        // Each slot holds one model blob (model_blob.hpp); its header
+        // carries the sequence number used to pick the newest slot.
+        constexpr int kSlotCount = 2;
+
+        // Newest valid slot, as found by load() or written by save().
+        static int s_active_slot = -1;
+        static std::uint32_t s_active_sequence = 0;
+        static std::uint32_t s_active_size = 0;
+        static std::uint32_t s_active_crc = 0;
+
+        // Mapping of a slot held by a loaded model (its strings point into
+        // flash). Such a slot must not be erased until the model is gone.
+        static std::weak_ptr<const void> s_mapped[kSlotCount];
+
+        static const esp_partition_t *find_partition()
+        {
+            const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                   ESP_PARTITION_SUBTYPE_ANY,
+                                                                   kPartitionLabel);
+            if (!part)
+            {
+                ESP_LOGW(TAG, "partition '%s' not found; warm boot disabled", kPartitionLabel);
+            }
+            return part;
+        }
+
+        static size_t slot_size(const esp_partition_t *part)
+        {
+            // Slots start on an erase-block boundary.
+            const size_t block = part->erase_size ? part->erase_size : 4096;
+            return (part->size / kSlotCount) / block * block;
+        }
+
+        static bool read_header(const esp_partition_t *part, int slot, state::BlobHeader &hdr)
+        {
+            const size_t offset = static_cast<size_t>(slot) * slot_size(part);
+            if (esp_partition_read(part, offset, &hdr, sizeof(hdr)) != ESP_OK)
+            {
+                return false;
+            }
+            return hdr.magic == state::kBlobMagic &&
+                   hdr.version == state::kBlobVersion &&
+                   hdr.total_size >= sizeof(state::BlobHeader) &&
+                   hdr.total_size <= slot_size(part);
+        }
+
+        // Map one slot and publish it; the model keeps the mapping alive.
+        static bool load_slot(const esp_partition_t *part, int slot, const state::BlobHeader &hdr)
+        {
+            const void *ptr = nullptr;
+            esp_partition_mmap_handle_t handle{};
+            esp_err_t err = esp_partition_mmap(part,
+                                               static_cast<size_t>(slot) * slot_size(part),
+                                               hdr.total_size,
+                                               ESP_PARTITION_MMAP_DATA,
+                                               &ptr,
+                                               &handle);
+            if (err != ESP_OK)
+            {
+                ESP_LOGW(TAG, "slot %d: mmap failed: %s", slot, esp_err_to_name(err));
+                return false;
+            }
+
+            std::shared_ptr<const void> mapping(ptr, [handle](const void *)
+                                                { esp_partition_munmap(handle); });
+            s_mapped[slot] = mapping;
+            return state::load_model_blob(ptr, hdr.total_size, std::move(mapping));
+        }
+
+    } // namespace
+
+    bool load()
+    {
+        const esp_partition_t *part = find_partition();
+        if (!part)
+        {
+            return false;
+        }
+
+        const std::int64_t t0 = esp_timer_get_time();
+
+        state::BlobHeader hdr[kSlotCount] = {};
+        bool valid[kSlotCount] = {};
+        for (int i = 0; i < kSlotCount; ++i)
+        {
+            valid[i] = read_header(part, i, hdr[i]);
+        }
+
+        // Newest first; fall back to the older slot if the newer is corrupt.
+        int order[kSlotCount] = {0, 1};
+        if (!valid[0] ||
+            (valid[1] && static_cast<std::int32_t>(hdr[1].sequence - hdr[0].sequence) > 0))
+        {
+            order[0] = 1;
+            order[1] = 0;
+        }
+
+        for (int slot : order)
+        {
+            if (!valid[slot] || !load_slot(part, slot, hdr[slot]))
+            {
+                continue;
+            }
+
+            s_active_slot = slot;
+            s_active_sequence = hdr[slot].sequence;
+            s_active_size = hdr[slot].total_size;
+            s_active_crc = hdr[slot].crc;
+
+            ESP_LOGI(TAG, "warm boot from slot %d (seq %u, %u B) in %lld us",
+                     slot,
+                     static_cast<unsigned>(hdr[slot].sequence),
+                     static_cast<unsigned>(hdr[slot].total_size),
+                     static_cast<long long>(esp_timer_get_time() - t0));
+            return true;
+        }
+
+        ESP_LOGI(TAG, "no stored snapshot");
+        return false;
+    }
+
+    esp_err_t save()
+    {
+        const esp_partition_t *part = find_partition();
+        if (!part)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        const state::ModelPtr model = state::snapshot();
+        if (model->entities.empty())
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        const std::int64_t t0 = esp_timer_get_time();
+        std::string blob;
+        state::encode_model_blob(*model, blob);
+        const std::int64_t encode_us = esp_timer_get_time() - t0;
+        if (blob.size() > slot_size(part))
+        {
+            ESP_LOGW(TAG, "snapshot of %d B does not fit a %d B slot",
+                     static_cast<int>(blob.size()),
+                     static_cast<int>(slot_size(part)));
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        state::BlobHeader hdr{};
+        std::memcpy(&hdr, blob.data(), sizeof(hdr));
+        if (s_active_slot >= 0 && hdr.total_size == s_active_size && hdr.crc == s_active_crc)
+        {
+            ESP_LOGD(TAG, "snapshot unchanged, not writing");
+            return ESP_OK;
+        }
+        hdr.sequence = s_active_sequence + 1;
+
+        const int slot = (s_active_slot + 1) % kSlotCount;
+        if (!s_mapped[slot].expired())
+        {
+            // The boot model still reads its strings from this slot.
+            ESP_LOGI(TAG, "slot %d still in use by a loaded model; saving later", slot);
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        const size_t base = static_cast<size_t>(slot) * slot_size(part);
+        const size_t block = part->erase_size ? part->erase_size : 4096;
+        const size_t erase_len = (blob.size() + block - 1) / block * block;
+
+        // Header goes last: until it is written the slot reads as empty.
+        esp_err_t err = esp_partition_erase_range(part, base, erase_len);
+        if (err == ESP_OK)
+        {
+            err = esp_partition_write(part, base + sizeof(hdr), blob.data() + sizeof(hdr), blob.size() - sizeof(hdr));
+        }
+        if (err == ESP_OK)
+        {
+            err = esp_partition_write(part, base, &hdr, sizeof(hdr));
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "writing slot %d failed: %s", slot, esp_err_to_name(err));
+            return err;
+        }
+
+        s_active_slot = slot;
+        s_active_sequence = hdr.sequence;
+        s_active_size = hdr.total_size;
+        s_active_crc = hdr.crc;
+
+        ESP_LOGI(TAG, "saved model v%u to slot %d (seq %u, %u B): encode %lld us, total %lld us",
+                 static_cast<unsigned>(model->version),
+                 slot,
+                 static_cast<unsigned>(hdr.sequence),
+                 static_cast<unsigned>(hdr.total_size),
+                 static_cast<long long>(encode_us),
+                 static_cast<long long>(esp_timer_get_time() - t0));
+        return ESP_OK;
+    }
+
+} // namespace state_cache
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Last bootstrapped state model kept in the "state" flash partition, so a
+// boot can show the room pages before Wi-Fi and HA are reachable. The live
+// bootstrap then reconciles with it like any re-bootstrap (MODEL_UPDATED).
+namespace state_cache
+{
+
+    // Publish the newest valid snapshot through state_manager (announced
+    // like a bootstrap). The slot is memory-mapped and the model reads its
+    // strings from flash in place. Returns false if there is none or it
+    // is corrupt.
+    bool load();
+
+    // Store the current model (areas, entities, last-known states). Does
+    // nothing if it equals the newest stored snapshot. Call from the
+    // bootstrap path only; saves are not serialized against each other.
+    esp_err_t save();
+
+} // namespace state_cache
@@ -2,13 +2,22 @@
 
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "app/app_config.hpp"
 #include "app/app_events.hpp"
+#include "app/bootstrap_csv.hpp"
+#include "app/model_blob.hpp"
+#include "app/seqlock.hpp"
 
 #include <unordered_map>
-#include <array>
-#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
 #include <cstring>
 #include <mutex>
+#include <optional>
+#include <string_view>
 
 namespace state
 {
@@ -18,323 +27,724 @@ namespace state
 
         constexpr const char *TAG = "state";
 
-        std::vector<Area> g_areas;
-        std::vector<Entity> g_entities;
-        std::unordered_map<std::string, size_t> g_area_index_by_id;
-        std::unordered_map<std::string, size_t> g_entity_index_by_id;
-        WeatherState g_weather;
-        DhtState g_dht;
-        ClockState g_clock;
+        // Used only while assembling a model, to drop duplicate rows.
+        using IndexById = std::unordered_map<std::string_view, size_t>;
 
-        struct ListenerEntry
+        // Published model. Replaced atomically by end_csv(); readers keep
+        // the previous one alive through their snapshot until they drop it.
+        ModelPtr g_model = std::make_shared<const Model>();
+
+        Seqlock<WeatherState> g_weather;
+        Seqlock<DhtState> g_dht;
+        Seqlock<ClockState> g_clock;
+
+        // History of DHT, weather and numeric entity values; buckets are
+        // allocated by init_history(). Samples before that are dropped.
+        TimeSeriesStore g_history;
+
+        void record_history(const SeriesKey &key, float value)
         {
-            int id;
-            std::string entity_id;
-            EntityListener cb;
-        };
+            g_history.record(key, value, esp_timer_get_time());
+        }
+
+        // Entity listeners; guarded by g_mutex.
+        ListenerTable g_listeners;
+
+        std::atomic<UpdateHookFn> g_update_hook{nullptr};
 
-        std::vector<ListenerEntry> g_listeners;
-        int g_next_listener_id = 1;
+        void run_update_hook(const Model &model, const EntityHandle *changed, size_t count)
+        {
+            const UpdateHookFn hook = g_update_hook.load(std::memory_order_acquire);
+            if (hook && count > 0)
+                hook(model, changed, count);
+        }
+
+        // Serializes writers (entity state updates, listener registry).
+        // Readers of the model and of the seqlocked values never take it.
         std::mutex g_mutex;
 
-        static void trim(std::string &s)
+        // Model assembled by begin_csv()/feed_csv()/end_csv(). Only touched
+        // by the bootstrap task, published by end_csv().
+        struct Staging
+        {
+            std::shared_ptr<Model> model;
+            IndexById area_index_by_id;
+            IndexById entity_index_by_id;
+            std::int64_t start_us = 0;
+            size_t internal_free_at_start = 0;
+        };
+
+        Staging g_staging;
+        std::optional<BootstrapCsvParser> g_parser;
+
+        // Give `e` a slot for every key in `keys` (values[key] or unset),
+        // appended to the model's attribute pool in key order.
+        void append_attributes(Model &m, Entity &e, AttrMask keys, const float *values)
         {
-            size_t start = 0;
-            while (start < s.size() && (s[start] == ' ' || s[start] == '\t' || s[start] == '\r'))
-                ++start;
-            size_t end = s.size();
-            while (end > start && (s[end - 1] == ' ' || s[end - 1] == '\t' || s[end - 1] == '\r'))
-                --end;
-            if (start == 0 && end == s.size())
+            e.attr_begin = static_cast<std::uint32_t>(m.attrs.size());
+            e.attr_count = 0;
+            for (unsigned k = 0; k < static_cast<unsigned>(AttrKey::Count); ++k)
+            {
+                if (keys & attr_bit(static_cast<AttrKey>(k)))
+                {
+                    m.attrs.emplace_back(static_cast<AttrKey>(k), values ? values[k] : NAN);
+                    ++e.attr_count;
+                }
+            }
+        }
+
+        // Same keys and values (unset equals unset).
+        bool attributes_equal(const Model &ma, const Entity &a, const Model &mb, const Entity &b)
+        {
+            if (a.attr_count != b.attr_count)
+                return false;
+            for (std::uint8_t i = 0; i < a.attr_count; ++i)
+            {
+                const AttrSlot &x = ma.attrs[a.attr_begin + i];
+                const AttrSlot &y = mb.attrs[b.attr_begin + i];
+                const float vx = x.load();
+                const float vy = y.load();
+                if (x.key() != y.key() || (vx != vy && !(std::isnan(vx) && std::isnan(vy))))
+                    return false;
+            }
+            return true;
+        }
+
+        void add_csv_row(const BootstrapCsvParser::Row &row, void *ctx)
+        {
+            Staging &st = *static_cast<Staging *>(ctx);
+            Model &m = *st.model;
+            const std::string_view area_id = row[BootstrapCsvParser::AreaId];
+            const std::string_view entity_id = row[BootstrapCsvParser::EntityId];
+
+            if (entity_id.empty())
+                return;
+
+            // Area
+            if (st.area_index_by_id.find(area_id) == st.area_index_by_id.end())
+            {
+                Area a;
+                a.id = m.strings.intern(area_id);
+                a.name = m.strings.intern(row[BootstrapCsvParser::AreaName]);
+                st.area_index_by_id.emplace(a.id, m.areas.size());
+                m.areas.push_back(a);
+            }
+
+            // Entity
+            if (st.entity_index_by_id.find(entity_id) != st.entity_index_by_id.end())
+            {
+                // duplicate id, skip
+                return;
+            }
+            if (m.entities.size() >= kInvalidEntity)
+            {
+                ESP_LOGW(TAG, "too many entities, skipping '%.*s'",
+                         static_cast<int>(entity_id.size()), entity_id.data());
                 return;
-            s.assign(s.begin() + static_cast<long>(start), s.begin() + static_cast<long>(end));
+            }
+
+            Entity e;
+            e.handle = static_cast<EntityHandle>(m.entities.size());
+            e.id = m.strings.intern(entity_id);
+            e.name = m.strings.intern(row[BootstrapCsvParser::EntityName]);
+            e.domain = parse_entity_domain(entity_id);
+            const DomainTraits &traits = domain_traits(e.domain);
+            e.state.store(parse_entity_state(row[BootstrapCsvParser::State], traits.shape));
+            e.area_id = m.strings.intern(area_id);
+
+            // Slots for the domain's keys plus any other reported key.
+            float values[static_cast<size_t>(AttrKey::Count)];
+            std::fill(std::begin(values), std::end(values), NAN);
+            AttrMask keys = traits.default_attrs;
+            std::string_view attrs = row[BootstrapCsvParser::Attributes];
+            AttrKey key;
+            float value = 0.0f;
+            while (next_attribute(attrs, key, value))
+            {
+                keys |= attr_bit(key);
+                values[static_cast<size_t>(key)] = value;
+            }
+            append_attributes(m, e, keys, values);
+
+            st.entity_index_by_id.emplace(e.id, m.entities.size());
+            m.entities.push_back(std::move(e));
         }
 
-        static std::vector<std::string> split_lines(const char *data, size_t len)
+        // Call the listeners of one entity, outside g_mutex.
+        void notify_listeners(const Entity &e)
         {
-            std::vector<std::string> lines;
-            if (!data || len == 0)
-                return lines;
+            EntityListener listeners_to_call[kMaxListenersPerEntity];
+            size_t listener_count = 0;
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                listener_count = g_listeners.collect(e.handle, listeners_to_call, kMaxListenersPerEntity);
+            }
 
-            size_t start = 0;
-            for (size_t i = 0; i < len; ++i)
+            for (size_t i = 0; i < listener_count; ++i)
             {
-                char c = data[i];
-                if (c == '\n')
+                listeners_to_call[i].fn(e, listeners_to_call[i].ctx);
+            }
+        }
+
+        // Lay out a freshly parsed model on top of the current one: known
+        // ids keep their handle and state generation, ids that vanished
+        // stay as tombstones, new ids are appended. Handles of entities
+        // whose state differs from the current model go to `changed`.
+        // Returns the number of added and removed entities. Looks ids up
+        // in fresh.index, which must cover fresh.entities; it is stale
+        // afterwards.
+        void reconcile(const Model &current,
+                       Model &fresh,
+                       std::vector<EntityHandle> &changed,
+                       size_t &added,
+                       size_t &removed)
+        {
+            std::vector<Entity> merged;
+            merged.reserve(current.entities.size() + fresh.entities.size());
+            std::vector<bool> taken(fresh.entities.size(), false);
+            added = 0;
+            removed = 0;
+
+            for (const Entity &old : current.entities)
+            {
+                Entity e;
+                const EntityHandle at = fresh.index.find(old.id);
+                if (at != kInvalidEntity)
                 {
-                    size_t line_len = (i > start) ? (i - start) : 0;
-                    if (line_len > 0)
+                    const Entity &src = fresh.entities[at];
+                    const EntityState now = src.state.load();
+                    const bool attrs_changed = !attributes_equal(current, old, fresh, src);
+                    e = src;
+                    e.state = old.state; // keep the generation sequence
+                    if (old.removed || e.state.load() != now)
+                    {
+                        e.state.store(now);
+                        changed.push_back(old.handle);
+                    }
+                    else if (attrs_changed)
                     {
-                        std::string line(data + start, line_len);
-                        lines.push_back(std::move(line));
+                        // Same state; the new generation makes widgets
+                        // re-read the attributes.
+                        e.state.store(now);
+                        changed.push_back(old.handle);
                     }
-                    start = i + 1;
+                    if (old.removed)
+                        ++added;
+                    taken[at] = true;
                 }
+                else
+                {
+                    // Strings must move to the new arena; the old one goes
+                    // away with the previous model.
+                    e = old;
+                    e.id = fresh.strings.intern(old.id);
+                    e.name = fresh.strings.intern(old.name);
+                    e.area_id = fresh.strings.intern(old.area_id);
+                    e.attr_begin = 0;
+                    e.attr_count = 0;
+                    if (!old.removed)
+                        ++removed;
+                    e.removed = true;
+                }
+                e.handle = old.handle;
+                merged.push_back(std::move(e));
             }
-            // last line (no trailing '\n')
-            if (start < len)
+
+            for (size_t i = 0; i < fresh.entities.size(); ++i)
             {
-                std::string line(data + start, len - start);
-                lines.push_back(std::move(line));
+                if (taken[i])
+                    continue;
+                if (merged.size() >= kInvalidEntity)
+                {
+                    ESP_LOGW(TAG, "entity handles exhausted, dropping new entities");
+                    break;
+                }
+                Entity e = fresh.entities[i];
+                e.handle = static_cast<EntityHandle>(merged.size());
+                merged.push_back(std::move(e));
+                ++added;
             }
-            return lines;
+
+            fresh.entities.swap(merged);
         }
 
-        static bool split_csv_line(const std::string &line, std::array<std::string, 5> &fields_out)
+        void publish(ModelPtr model)
         {
-            fields_out = {};
-            size_t field_idx = 0;
-            size_t start = 0;
-            for (size_t i = 0; i <= line.size(); ++i)
+            std::atomic_store_explicit(&g_model, std::move(model), std::memory_order_release);
+        }
+
+        // Reconcile a fully assembled model with the current one, build its
+        // index (unless the loader did and nothing moved) and dirty set,
+        // publish it and post MODEL_UPDATED. Entity i must have handle i.
+        void install(const std::shared_ptr<Model> &model,
+                     size_t &added,
+                     size_t &removed,
+                     bool &reconciled)
+        {
+            added = 0;
+            removed = 0;
+            reconciled = false;
             {
-                bool at_end = (i == line.size());
-                if (at_end || line[i] == ',')
+                // Writers update the published model under g_mutex; holding
+                // it here means no state update lands in the old model
+                // after its states were copied.
+                std::lock_guard<std::mutex> lock(g_mutex);
+                const ModelPtr current = snapshot();
+                std::vector<EntityHandle> changed;
+                bool indexed = model->index.capacity() > 0;
+                if (!current->entities.empty())
                 {
-                    if (field_idx >= fields_out.size())
-                    {
-                        // too many fields
-                        return false;
-                    }
-                    std::string f = line.substr(start, i - start);
-                    trim(f);
-                    fields_out[field_idx++] = std::move(f);
-                    start = i + 1;
+                    if (!indexed)
+                        (void)model->index.build(model->entities.data(), model->entities.size());
+                    reconcile(*current, *model, changed, added, removed);
+                    reconciled = true;
+                    indexed = false;
                 }
+
+                if (!indexed && !model->index.build(model->entities.data(), model->entities.size()))
+                {
+                    ESP_LOGE(TAG, "no memory for entity index");
+                }
+                model->dirty.init(model->entities.size());
+                for (EntityHandle h : changed)
+                {
+                    model->dirty.mark(h);
+                }
+                model->version = current->version + 1;
+                publish(model);
+            }
+
+            // Removed entities give their history slots back.
+            for (const Entity &e : model->entities)
+            {
+                if (e.removed)
+                    g_history.forget(SeriesKey{SeriesSource::Entity, e.handle});
             }
-            return field_idx == fields_out.size();
+            (void)app_events::post<app_events::MODEL_UPDATED>({esp_timer_get_time()});
         }
 
     } // namespace
 
-    bool init_from_csv(const char *csv, size_t len)
+    void begin_csv()
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
+        g_staging = Staging{};
+        g_staging.model = std::make_shared<Model>();
+        g_staging.start_us = esp_timer_get_time();
+        g_staging.internal_free_at_start = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        g_parser.emplace(&add_csv_row, &g_staging);
+    }
 
-        g_areas.clear();
-        g_entities.clear();
-        g_area_index_by_id.clear();
-        g_entity_index_by_id.clear();
+    void feed_csv(const char *data, size_t len)
+    {
+        if (g_parser)
+            g_parser->feed(data, len);
+    }
 
-        if (!csv || len == 0)
+    bool end_csv()
+    {
+        if (!g_parser)
+            return false;
+
+        const bool ok = g_parser->finish();
+        const size_t rows = g_parser->rows();
+        const size_t skipped = g_parser->skipped();
+        g_parser.reset();
+
+        std::shared_ptr<Model> model = std::move(g_staging.model);
+        if (!ok || !model)
         {
-            ESP_LOGW(TAG, "init_from_csv: empty input");
+            // Keep whatever model is current (empty on first boot).
+            g_staging = Staging{};
+            ESP_LOGW(TAG, "bootstrap CSV: header not found or invalid");
             return false;
         }
 
-        auto lines = split_lines(csv, len);
-        if (lines.empty())
+        size_t added = 0;
+        size_t removed = 0;
+        bool reconciled = false;
+        install(model, added, removed, reconciled);
+        const ModelPtr published = model;
+
+        const std::int64_t elapsed_us = esp_timer_get_time() - g_staging.start_us;
+        // Internal RAM taken by the new model (vectors, index); id/name
+        // bytes live in the arena, normally in PSRAM. The previous model
+        // may still be held by a reader, so treat this as an upper bound.
+        const size_t internal_free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        const long internal_used = static_cast<long>(g_staging.internal_free_at_start) -
+                                   static_cast<long>(internal_free_now);
+        g_staging = Staging{};
+
+        const Model &m = *published;
+        if (reconciled)
+        {
+            ESP_LOGI(TAG, "model v%u reconciled: %d added, %d removed",
+                     static_cast<unsigned>(m.version),
+                     static_cast<int>(added),
+                     static_cast<int>(removed));
+        }
+        ESP_LOGI(TAG, "parsed %d areas, %d entities (%d rows, %d skipped) in %lld us",
+                 static_cast<int>(m.areas.size()),
+                 static_cast<int>(m.entities.size()),
+                 static_cast<int>(rows),
+                 static_cast<int>(skipped),
+                 static_cast<long long>(elapsed_us));
+        ESP_LOGI(TAG, "model memory: internal %ld B (%ld B/entity), strings %d unique / %d B in %s",
+                 internal_used,
+                 m.entities.empty() ? 0L : internal_used / static_cast<long>(m.entities.size()),
+                 static_cast<int>(m.strings.strings()),
+                 static_cast<int>(m.strings.bytes_reserved()),
+                 m.strings.in_psram() ? "PSRAM" : "internal RAM");
+
+        // One pass over every id through the index: cheap enough to run on
+        // each bootstrap and gives the on-device lookup cost in the log.
+        if (!m.entities.empty())
+        {
+            const std::int64_t t0 = esp_timer_get_time();
+            size_t misses = 0;
+            for (const Entity &e : m.entities)
+            {
+                if (!e.removed && m.index.find(e.id) != e.handle)
+                    ++misses;
+            }
+            const std::int64_t lookup_us = esp_timer_get_time() - t0;
+            ESP_LOGI(TAG, "entity index: %d slots / %d B, probe avg %.2f max %d, lookup %lld ns avg%s",
+                     static_cast<int>(m.index.capacity()),
+                     static_cast<int>(m.index.bytes()),
+                     static_cast<double>(m.index.avg_probe()),
+                     static_cast<int>(m.index.max_probe()),
+                     static_cast<long long>(lookup_us * 1000 / static_cast<std::int64_t>(m.entities.size())),
+                     misses ? " (MISMATCH)" : "");
+        }
+        return true;
+    }
+
+    bool load_model_blob(const void *data, size_t size, std::shared_ptr<const void> backing)
+    {
+        const std::int64_t t0 = esp_timer_get_time();
+        const BlobHeader *hdr = validate_model_blob(data, size);
+        if (!hdr)
         {
-            ESP_LOGW(TAG, "init_from_csv: no lines");
+            ESP_LOGW(TAG, "model blob: invalid image (%d B)", static_cast<int>(size));
             return false;
         }
+        const std::int64_t validated_us = esp_timer_get_time() - t0;
+
+        const char *base = static_cast<const char *>(data);
+        const auto *areas = reinterpret_cast<const BlobArea *>(base + hdr->areas_offset);
+        const auto *entities = reinterpret_cast<const BlobEntity *>(base + hdr->entities_offset);
 
-        // Find header line
-        size_t header_idx = 0;
-        for (; header_idx < lines.size(); ++header_idx)
+        auto model = std::make_shared<Model>();
+        model->backing = std::move(backing);
+        model->areas.reserve(hdr->area_count);
+        for (std::uint32_t i = 0; i < hdr->area_count; ++i)
         {
-            std::string hdr = lines[header_idx];
-            trim(hdr);
-            if (!hdr.empty())
-                break;
+            model->areas.push_back(Area{blob_string(*hdr, areas[i].id), blob_string(*hdr, areas[i].name)});
         }
-        if (header_idx >= lines.size())
+
+        const size_t count = std::min<size_t>(hdr->entity_count, kInvalidEntity);
+        model->entities.reserve(count);
+        for (size_t i = 0; i < count; ++i)
         {
-            ESP_LOGW(TAG, "init_from_csv: header not found");
-            return false;
+            const BlobEntity &be = entities[i];
+            Entity e;
+            e.handle = static_cast<EntityHandle>(i);
+            e.id = blob_string(*hdr, be.id);
+            e.name = blob_string(*hdr, be.name);
+            e.area_id = model->areas[be.area].id;
+            e.domain = static_cast<EntityDomain>(be.domain);
+            // Values are not in the blob; the live bootstrap fills them.
+            append_attributes(*model, e, domain_traits(e.domain).default_attrs, nullptr);
+
+            EntityState st;
+            st.kind = static_cast<StateKind>(be.kind);
+            st.mode = static_cast<StateMode>(be.mode);
+            st.value = be.value;
+            e.state.store(st);
+
+            model->entities.push_back(std::move(e));
         }
 
-        std::array<std::string, 5> fields;
-        if (!split_csv_line(lines[header_idx], fields))
+        // The model's own index doubles as the duplicate check, so there is
+        // no per-entity map on this path. encode_model_blob() writes the ids
+        // of a published model, which are unique; an image with a repeated
+        // id is treated as corrupt.
+        if (!model->index.build(model->entities.data(), model->entities.size()))
         {
-            ESP_LOGW(TAG, "init_from_csv: failed to parse header");
+            ESP_LOGE(TAG, "model blob: no memory for entity index");
             return false;
         }
-
-        auto eq_nocase = [](const std::string &a, const char *b)
+        for (const Entity &e : model->entities)
         {
-            size_t blen = std::strlen(b);
-            if (a.size() != blen)
-                return false;
-            for (size_t i = 0; i < blen; ++i)
+            if (model->index.find(e.id) != e.handle)
             {
-                if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
-                    return false;
+                ESP_LOGW(TAG, "model blob: duplicate id '%.*s'", static_cast<int>(e.id.size()), e.id.data());
+                return false;
             }
-            return true;
-        };
+        }
 
-        if (!eq_nocase(fields[0], "AREA_ID") ||
-            !eq_nocase(fields[1], "AREA_NAME") ||
-            !eq_nocase(fields[2], "ENTITY_ID") ||
-            !eq_nocase(fields[3], "ENTITY_NAME") ||
-            !eq_nocase(fields[4], "STATE"))
+        size_t added = 0;
+        size_t removed = 0;
+        bool reconciled = false;
+        install(model, added, removed, reconciled);
+
+        ESP_LOGI(TAG, "model v%u from blob: %d areas, %d entities in %lld us (validate %lld us), strings in place",
+                 static_cast<unsigned>(model->version),
+                 static_cast<int>(model->areas.size()),
+                 static_cast<int>(model->entities.size()),
+                 static_cast<long long>(esp_timer_get_time() - t0),
+                 static_cast<long long>(validated_us));
+        if (reconciled)
         {
-            ESP_LOGW(TAG, "init_from_csv: unexpected header '%s'", lines[header_idx].c_str());
-            return false;
+            ESP_LOGI(TAG, "model v%u reconciled: %d added, %d removed",
+                     static_cast<unsigned>(model->version),
+                     static_cast<int>(added),
+                     static_cast<int>(removed));
         }
+        return true;
+    }
 
-        // Parse data lines
-        for (size_t line_idx = header_idx + 1; line_idx < lines.size(); ++line_idx)
+    bool init_from_csv(const char *csv, size_t len)
+    {
+        if (!csv || len == 0)
         {
-            std::string line = lines[line_idx];
-            trim(line);
-            if (line.empty())
-                continue;
-
-            std::array<std::string, 5> cols;
-            if (!split_csv_line(line, cols))
-            {
-                ESP_LOGW(TAG, "init_from_csv: skip malformed line %d: '%s'", static_cast<int>(line_idx), line.c_str());
-                continue;
-            }
+            ESP_LOGW(TAG, "init_from_csv: empty input");
+            publish(std::make_shared<const Model>());
+            return false;
+        }
 
-            const std::string &area_id = cols[0];
-            const std::string &area_name = cols[1];
-            const std::string &entity_id = cols[2];
-            const std::string &entity_name = cols[3];
-            const std::string &state = cols[4];
+        begin_csv();
+        feed_csv(csv, len);
+        return end_csv();
+    }
 
-            if (entity_id.empty())
-                continue;
+    bool set_entity_attributes(EntityHandle handle, std::string_view attributes)
+    {
+        ModelPtr model;
+        const Entity *e = nullptr;
+        bool changed = false;
 
-            // Area
-            size_t area_index = 0;
-            auto it_area = g_area_index_by_id.find(area_id);
-            if (it_area == g_area_index_by_id.end())
-            {
-                Area a;
-                a.id = area_id;
-                a.name = area_name;
-                area_index = g_areas.size();
-                g_areas.push_back(std::move(a));
-                g_area_index_by_id[area_id] = area_index;
-            }
-            else
-            {
-                area_index = it_area->second;
-                (void)area_index;
-            }
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            model = snapshot();
+            e = model->find(handle);
+            if (!e || e->removed)
+                return false;
 
-            // Entity
-            if (g_entity_index_by_id.find(entity_id) != g_entity_index_by_id.end())
+            AttrKey key;
+            float value = 0.0f;
+            while (next_attribute(attributes, key, value))
             {
-                // duplicate id, skip
-                continue;
+                const AttrSlot *slot = model->attribute(*e, key);
+                if (!slot)
+                {
+                    ESP_LOGD(TAG, "%s: no slot for attribute %s", e->id.data(), attr_key_name(key));
+                    continue;
+                }
+                if (slot->load() == value)
+                    continue;
+                slot->store(value);
+                changed = true;
             }
+            if (!changed)
+                return false;
 
-            Entity e;
-            e.id = entity_id;
-            e.name = entity_name;
-            e.state = state;
-            e.area_id = area_id;
-
-            size_t ent_index = g_entities.size();
-            g_entities.push_back(std::move(e));
-            g_entity_index_by_id[entity_id] = ent_index;
+            // Same state, new generation: widgets re-read the attributes.
+            e->state.store(e->state.load());
+            model->dirty.mark(handle);
         }
 
-        ESP_LOGI(TAG, "parsed %d areas, %d entities",
-                 static_cast<int>(g_areas.size()),
-                 static_cast<int>(g_entities.size()));
+        const std::uint16_t changed_handle = handle;
+        (void)app_events::post_entities_changed(&changed_handle, 1, esp_timer_get_time());
+        notify_listeners(*e);
         return true;
     }
 
-    bool set_entity_state(const std::string &entity_id, const std::string &state)
+    size_t apply_entity_updates(const EntityUpdate *updates, size_t count)
     {
-        std::vector<EntityListener> listeners_to_call;
-        size_t index = 0;
+        if (!updates || count == 0)
+            return 0;
+
+        ModelPtr model;
+        std::uint16_t changed[app_events::kMaxEntitiesPerChange];
+        size_t changed_count = 0;
 
         {
             std::lock_guard<std::mutex> lock(g_mutex);
-
-            auto it = g_entity_index_by_id.find(entity_id);
-            if (it == g_entity_index_by_id.end())
-                return false;
-
-            index = it->second;
-            Entity &e = g_entities[index];
-            if (e.state == state)
-                return true;
-
-            e.state = state;
-
-            // Collect listeners to call outside the lock
-            for (const auto &entry : g_listeners)
+            model = snapshot();
+            for (size_t i = 0; i < count; ++i)
             {
-                if (entry.cb && entry.entity_id == entity_id)
-                {
-                    listeners_to_call.push_back(entry.cb);
-                }
+                const Entity *e = model->find(updates[i].entity);
+                if (!e || e->removed)
+                    continue;
+                // Unchanged readings still count as samples.
+                if (updates[i].state.kind == StateKind::Numeric)
+                    record_history(SeriesKey{SeriesSource::Entity, e->handle}, updates[i].state.value);
+                if (e->state.load() == updates[i].state)
+                    continue;
+
+                e->state.store(updates[i].state);
+                model->dirty.mark(e->handle);
+                // Past the payload capacity only the count matters
+                // (receivers see `overflow` and refresh everything).
+                if (changed_count < app_events::kMaxEntitiesPerChange)
+                    changed[changed_count] = e->handle;
+                ++changed_count;
             }
         }
 
-        // Notify application event bus about changed entity state
+        if (changed_count == 0)
+            return 0;
+
         std::int64_t now_us = esp_timer_get_time();
-        (void)app_events::post_entity_state_changed(entity_id.c_str(), now_us, false);
+        (void)app_events::post_entities_changed(changed, changed_count, now_us);
 
-        const Entity &e = g_entities[index];
-        for (const auto &cb : listeners_to_call)
+        if (changed_count <= app_events::kMaxEntitiesPerChange)
         {
-            cb(e);
+            run_update_hook(*model, changed, changed_count);
+            for (size_t i = 0; i < changed_count; ++i)
+                notify_listeners(model->entities[changed[i]]);
         }
-
-        return true;
+        else
+        {
+            // Too many to track exactly: report and notify everything in
+            // the batch.
+            for (size_t i = 0; i < count; i += app_events::kMaxEntitiesPerChange)
+            {
+                size_t n = 0;
+                for (size_t j = i; j < count && n < app_events::kMaxEntitiesPerChange; ++j)
+                    changed[n++] = updates[j].entity;
+                run_update_hook(*model, changed, n);
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Entity *e = model->find(updates[i].entity);
+                if (e)
+                    notify_listeners(*e);
+            }
+        }
+        return changed_count;
     }
 
-    const std::vector<Area> &areas()
+    void set_update_hook(UpdateHookFn fn)
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        return g_areas;
+        g_update_hook.store(fn, std::memory_order_release);
     }
 
-    const std::vector<Entity> &entities()
+    void diff_models(const Model &before, const Model &after, ModelDiff &out)
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        return g_entities;
+        out = ModelDiff{};
+
+        const size_t n = std::max(before.entities.size(), after.entities.size());
+        for (size_t h = 0; h < n; ++h)
+        {
+            const Entity *b = before.find(static_cast<EntityHandle>(h));
+            const Entity *a = after.find(static_cast<EntityHandle>(h));
+            const bool was = b && !b->removed;
+            const bool is = a && !a->removed;
+            if (!was && is)
+            {
+                out.entities_added.push_back(static_cast<EntityHandle>(h));
+            }
+            else if (was && !is)
+            {
+                out.entities_removed.push_back(static_cast<EntityHandle>(h));
+            }
+            else if (was && is)
+            {
+                if (a->name != b->name)
+                    out.entities_renamed.push_back(static_cast<EntityHandle>(h));
+                if (a->area_id != b->area_id)
+                    out.entities_moved.push_back(static_cast<EntityHandle>(h));
+            }
+        }
+
+        // Areas are few; match them by id with a linear scan.
+        for (size_t i = 0; i < after.areas.size(); ++i)
+        {
+            const Area &a = after.areas[i];
+            auto it = std::find_if(before.areas.begin(), before.areas.end(),
+                                   [&](const Area &b)
+                                   { return b.id == a.id; });
+            if (it == before.areas.end())
+                out.areas_added.push_back(i);
+            else if (it->name != a.name)
+                out.areas_renamed.push_back(i);
+        }
+        for (size_t i = 0; i < before.areas.size(); ++i)
+        {
+            const Area &b = before.areas[i];
+            auto it = std::find_if(after.areas.begin(), after.areas.end(),
+                                   [&](const Area &a)
+                                   { return a.id == b.id; });
+            if (it == after.areas.end())
+                out.areas_removed.push_back(i);
+        }
     }
 
-    const Entity *find_entity(const std::string &id)
+    ModelPtr snapshot()
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
+        return std::atomic_load_explicit(&g_model, std::memory_order_acquire);
+    }
 
-        auto it = g_entity_index_by_id.find(id);
-        if (it == g_entity_index_by_id.end())
-            return nullptr;
-        return &g_entities[it->second];
+    EntityHandle find_handle(std::string_view id)
+    {
+        return snapshot()->index.find(id);
     }
 
-    void set_weather(float temperature_c, const std::string &condition)
+    void set_weather(float temperature_c, std::string_view condition)
     {
-        {
-            std::lock_guard<std::mutex> lock(g_mutex);
-            g_weather.temperature_c = temperature_c;
-            g_weather.condition = condition;
-            g_weather.valid = true;
-        }
+        WeatherState w;
+        w.temperature_c = temperature_c;
+        const size_t n = std::min(condition.size(), sizeof(w.condition) - 1);
+        std::memcpy(w.condition, condition.data(), n);
+        w.condition[n] = '\0';
+        w.valid = true;
+        g_weather.store(w);
+        record_history(SeriesKey{SeriesSource::WeatherTemperature}, temperature_c);
 
         // Notify UI that weather state was updated
         std::int64_t now_us = esp_timer_get_time();
-        (void)app_events::post_weather_updated(now_us, false);
+        (void)app_events::post<app_events::WEATHER_UPDATED>({now_us});
     }
 
     WeatherState weather()
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        return g_weather;
+        return g_weather.load();
     }
 
     void set_dht(int temperature_c, int humidity)
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        g_dht.temperature_c = temperature_c;
-        g_dht.humidity = humidity;
-        g_dht.valid = true;
+        DhtState d;
+        d.temperature_c = temperature_c;
+        d.humidity = humidity;
+        d.valid = true;
+        g_dht.store(d);
+        record_history(SeriesKey{SeriesSource::DhtTemperature}, static_cast<float>(temperature_c));
+        record_history(SeriesKey{SeriesSource::DhtHumidity}, static_cast<float>(humidity));
     }
 
     DhtState dht()
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        return g_dht;
+        return g_dht.load();
+    }
+
+    bool init_history()
+    {
+        if (!g_history.init(app_config::kHistoryMaxSeries))
+        {
+            ESP_LOGW(TAG, "history: no memory, not recording");
+            return false;
+        }
+        ESP_LOGI(TAG, "history: %d series, %d B in %s",
+                 static_cast<int>(app_config::kHistoryMaxSeries),
+                 static_cast<int>(g_history.bytes()),
+                 g_history.in_psram() ? "PSRAM" : "internal RAM");
+        return true;
+    }
+
+    size_t read_history(const SeriesKey &key, Resolution res, SeriesPoint *out, size_t max_points)
+    {
+        return g_history.read(key, res, out, max_points);
     }
 
     void set_clock(int year,
@@ -346,71 +756,60 @@ namespace state
                    int second,
                    std::int64_t monotonic_us)
     {
-        {
-            std::lock_guard<std::mutex> lock(g_mutex);
-
-            // Basic range clamping
-            if (hour < 0)
-                hour = 0;
-            if (hour > 23)
-                hour = 23;
-            if (minute < 0)
-                minute = 0;
-            if (minute > 59)
-                minute = 59;
-            if (second < 0)
-                second = 0;
-            if (second > 59)
-                second = 59;
-
-            g_clock.year = year;
-            g_clock.month = month;
-            g_clock.day = day;
-            g_clock.weekday = weekday;
-            g_clock.base_seconds = static_cast<std::int64_t>(hour) * 3600 +
-                                   static_cast<std::int64_t>(minute) * 60 +
-                                   static_cast<std::int64_t>(second);
-            g_clock.sync_monotonic_us = monotonic_us;
-            g_clock.valid = true;
-        }
+        // Basic range clamping
+        if (hour < 0)
+            hour = 0;
+        if (hour > 23)
+            hour = 23;
+        if (minute < 0)
+            minute = 0;
+        if (minute > 59)
+            minute = 59;
+        if (second < 0)
+            second = 0;
+        if (second > 59)
+            second = 59;
+
+        ClockState c;
+        c.year = year;
+        c.month = month;
+        c.day = day;
+        c.weekday = weekday;
+        c.base_seconds = static_cast<std::int64_t>(hour) * 3600 +
+                         static_cast<std::int64_t>(minute) * 60 +
+                         static_cast<std::int64_t>(second);
+        c.sync_monotonic_us = monotonic_us;
+        c.valid = true;
+        g_clock.store(c);
 
         // Notify UI that clock state was updated
         std::int64_t now_us = esp_timer_get_time();
-        (void)app_events::post_clock_updated(now_us, false);
+        (void)app_events::post<app_events::CLOCK_UPDATED>({now_us});
     }
 
     ClockState clock()
     {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        return g_clock;
+        return g_clock.load();
     }
 
-    int subscribe_entity(const std::string &id, EntityListener cb)
+    int subscribe_entity(EntityHandle handle, EntityListener cb)
     {
-        if (!cb)
+        if (!cb.fn || handle == kInvalidEntity)
             return 0;
         std::lock_guard<std::mutex> lock(g_mutex);
-        ListenerEntry e;
-        e.id = g_next_listener_id++;
-        e.entity_id = id;
-        e.cb = std::move(cb);
-        g_listeners.push_back(std::move(e));
-        return g_next_listener_id - 1;
+
+        if (g_listeners.count(handle) >= kMaxListenersPerEntity)
+        {
+            ESP_LOGW(TAG, "entity %d: listener limit reached", static_cast<int>(handle));
+            return 0;
+        }
+        return g_listeners.add(handle, cb);
     }
 
     void unsubscribe(int subscription_id)
     {
-        if (subscription_id <= 0)
-            return;
         std::lock_guard<std::mutex> lock(g_mutex);
-        for (auto it = g_listeners.begin(); it != g_listeners.end(); ++it)
-        {
-            if (it->id == subscription_id)
-            {
-                g_listeners.erase(it);
-                return;
-            }
-        }
+        g_listeners.remove(subscription_id);
     }
 
 } // namespace state
@@ -3,30 +3,104 @@
 #include <stddef.h>
 #include <vector>
 #include <string>
-#include <functional>
+#include <string_view>
 #include <cstdint>
+#include <memory>
+
+#include "dirty_set.hpp"
+#include "entity.hpp"
+#include "entity_attributes.hpp"
+#include "entity_index.hpp"
+#include "listener_table.hpp"
+#include "string_arena.hpp"
+#include "timeseries.hpp"
 
 namespace state
 {
 
-    struct Area
+    // Everything loaded by one bootstrap. A model is immutable once
+    // published (except the per-entity atomic state); a re-bootstrap
+    // publishes a new one. Readers take a snapshot() and keep it for as
+    // long as they use views or pointers into it.
+    struct Model
     {
-        std::string id;
-        std::string name;
+        StringArena strings;
+        std::vector<Area> areas;
+        std::vector<Entity> entities;
+        // Attribute pool: one contiguous buffer, each entity owns a short
+        // key-sorted range of it (Entity::attr_begin/attr_count). Slots are
+        // fixed per model; values are updated in place.
+        std::vector<AttrSlot> attrs;
+        EntityIndex index;
+        // Entities whose state changed since the UI last drained it; see
+        // drain_dirty().
+        DirtySet dirty;
+        // Bumped for every published model.
+        std::uint32_t version = 0;
+        // External storage the string views point into instead of
+        // `strings` (a memory-mapped snapshot, see load_model_blob()).
+        std::shared_ptr<const void> backing;
+
+        // Entity by handle; nullptr if the handle is out of range.
+        const Entity *find(EntityHandle handle) const
+        {
+            return handle < entities.size() ? &entities[handle] : nullptr;
+        }
+
+        // Attribute slot of an entity; nullptr if it has none for `key`.
+        const AttrSlot *attribute(const Entity &e, AttrKey key) const
+        {
+            for (std::uint32_t i = e.attr_begin; i < e.attr_begin + e.attr_count && i < attrs.size(); ++i)
+            {
+                if (attrs[i].key() == key)
+                    return &attrs[i];
+            }
+            return nullptr;
+        }
+
+        // Current attribute value; false if the entity has no slot for it
+        // or no value was reported yet.
+        bool attribute(const Entity &e, AttrKey key, float &out) const
+        {
+            const AttrSlot *slot = attribute(e, key);
+            if (!slot || !slot->has_value())
+                return false;
+            out = slot->load();
+            return true;
+        }
     };
 
-    struct Entity
+    using ModelPtr = std::shared_ptr<const Model>;
+
+    // Structural differences between two models (state changes are not
+    // included; they go through the dirty bitmap). Handles are stable
+    // across bootstraps, so entities are compared slot by slot; areas are
+    // matched by id. Area indexes refer to `before` for removed areas and
+    // to `after` otherwise.
+    struct ModelDiff
     {
-        std::string id;
-        std::string name;
-        std::string state;
-        std::string area_id;
+        std::vector<EntityHandle> entities_added;
+        std::vector<EntityHandle> entities_removed;
+        std::vector<EntityHandle> entities_renamed;
+        std::vector<EntityHandle> entities_moved; // area changed
+        std::vector<size_t> areas_added;
+        std::vector<size_t> areas_removed;
+        std::vector<size_t> areas_renamed;
+
+        bool empty() const
+        {
+            return entities_added.empty() && entities_removed.empty() &&
+                   entities_renamed.empty() && entities_moved.empty() &&
+                   areas_added.empty() && areas_removed.empty() && areas_renamed.empty();
+        }
     };
 
+    void diff_models(const Model &before, const Model &after, ModelDiff &out);
+
     struct WeatherState
     {
         float temperature_c = 0.0f;
-        std::string condition;
+        char condition[32] = {}; // HA condition id, e.g. "partlycloudy"
         bool valid = false;
     };
 
@@ -48,28 +122,99 @@ namespace state
         bool valid = false;
     };
 
-    using EntityListener = std::function<void(const Entity &)>;
-
     // Parse initial state from CSV (bootstrap HTTP response).
     // Returns true on success, false on parse error.
     bool init_from_csv(const char *csv, size_t len);
 
-    // Update entity state by ID; notifies listeners if value changed.
-    bool set_entity_state(const std::string &entity_id, const std::string &state);
+    // Streaming variant of init_from_csv() for responses that arrive in
+    // chunks: begin_csv(), then feed_csv() for every chunk, then end_csv().
+    // Rows are parsed into a staging model as they arrive; the current model
+    // stays readable until end_csv() swaps the new one in. A new begin_csv()
+    // discards any unfinished staging data.
+    //
+    // A bootstrap on top of an existing model is reconciled with it:
+    // entities keep their handles (and state generation), new ones get
+    // fresh handles and vanished ones are tombstoned. MODEL_UPDATED is
+    // posted whenever a new model is published. If the CSV is invalid the
+    // current model is kept.
+    void begin_csv();
+    void feed_csv(const char *data, size_t len);
+    bool end_csv();
+
+    // Publish a model from a binary image (model_blob.hpp) without copying
+    // its strings: ids and names stay views into `data`, which `backing`
+    // must keep alive (it is released with the last model referencing it).
+    // Reconciled and announced like end_csv(). Returns false if the image
+    // does not validate or repeats an entity id.
+    bool load_model_blob(const void *data, size_t size, std::shared_ptr<const void> backing);
+
+    // Update attributes from an HA attribute list
+    // ("brightness=128;color_temp=370"). Keys the entity has no slot for
+    // are ignored until the next bootstrap. Returns true if a value
+    // changed (the entity is then marked dirty and ENTITIES_CHANGED is
+    // posted).
+    bool set_entity_attributes(EntityHandle handle, std::string_view attributes);
+
+    // One parsed update for apply_entity_updates().
+    struct EntityUpdate
+    {
+        EntityHandle entity = kInvalidEntity;
+        EntityState state;
+    };
 
-    // Accessors
-    const std::vector<Area> &areas();
-    const std::vector<Entity> &entities();
-    const Entity *find_entity(const std::string &id);
+    // Apply a batch of updates: all states are written under one lock and a
+    // single ENTITIES_CHANGED event carries the entities that actually
+    // changed (listeners are still called per entity). Returns the number of
+    // changed entities.
+    size_t apply_entity_updates(const EntityUpdate *updates, size_t count);
+
+    // Called with the handles whose state a batch changed, after the writer lock is released; their states are read
+    // from `model` (event trace). A batch with more changes than
+    // kMaxEntitiesPerChange reports all of its handles, in chunks.
+    // Attribute-only changes are not reported. One hook; nullptr removes it.
+    using UpdateHookFn = void (*)(const Model &model, const EntityHandle *changed, size_t count);
+    void set_update_hook(UpdateHookFn fn);
+
+    // Visit every entity whose state changed since the previous call and
+    // clear its dirty flag. Meant for a single consumer (the UI refresh
+    // timer); cost is one word scan of the bitmap plus the dirty entities.
+    template <typename Fn>
+    size_t drain_dirty(const Model &model, Fn &&fn)
+    {
+        return model.dirty.drain([&](size_t handle)
+                                 {
+                                     if (handle < model.entities.size())
+                                         fn(model.entities[handle]);
+                                 });
+    }
+
+    // Current model. Never null (empty before the first bootstrap).
+    ModelPtr snapshot();
+    // Resolve string id to handle in the current model; kInvalidEntity if
+    // unknown.
+    EntityHandle find_handle(std::string_view id);
+
+    // Weather, DHT and clock are seqlocked snapshots: getters return a copy
+    // without locking or allocating and never block the writer task.
 
     // Weather state
-    void set_weather(float temperature_c, const std::string &condition);
+    void set_weather(float temperature_c, std::string_view condition);
     WeatherState weather();
 
     // Local DHT11 sensor state
     void set_dht(int temperature_c, int humidity);
     DhtState dht();
 
+    // Value history (timeseries.hpp), e.g. for trend sparklines. DHT and
+    // weather temperature are recorded by their setters, numeric entities
+    // by every state update while they have a slot (see
+    // TimeSeriesStore). init_history() allocates the store once at
+    // startup, so the update path never does; samples before it are
+    // dropped. read_history() copies up to `max_points` buckets of one
+    // resolution, oldest first, and returns the number copied.
+    bool init_history();
+    size_t read_history(const SeriesKey &key, Resolution res, SeriesPoint *out, size_t max_points);
+
     // Clock state (time/date synced from HA)
     void set_clock(int year,
                    int month,
@@ -81,8 +226,10 @@ namespace state
                    std::int64_t monotonic_us);
     ClockState clock();
 
-    // UI subscriptions
-    int subscribe_entity(const std::string &id, EntityListener cb);
+    // UI subscriptions. At most kMaxListenersPerEntity per entity; returns
+    // 0 if the entity already has that many or the arguments are invalid.
+    constexpr size_t kMaxListenersPerEntity = 8;
+    int subscribe_entity(EntityHandle handle, EntityListener cb);
     void unsubscribe(int subscription_id);
 
 } // namespace state
@@ -0,0 +1,193 @@
+#include "string_arena.hpp"
+
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace state
+{
+
+    namespace
+    {
+        // Payload size of a regular block; longer strings get their own block.
+        constexpr std::size_t kBlockSize = 4096;
+        constexpr std::size_t kInitialTableCap = 64;
+    } // namespace
+
+    struct StringArena::Block
+    {
+        Block *next;
+        std::size_t size;
+        std::size_t used;
+        char data[1];
+    };
+
+    StringArena::~StringArena()
+    {
+        clear();
+    }
+
+    StringArena::StringArena(StringArena &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    StringArena &StringArena::operator=(StringArena &&other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            blocks_ = std::exchange(other.blocks_, nullptr);
+            table_ = std::exchange(other.table_, nullptr);
+            table_cap_ = std::exchange(other.table_cap_, 0);
+            count_ = std::exchange(other.count_, 0);
+            bytes_used_ = std::exchange(other.bytes_used_, 0);
+            bytes_reserved_ = std::exchange(other.bytes_reserved_, 0);
+            in_psram_ = std::exchange(other.in_psram_, false);
+        }
+        return *this;
+    }
+
+    void StringArena::clear()
+    {
+        while (blocks_)
+        {
+            Block *next = blocks_->next;
+            heap_caps_free(blocks_);
+            blocks_ = next;
+        }
+        if (table_)
+        {
+            heap_caps_free(table_);
+            table_ = nullptr;
+        }
+        table_cap_ = 0;
+        count_ = 0;
+        bytes_used_ = 0;
+        bytes_reserved_ = 0;
+        in_psram_ = false;
+    }
+
+    void *StringArena::alloc_raw(std::size_t n)
+    {
+        void *p = nullptr;
+#if CONFIG_SPIRAM
+        p = heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (p)
+        {
+            in_psram_ = true;
+        }
+#endif
+        if (!p)
+        {
+            p = heap_caps_malloc(n, MALLOC_CAP_8BIT);
+        }
+        if (p)
+        {
+            bytes_reserved_ += n;
+        }
+        return p;
+    }
+
+    char *StringArena::allocate(std::size_t n)
+    {
+        if (!blocks_ || blocks_->size - blocks_->used < n)
+        {
+            std::size_t payload = n > kBlockSize ? n : kBlockSize;
+            auto *b = static_cast<Block *>(alloc_raw(offsetof(Block, data) + payload));
+            if (!b)
+            {
+                return nullptr;
+            }
+            b->size = payload;
+            b->used = 0;
+            // Oversized strings go into a dedicated block behind the current
+            // one so the remaining space of the current block is not wasted.
+            if (blocks_ && n > kBlockSize)
+            {
+                b->next = blocks_->next;
+                blocks_->next = b;
+            }
+            else
+            {
+                b->next = blocks_;
+                blocks_ = b;
+            }
+            char *p = b->data + b->used;
+            b->used += n;
+            return p;
+        }
+        char *p = blocks_->data + blocks_->used;
+        blocks_->used += n;
+        return p;
+    }
+
+    bool StringArena::grow_table()
+    {
+        std::size_t new_cap = table_cap_ ? table_cap_ * 2 : kInitialTableCap;
+        auto *t = static_cast<std::string_view *>(alloc_raw(new_cap * sizeof(std::string_view)));
+        if (!t)
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < new_cap; ++i)
+        {
+            new (&t[i]) std::string_view();
+        }
+        for (std::size_t i = 0; i < table_cap_; ++i)
+        {
+            const std::string_view s = table_[i];
+            if (!s.data())
+                continue;
+            std::size_t slot = hash_fnv1a(s) & (new_cap - 1);
+            while (t[slot].data())
+                slot = (slot + 1) & (new_cap - 1);
+            t[slot] = s;
+        }
+        if (table_)
+        {
+            bytes_reserved_ -= table_cap_ * sizeof(std::string_view);
+            heap_caps_free(table_);
+        }
+        table_ = t;
+        table_cap_ = new_cap;
+        return true;
+    }
+
+    std::string_view StringArena::intern(std::string_view s)
+    {
+        // Keep load factor <= 0.5 so probe sequences stay short.
+        if ((count_ + 1) * 2 > table_cap_ && !grow_table())
+        {
+            return {};
+        }
+
+        std::size_t slot = hash_fnv1a(s) & (table_cap_ - 1);
+        while (table_[slot].data())
+        {
+            if (table_[slot] == s)
+            {
+                return table_[slot];
+            }
+            slot = (slot + 1) & (table_cap_ - 1);
+        }
+
+        char *p = allocate(s.size() + 1);
+        if (!p)
+        {
+            return {};
+        }
+        std::memcpy(p, s.data(), s.size());
+        p[s.size()] = '\0';
+
+        table_[slot] = std::string_view(p, s.size());
+        ++count_;
+        bytes_used_ += s.size() + 1;
+        return table_[slot];
+    }
+
+} // namespace state
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace state
+{
+
+    // FNV-1a over the bytes of `s`. Shared by the arena's intern table and
+    // the entity index so both hash ids the same way.
+    inline std::uint32_t hash_fnv1a(std::string_view s)
+    {
+        std::uint32_t h = 2166136261u;
+        for (char c : s)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // Append-only string storage with interning, used for the ids and names
+    // loaded at bootstrap. Every distinct string is stored exactly once;
+    // interning the same text again returns a view of the same bytes.
+    //
+    // Memory comes from PSRAM when available (internal RAM otherwise) in
+    // large blocks, so thousands of short strings cost a handful of heap
+    // allocations. Returned views are always NUL-terminated (data() can be
+    // passed to C APIs such as lv_label_set_text) and stay valid until the
+    // arena is cleared or destroyed.
+    class StringArena
+    {
+    public:
+        StringArena() = default;
+        ~StringArena();
+
+        StringArena(const StringArena &) = delete;
+        StringArena &operator=(const StringArena &) = delete;
+        StringArena(StringArena &&other) noexcept;
+        StringArena &operator=(StringArena &&other) noexcept;
+
+        // Store `s` (or find an identical stored copy) and return a view of it.
+        // Returns an empty view on allocation failure.
+        std::string_view intern(std::string_view s);
+
+        void clear();
+
+        std::size_t strings() const { return count_; }
+        // Bytes of string data (including terminators) and total bytes
+        // reserved from the heap by this arena.
+        std::size_t bytes_used() const { return bytes_used_; }
+        std::size_t bytes_reserved() const { return bytes_reserved_; }
+        bool in_psram() const { return in_psram_; }
+
+    private:
+        struct Block;
+
+        char *allocate(std::size_t n);
+        bool grow_table();
+        void *alloc_raw(std::size_t n);
+
+        Block *blocks_ = nullptr;
+        std::string_view *table_ = nullptr;
+        std::size_t table_cap_ = 0;
+        std::size_t count_ = 0;
+        std::size_t bytes_used_ = 0;
+        std::size_t bytes_reserved_ = 0;
+        bool in_psram_ = false;
+    };
+
+} // namespace state
@@ -0,0 +1,224 @@
+#include "timeseries.hpp"
+
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+namespace state
+{
+
+    namespace
+    {
+
+        constexpr size_t buckets_per_series()
+        {
+            size_t n = 0;
+            for (const ResolutionSpec &r : kResolutions)
+                n += r.buckets;
+            return n;
+        }
+
+    } // namespace
+
+    TimeSeriesStore::~TimeSeriesStore()
+    {
+        if (buckets_)
+            heap_caps_free(buckets_);
+        if (series_)
+            heap_caps_free(series_);
+    }
+
+    bool TimeSeriesStore::init(size_t max_series)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (series_ || max_series <= kReservedSeries)
+            return series_ != nullptr;
+
+        const size_t bucket_bytes = max_series * buckets_per_series() * sizeof(Bucket);
+        void *b = nullptr;
+#if CONFIG_SPIRAM
+        b = heap_caps_malloc(bucket_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        in_psram_ = (b != nullptr);
+#endif
+        if (!b)
+            b = heap_caps_malloc(bucket_bytes, MALLOC_CAP_8BIT);
+        // Series headers are small and looked up on every sample.
+        void *s = heap_caps_malloc(max_series * sizeof(Series), MALLOC_CAP_8BIT);
+        if (!b || !s)
+        {
+            if (b)
+                heap_caps_free(b);
+            if (s)
+                heap_caps_free(s);
+            in_psram_ = false;
+            return false;
+        }
+
+        buckets_ = static_cast<Bucket *>(b);
+        series_ = static_cast<Series *>(s);
+        max_series_ = max_series;
+        bytes_ = bucket_bytes + max_series * sizeof(Series);
+
+        Bucket *next = buckets_;
+        for (size_t i = 0; i < max_series; ++i)
+        {
+            Series &ser = series_[i];
+            ser.key = SeriesKey{};
+            ser.used = false;
+            ser.last_s = 0;
+            for (size_t r = 0; r < kResolutionCount; ++r)
+            {
+                ser.rings[r].buckets = next;
+                ser.rings[r].head = 0;
+                ser.rings[r].count = 0;
+                next += kResolutions[r].buckets;
+            }
+        }
+        return true;
+    }
+
+    TimeSeriesStore::Series *TimeSeriesStore::find(const SeriesKey &key) const
+    {
+        if (key.source != SeriesSource::Entity)
+        {
+            Series *ser = max_series_ ? &series_[static_cast<size_t>(key.source)] : nullptr;
+            return ser && ser->used ? ser : nullptr;
+        }
+        for (size_t i = kReservedSeries; i < max_series_; ++i)
+        {
+            if (series_[i].used && series_[i].key == key)
+                return &series_[i];
+        }
+        return nullptr;
+    }
+
+    TimeSeriesStore::Series *TimeSeriesStore::claim(const SeriesKey &key, std::uint32_t now_s)
+    {
+        if (max_series_ == 0)
+            return nullptr;
+
+        Series *ser = nullptr;
+        if (key.source != SeriesSource::Entity)
+        {
+            ser = &series_[static_cast<size_t>(key.source)];
+        }
+        else
+        {
+            // A free slot, else the entity series idle the longest.
+            Series *oldest = nullptr;
+            for (size_t i = kReservedSeries; i < max_series_ && !ser; ++i)
+            {
+                Series &s = series_[i];
+                if (!s.used)
+                    ser = &s;
+                else if (!oldest || s.last_s < oldest->last_s)
+                    oldest = &s;
+            }
+            if (!ser && oldest && now_s - oldest->last_s >= kEvictAfterS)
+                ser = oldest;
+            if (!ser)
+                return nullptr;
+        }
+
+        ser->key = key;
+        ser->used = true;
+        for (Ring &ring : ser->rings)
+        {
+            ring.head = 0;
+            ring.count = 0;
+        }
+        return ser;
+    }
+
+    void TimeSeriesStore::record(const SeriesKey &key, float value, std::int64_t now_us)
+    {
+        if (value != value) // NaN
+            return;
+        const std::uint32_t now_s = static_cast<std::uint32_t>(now_us / 1000000);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series *ser = find(key);
+        if (!ser)
+            ser = claim(key, now_s);
+        if (!ser)
+            return;
+        ser->last_s = now_s;
+
+        for (size_t r = 0; r < kResolutionCount; ++r)
+        {
+            Ring &ring = ser->rings[r];
+            const std::uint16_t capacity = kResolutions[r].buckets;
+            const std::uint32_t index = now_s / kResolutions[r].period_s;
+
+            if (ring.count > 0 && ring.buckets[ring.head].index == index)
+            {
+                Bucket &b = ring.buckets[ring.head];
+                if (value < b.min)
+                    b.min = value;
+                if (value > b.max)
+                    b.max = value;
+                b.sum += value;
+                if (b.samples < 0xFFFF)
+                    ++b.samples;
+                continue;
+            }
+
+            // New bucket; periods without samples simply leave a gap in
+            // the start times.
+            if (ring.count > 0)
+                ring.head = static_cast<std::uint16_t>((ring.head + 1) % capacity);
+            if (ring.count < capacity)
+                ++ring.count;
+            ring.buckets[ring.head] = Bucket{index, value, value, value, 1};
+        }
+    }
+
+    void TimeSeriesStore::forget(const SeriesKey &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series *ser = find(key);
+        if (ser)
+            ser->used = false;
+    }
+
+    size_t TimeSeriesStore::read(const SeriesKey &key, Resolution res, SeriesPoint *out, size_t max_points) const
+    {
+        const size_t r = static_cast<size_t>(res);
+        if (!out || max_points == 0 || r >= kResolutionCount)
+            return 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Series *ser = find(key);
+        if (!ser)
+            return 0;
+
+        const Ring &ring = ser->rings[r];
+        const std::uint16_t capacity = kResolutions[r].buckets;
+        const size_t n = ring.count < max_points ? ring.count : max_points;
+        // Oldest of the n newest buckets.
+        size_t slot = (ring.head + capacity + 1 - n) % capacity;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const Bucket &b = ring.buckets[slot];
+            out[i].start_s = b.index * kResolutions[r].period_s;
+            out[i].min = b.min;
+            out[i].max = b.max;
+            out[i].avg = b.sum / static_cast<float>(b.samples);
+            out[i].samples = b.samples;
+            slot = (slot + 1) % capacity;
+        }
+        return n;
+    }
+
+    size_t TimeSeriesStore::series() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t n = 0;
+        for (size_t i = 0; i < max_series_; ++i)
+        {
+            if (series_[i].used)
+                ++n;
+        }
+        return n;
+    }
+
+} // namespace state
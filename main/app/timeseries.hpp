@@ -0,0 +1,142 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace state
+{
+
+    // What a series records. Entity series are keyed by handle, which stays
+    // stable across re-bootstraps.
+    enum class SeriesSource : std::uint8_t
+    {
+        DhtTemperature,
+        DhtHumidity,
+        WeatherTemperature,
+        Entity,
+    };
+
+    // Sources before Entity each own a reserved slot.
+    constexpr size_t kReservedSeries = static_cast<size_t>(SeriesSource::Entity);
+
+    struct SeriesKey
+    {
+        SeriesSource source = SeriesSource::Entity;
+        EntityHandle entity = kInvalidEntity;
+
+        bool operator==(const SeriesKey &o) const
+        {
+            return source == o.source && entity == o.entity;
+        }
+    };
+
+    // Each series keeps three rings of aggregated buckets; every sample
+    // updates the current bucket of all three, so no separate downsampling
+    // pass is needed.
+    enum class Resolution : std::uint8_t
+    {
+        Minute,  // 1 min buckets, last hour
+        Quarter, // 15 min buckets, last day
+        Hour,    // 1 h buckets, last week
+    };
+    constexpr size_t kResolutionCount = 3;
+
+    struct ResolutionSpec
+    {
+        std::uint32_t period_s;
+        std::uint16_t buckets;
+    };
+
+    constexpr ResolutionSpec kResolutions[kResolutionCount] = {
+        {60, 60},
+        {15 * 60, 96},
+        {60 * 60, 168},
+    };
+
+    // One aggregated bucket. `start_s` is monotonic seconds since boot.
+    struct SeriesPoint
+    {
+        std::uint32_t start_s = 0;
+        float min = 0.0f;
+        float max = 0.0f;
+        float avg = 0.0f;
+        std::uint16_t samples = 0;
+    };
+
+    // Fixed-memory store for up to max_series series. All buckets are
+    // allocated once by init() (PSRAM when available). DHT and weather
+    // series have reserved slots; the rest are shared by entities. A new
+    // entity series takes a free slot on its first sample. If none is free
+    // it takes the slot of the least recently updated entity series, once
+    // that one has had no sample for kEvictAfterS. Otherwise the sample is
+    // dropped. Call forget() for series whose entity is gone. record() and
+    // read() may be called from any task.
+    class TimeSeriesStore
+    {
+    public:
+        TimeSeriesStore() = default;
+        ~TimeSeriesStore();
+
+        TimeSeriesStore(const TimeSeriesStore &) = delete;
+        TimeSeriesStore &operator=(const TimeSeriesStore &) = delete;
+
+        // Idle time after which an entity series may lose its slot: by
+        // then its minute ring holds nothing recent.
+        static constexpr std::uint32_t kEvictAfterS = 60 * 60;
+
+        // max_series includes the kReservedSeries slots.
+        bool init(size_t max_series);
+
+        void record(const SeriesKey &key, float value, std::int64_t now_us);
+
+        // Drop a series and free its slot (entity removed).
+        void forget(const SeriesKey &key);
+
+        // Copy up to `max_points` buckets of one resolution, oldest first.
+        // Returns the number copied (0 for an unknown series).
+        size_t read(const SeriesKey &key, Resolution res, SeriesPoint *out, size_t max_points) const;
+
+        size_t series() const;
+        size_t bytes() const { return bytes_; }
+        bool in_psram() const { return in_psram_; }
+
+    private:
+        struct Bucket
+        {
+            std::uint32_t index; // start_s / period_s
+            float min;
+            float max;
+            float sum;
+            std::uint16_t samples;
+        };
+
+        struct Ring
+        {
+            Bucket *buckets;
+            std::uint16_t head;  // slot of the newest bucket
+            std::uint16_t count; // used buckets
+        };
+
+        struct Series
+        {
+            SeriesKey key;
+            bool used;
+            std::uint32_t last_s; // time of the newest sample
+            Ring rings[kResolutionCount];
+        };
+
+        Series *find(const SeriesKey &key) const;
+        Series *claim(const SeriesKey &key, std::uint32_t now_s);
+
+        Series *series_ = nullptr;
+        Bucket *buckets_ = nullptr;
+        size_t max_series_ = 0;
+        size_t bytes_ = 0;
+        bool in_psram_ = false;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace state
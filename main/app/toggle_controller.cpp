@@ -1,16 +1,16 @@
 #include "toggle_controller.hpp"
 
-#include "esp_event.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "app_events.hpp"
+#include "event_trace.hpp"
 #include "app/router.hpp"
 #include "wifi_manager.h"
 
-#include <cstring>
+#include <cstdint>
 
 namespace toggle_controller
 {
@@ -22,7 +22,8 @@ namespace toggle_controller
 
         static void ha_toggle_task(void *arg)
         {
-            char *entity = static_cast<char *>(arg);
+            // Entity handle is passed by value in the task argument.
+            const auto entity = static_cast<state::EntityHandle>(reinterpret_cast<std::uintptr_t>(arg));
 
             bool success = false;
 
@@ -44,52 +45,40 @@ namespace toggle_controller
             }
 
             std::int64_t now_us = esp_timer_get_time();
-            (void)app_events::post_toggle_result(entity ? entity : "", success, now_us, false);
-
-            if (entity)
-                std::free(entity);
+            (void)app_events::post<app_events::TOGGLE_RESULT>({entity, success, now_us});
 
             s_toggle_task = nullptr;
             vTaskDelete(nullptr);
         }
 
-        static void on_toggle_request(void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+        static void on_toggle_request(const app_events::ToggleRequestPayload &payload)
         {
-            if (base != APP_EVENTS || id != app_events::TOGGLE_REQUEST)
+            if (payload.entity == state::kInvalidEntity)
             {
                 return;
             }
 
-            const auto *payload = static_cast<const app_events::ToggleRequestPayload *>(event_data);
-            if (!payload || !payload->entity_id[0])
+            // A replayed trace brings its own TOGGLE_RESULTs; nothing is
+            // sent to HA.
+            if (event_trace::replaying())
             {
                 return;
             }
 
             if (s_toggle_task != nullptr)
             {
-                ESP_LOGW(TAG, "Toggle already in progress, ignoring request for '%s'", payload->entity_id);
-                return;
-            }
-
-            char *arg = static_cast<char *>(std::malloc(std::strlen(payload->entity_id) + 1));
-            if (!arg)
-            {
-                ESP_LOGE(TAG, "No memory for toggle arg");
-                std::int64_t now_us = esp_timer_get_time();
-                (void)app_events::post_toggle_result(payload->entity_id, false, now_us, false);
+                ESP_LOGW(TAG, "Toggle already in progress, ignoring request for entity %d", (int)payload.entity);
                 return;
             }
-            std::memcpy(arg, payload->entity_id, std::strlen(payload->entity_id) + 1);
 
+            void *arg = reinterpret_cast<void *>(static_cast<std::uintptr_t>(payload.entity));
             BaseType_t ok = xTaskCreate(ha_toggle_task, "ha_toggle", 4096, arg, 4, &s_toggle_task);
             if (ok != pdPASS)
             {
-                std::free(arg);
                 s_toggle_task = nullptr;
                 ESP_LOGW(TAG, "Failed to create ha_toggle task");
                 std::int64_t now_us = esp_timer_get_time();
-                (void)app_events::post_toggle_result(payload->entity_id, false, now_us, false);
+                (void)app_events::post<app_events::TOGGLE_RESULT>({payload.entity, false, now_us});
             }
         }
 
@@ -103,13 +92,7 @@ namespace toggle_controller
             return ESP_OK;
         }
 
-        esp_event_handler_instance_t inst = nullptr;
-        esp_err_t err = esp_event_handler_instance_register(
-            APP_EVENTS,
-            app_events::TOGGLE_REQUEST,
-            &on_toggle_request,
-            nullptr,
-            &inst);
+        esp_err_t err = app_events::subscribe<app_events::TOGGLE_REQUEST>(&on_toggle_request);
 
         if (err != ESP_OK)
         {
@@ -5,8 +5,10 @@
 #include "esp_system.h"
 
 #include "config_store.hpp"
+#include "diag_server.hpp"
 #include "cJSON.h"
 
+#include <cstdlib>
 #include <string>
 
 namespace config_server
@@ -247,6 +249,8 @@ namespace config_server
         cfg.uri_match_fn = httpd_uri_match_wildcard;
         // Increase stack size to handle JSON parsing comfortably
         cfg.stack_size = 8192;
+        // Own handlers plus the diagnostics ones.
+        cfg.max_uri_handlers = 5 + diag_server::kHandlerCount;
 
         esp_err_t err = httpd_start(&s_httpd, &cfg);
         if (err != ESP_OK)
@@ -296,6 +300,8 @@ namespace config_server
         };
         httpd_register_uri_handler(s_httpd, &reboot);
 
+        (void)diag_server::register_handlers(s_httpd, true);
+
         ESP_LOGI(TAG, "Config HTTP server started on port %d", cfg.server_port);
         return ESP_OK;
     }
@@ -0,0 +1,293 @@
+#include "diag_server.hpp"
+
+#include "esp_log.h"
+
+#include "app_config.hpp"
+#include "event_metrics.hpp"
+#include "event_trace.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace diag_server
+{
+
+    namespace
+    {
+        const char *TAG = "diag_http";
+
+        httpd_handle_t s_httpd = nullptr;
+
+        void append_histogram(std::string &json, const event_metrics::Histogram &h)
+        {
+            json += "{\"count\":";
+            json += std::to_string(h.count);
+            json += ",\"max_us\":";
+            json += std::to_string(h.max_us);
+            json += ",\"buckets\":[";
+            for (std::size_t b = 0; b < event_metrics::kHistogramBuckets; ++b)
+            {
+                if (b > 0)
+                    json += ',';
+                json += std::to_string(h.buckets[b]);
+            }
+            json += "]}";
+        }
+
+        // Event bus telemetry (see event_metrics). Bucket limits are listed
+        // once; the last bucket is open-ended.
+        esp_err_t handle_get_metrics(httpd_req_t *req)
+        {
+            // Handlers run one at a time on the httpd task.
+            static event_metrics::Snapshot snap;
+            event_metrics::snapshot(snap);
+
+            httpd_resp_set_type(req, "application/json");
+            std::string json = "{\"since_us\":";
+            json += std::to_string(snap.since_us);
+            json += ",\"bucket_limits_us\":[";
+            for (std::size_t b = 0; b + 1 < event_metrics::kHistogramBuckets; ++b)
+            {
+                if (b > 0)
+                    json += ',';
+                json += std::to_string(event_metrics::bucket_limit_us(b));
+            }
+            json += "],\"lanes\":[";
+            for (std::size_t i = 0; i < app_events::kLaneCount; ++i)
+            {
+                const event_metrics::LaneStats &l = snap.lanes[i];
+                if (i > 0)
+                    json += ',';
+                json += "{\"name\":\"";
+                json += l.name;
+                json += "\",\"capacity\":";
+                json += std::to_string(l.capacity);
+                json += ",\"depth\":";
+                json += std::to_string(l.depth);
+                json += ",\"high_water\":";
+                json += std::to_string(l.high_water);
+                json += '}';
+            }
+            json += "],\"events\":[";
+            for (std::size_t i = 0; i < app_events::kEventCount; ++i)
+            {
+                const event_metrics::EventStats &e = snap.events[i];
+                if (i > 0)
+                    json += ',';
+                json += "{\"id\":\"";
+                json += app_events::id_to_string(e.id);
+                json += "\",\"dispatched\":";
+                json += std::to_string(e.dispatched);
+                json += ",\"coalesced\":";
+                json += std::to_string(e.coalesced);
+                json += ",\"dropped\":";
+                json += std::to_string(e.dropped);
+                json += ",\"latency\":";
+                append_histogram(json, e.latency);
+                json += ",\"handler\":";
+                append_histogram(json, e.handler);
+                json += '}';
+            }
+            json += "]}";
+
+            // The same numbers on the serial console.
+            event_metrics::log_summary();
+            return httpd_resp_send(req, json.c_str(), json.size());
+        }
+
+        esp_err_t handle_reset_metrics(httpd_req_t *req)
+        {
+            event_metrics::reset();
+            httpd_resp_set_type(req, "application/json");
+            const char *ok = "{\"status\":\"ok\"}";
+            return httpd_resp_send(req, ok, strlen(ok));
+        }
+
+        // App event trace (see event_trace): download, upload, replay.
+        // Largest trace accepted for upload.
+        constexpr size_t kMaxTraceUpload = 256 * 1024;
+
+        esp_err_t handle_get_trace(httpd_req_t *req)
+        {
+            // Recording pauses while the ring is read out.
+            const bool was_recording = event_trace::recording();
+            event_trace::stop();
+
+            httpd_resp_set_type(req, "application/octet-stream");
+            char chunk[1024];
+            size_t offset = 0;
+            esp_err_t err = ESP_OK;
+            for (;;)
+            {
+                const size_t n = event_trace::read_blob(offset, chunk, sizeof(chunk));
+                if (n == 0)
+                    break;
+                err = httpd_resp_send_chunk(req, chunk, static_cast<ssize_t>(n));
+                if (err != ESP_OK)
+                    break;
+                offset += n;
+            }
+            if (err == ESP_OK)
+                err = httpd_resp_send_chunk(req, nullptr, 0);
+
+            if (was_recording)
+                (void)event_trace::start(app_config::kEventTraceBytes);
+            return err;
+        }
+
+        esp_err_t handle_post_trace(httpd_req_t *req)
+        {
+            const size_t content_len = static_cast<size_t>(req->content_len);
+            if (content_len == 0 || content_len > kMaxTraceUpload)
+            {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid body length");
+            }
+
+            char *buf = static_cast<char *>(malloc(content_len));
+            if (!buf)
+            {
+                return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No memory");
+            }
+
+            size_t received = 0;
+            while (received < content_len)
+            {
+                const int r = httpd_req_recv(req, buf + received, content_len - received);
+                if (r <= 0)
+                {
+                    free(buf);
+                    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to read body");
+                }
+                received += static_cast<size_t>(r);
+            }
+
+            const esp_err_t err = event_trace::load_blob(buf, received);
+            free(buf);
+            if (err != ESP_OK)
+            {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid trace");
+            }
+
+            httpd_resp_set_type(req, "application/json");
+            const char *ok = "{\"status\":\"ok\"}";
+            return httpd_resp_send(req, ok, strlen(ok));
+        }
+
+        // ?speed=<percent>: 100 (default) = recorded timing, 0 = no waits.
+        // Recording pauses for the replay and resumes after it.
+        esp_err_t handle_replay_trace(httpd_req_t *req)
+        {
+            event_trace::ReplayOptions options;
+            char query[32];
+            char value[12];
+            if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                httpd_query_key_value(query, "speed", value, sizeof(value)) == ESP_OK)
+            {
+                options.speed_percent = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+            }
+
+            if (event_trace::replay(options) != ESP_OK)
+            {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No trace to replay");
+            }
+
+            httpd_resp_set_type(req, "application/json");
+            const char *ok = "{\"status\":\"ok\"}";
+            return httpd_resp_send(req, ok, strlen(ok));
+        }
+
+    } // namespace
+
+    esp_err_t register_handlers(httpd_handle_t server, bool control)
+    {
+        // Read-only handlers first.
+        const httpd_uri_t handlers[kHandlerCount] = {
+            {
+                .uri = "/api/metrics",
+                .method = HTTP_GET,
+                .handler = handle_get_metrics,
+                .user_ctx = nullptr,
+            },
+            {
+                .uri = "/api/trace",
+                .method = HTTP_GET,
+                .handler = handle_get_trace,
+                .user_ctx = nullptr,
+            },
+            {
+                .uri = "/api/metrics/reset",
+                .method = HTTP_POST,
+                .handler = handle_reset_metrics,
+                .user_ctx = nullptr,
+            },
+            {
+                .uri = "/api/trace",
+                .method = HTTP_POST,
+                .handler = handle_post_trace,
+                .user_ctx = nullptr,
+            },
+            {
+                .uri = "/api/trace/replay",
+                .method = HTTP_POST,
+                .handler = handle_replay_trace,
+                .user_ctx = nullptr,
+            },
+        };
+        const int count = control ? kHandlerCount : kReadOnlyHandlerCount;
+        for (int i = 0; i < count; ++i)
+        {
+            const esp_err_t err = httpd_register_uri_handler(server, &handlers[i]);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "register %s failed: %s", handlers[i].uri, esp_err_to_name(err));
+                return err;
+            }
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t start()
+    {
+        if (s_httpd)
+        {
+            return ESP_OK;
+        }
+
+        httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+        cfg.server_port = app_config::kDiagHttpPort;
+        // The config server keeps the default control port.
+        cfg.ctrl_port = static_cast<std::uint16_t>(cfg.ctrl_port + 1);
+        cfg.stack_size = 6144;
+        cfg.max_uri_handlers = kReadOnlyHandlerCount;
+
+        esp_err_t err = httpd_start(&s_httpd, &cfg);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "httpd_start failed: %s", esp_err_to_name(err));
+            s_httpd = nullptr;
+            return err;
+        }
+
+        err = register_handlers(s_httpd, false);
+        if (err != ESP_OK)
+        {
+            stop();
+            return err;
+        }
+
+        ESP_LOGI(TAG, "Diagnostics HTTP server (read-only) started on port %d", cfg.server_port);
+        return ESP_OK;
+    }
+
+    void stop()
+    {
+        if (s_httpd)
+        {
+            httpd_stop(s_httpd);
+            s_httpd = nullptr;
+        }
+    }
+
+} // namespace diag_server
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Diagnostics endpoints. Read-only: event bus metrics (GET /api/metrics)
+// and the event trace download (GET /api/trace). Control: metrics reset
+// (POST /api/metrics/reset), trace upload (POST /api/trace) and replay
+// (POST /api/trace/replay). The config server serves all of them in
+// config mode; while the app runs normally a small server of its own on
+// app_config::kDiagHttpPort serves only the read-only ones, since it has
+// no authentication.
+namespace diag_server
+{
+
+    // URI handlers register_handlers() adds, without and with control.
+    constexpr int kReadOnlyHandlerCount = 2;
+    constexpr int kHandlerCount = 5;
+
+    // Adds the read-only diagnostics handlers, and the control ones if
+    // `control`, to an already started server.
+    esp_err_t register_handlers(httpd_handle_t server, bool control);
+
+    // Start the normal-mode (read-only) diagnostics server.
+    esp_err_t start();
+
+    // Stop it if running.
+    void stop();
+
+} // namespace diag_server
@@ -2,6 +2,7 @@
 #include "ui/ui_app.hpp"
 #include "ui/splash.hpp"
 #include "ui/screensaver.hpp"
+#include "ui/rooms.hpp"
 #include "esp_err.h"
 #include "esp_lvgl_port.h"
 #include "freertos/FreeRTOS.h"
@@ -15,17 +16,22 @@
 #include "wifi_manager.h"
 #include "http_manager.hpp"
 #include "app/router.hpp"
+#include "app/deferred_log.hpp"
 #include "app/event_logger.hpp"
+#include "app/event_metrics.hpp"
+#include "app/event_trace.hpp"
 #include "app/input_controller.hpp"
 #include "app/toggle_controller.hpp"
 #include "app/app_state.hpp"
 #include "app/app_events.hpp"
 #include "app/app_config.hpp"
 #include "app/state_manager.hpp"
+#include "app/state_cache.hpp"
 #include "devices/dht11.hpp"
 
 #include "config_server/config_store.hpp"
 #include "config_server/config_server.hpp"
+#include "config_server/diag_server.hpp"
 
 static const char *TAG_APP = "app";
 
@@ -42,7 +48,7 @@ static void set_app_state(AppState new_state)
     AppState old = g_app_state;
     g_app_state = new_state;
 
-    (void)app_events::post_app_state_changed(old, new_state, esp_timer_get_time(), false);
+    (void)app_events::post<app_events::APP_STATE_CHANGED>({static_cast<int>(old), static_cast<int>(new_state), esp_timer_get_time()});
 }
 
 // Simple application-level idle controller for screensaver.
@@ -102,8 +108,50 @@ static void dht_task(void *arg)
     }
 }
 
+// Warm boot: rooms come from the stored snapshot while the live bootstrap
+// is still running. If HA stays unreachable, bring the splash (with its
+// setup button) back after kWarmBootSplashFallbackMs.
+static esp_timer_handle_t s_warm_fallback_timer = nullptr;
+static volatile bool s_warm_fallback_shown = false;
+
+static void warm_fallback_cb(void * /*arg*/)
+{
+    s_warm_fallback_shown = true;
+    ESP_LOGW(TAG_APP, "Bootstrap still pending, showing splash");
+    ui::splash::show();
+    ui::splash::update_state(50, "Подключение...");
+}
+
+static void start_warm_fallback_timer()
+{
+    esp_timer_create_args_t args = {};
+    args.callback = &warm_fallback_cb;
+    args.name = "warm_fallback";
+    if (esp_timer_create(&args, &s_warm_fallback_timer) == ESP_OK)
+    {
+        (void)esp_timer_start_once(s_warm_fallback_timer,
+                                   static_cast<std::uint64_t>(app_config::kWarmBootSplashFallbackMs) * 1000);
+    }
+    else
+    {
+        s_warm_fallback_timer = nullptr;
+    }
+}
+
+static void stop_warm_fallback_timer()
+{
+    if (s_warm_fallback_timer)
+    {
+        (void)esp_timer_stop(s_warm_fallback_timer);
+        (void)esp_timer_delete(s_warm_fallback_timer);
+        s_warm_fallback_timer = nullptr;
+    }
+}
+
 static void enter_config_mode()
 {
+    // Warm boot may have replaced the splash with the rooms.
+    ui::splash::show();
     ui::splash::update_state(100, "Настройка...");
     // Stop ongoing bootstrap attempts (if any), then start configuration
     // access point + HTTP UI and park main task.
@@ -121,6 +169,17 @@ static void enter_config_mode()
 
 extern "C" void app_main(void)
 {
+    // Start the app event lanes first so boot-time events are queued.
+    (void)deferred_log::init();
+    (void)app_events::init();
+    (void)event_metrics::start_periodic_log(app_config::kEventMetricsLogIntervalMs);
+    // Before the DHT task and MQTT start recording samples.
+    (void)state::init_history();
+    if (app_config::kEventTraceBytes > 0)
+    {
+        (void)event_trace::start(app_config::kEventTraceBytes);
+    }
+
     set_app_state(AppState::BootDevices);
     // Initialize devices (display, touch, LVGL) first so we can show splash early
     if (devices_init() != ESP_OK)
@@ -155,48 +214,26 @@ extern "C" void app_main(void)
     // Initialize toggle controller (handles TOGGLE_REQUEST/RESULT)
     (void)toggle_controller::init();
 
-    // Log all events from the default ESP event loop for inspection/debugging
+    // Log all application events for inspection/debugging
     (void)event_logger::init();
 
     // React to REQUEST_CONFIG_MODE by entering config mode via FSM.
-    {
-        esp_event_handler_instance_t inst = nullptr;
-        (void)esp_event_handler_instance_register(
-            APP_EVENTS,
-            app_events::REQUEST_CONFIG_MODE,
-            [](void * /*arg*/, esp_event_base_t base, int32_t id, void * /*event_data*/)
-            {
-                if (base != APP_EVENTS || id != app_events::REQUEST_CONFIG_MODE)
-                {
-                    return;
-                }
-                set_app_state(AppState::ConfigMode);
-                http_manager::cancel_bootstrap();
-            },
-            nullptr,
-            &inst);
-    }
+    (void)app_events::subscribe<app_events::REQUEST_CONFIG_MODE>(
+        [](const app_events::EmptyPayload & /*payload*/)
+        {
+            set_app_state(AppState::ConfigMode);
+            http_manager::cancel_bootstrap();
+        });
 
     // React to REQUEST_WAKE by transitioning back to NormalAwake.
-    {
-        esp_event_handler_instance_t inst = nullptr;
-        (void)esp_event_handler_instance_register(
-            APP_EVENTS,
-            app_events::REQUEST_WAKE,
-            [](void * /*arg*/, esp_event_base_t base, int32_t id, void * /*event_data*/)
+    (void)app_events::subscribe<app_events::REQUEST_WAKE>(
+        [](const app_events::EmptyPayload & /*payload*/)
+        {
+            if (g_app_state == AppState::NormalScreensaver)
             {
-                if (base != APP_EVENTS || id != app_events::REQUEST_WAKE)
-                {
-                    return;
-                }
-                if (g_app_state == AppState::NormalScreensaver)
-                {
-                    set_app_state(AppState::NormalAwake);
-                }
-            },
-            nullptr,
-            &inst);
-    }
+                set_app_state(AppState::NormalAwake);
+            }
+        });
 
     /* Show splash as early as possible so user sees progress during bootstrap */
 
@@ -204,7 +241,21 @@ extern "C" void app_main(void)
 
     ui::splash::update_state(50, "Подключение..."); // WiFi + display/devices ready
 
+    // Rooms from the last good bootstrap, if stored; the live bootstrap
+    // below is reconciled into them (MODEL_UPDATED patches the pages).
+    const bool warm_boot = state_cache::load();
+    if (warm_boot)
+    {
+        ui::screensaver::init_support();
+        ui_app_init();
+        start_warm_fallback_timer();
+    }
+
     bool bootstrap_ok = http_manager::bootstrap_state();
+    if (warm_boot)
+    {
+        stop_warm_fallback_timer();
+    }
 
     if (g_app_state == AppState::ConfigMode)
     {
@@ -223,14 +274,25 @@ extern "C" void app_main(void)
         ui::splash::update_state(100, "Готово");
         wifi_manager_start_auto(-85, 15000); // Keep Wi-Fi connected in background after bootstrap
         (void)router::start();               // Start connectivity via Router (currently MQTT)
+        (void)diag_server::start();          // Read-only metrics and trace on kDiagHttpPort
 
-        // Build screensaver first so ui_app_init can attach input callbacks to it
-        ui::screensaver::init_support();
-        ui_app_init();
+        if (!warm_boot)
+        {
+            // Build screensaver first so ui_app_init can attach input callbacks to it
+            ui::screensaver::init_support();
+            ui_app_init();
+        }
+        else if (s_warm_fallback_shown)
+        {
+            lvgl_port_lock(0);
+            ui::rooms::show_initial_room();
+            lvgl_port_unlock();
+        }
 
         // Application is now in normal awake mode (rooms UI visible, MQTT running)
         set_app_state(AppState::NormalAwake);
         http_manager::start_weather_polling();
+        http_manager::start_state_refresh();
 
         // Start idle controller task to drive screensaver based on LVGL inactivity.
         (void)xTaskCreate(idle_controller_task, "idle_ctrl", 4096, nullptr, 2, nullptr);
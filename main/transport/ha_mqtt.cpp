@@ -1,12 +1,15 @@
-#include <cstring>
+#include <atomic>
 #include <cstdio>
+#include <cstring>
 #include <string>
 
 #include "esp_log.h"
 #include "esp_event.h"
+#include "esp_heap_caps.h"
 #include "mqtt_client.h"
 
 #include "ha_mqtt.hpp"
+#include "app/app_config.hpp"
 #include "config_server/config_store.hpp"
 #include "http_manager.hpp"
 
@@ -19,8 +22,11 @@ namespace ha_mqtt
     static constexpr const char *kMqttClientId = "esp32-kazdev-ui";
     static constexpr const char *kStatusTopic  = "ha/ui/status";
     static constexpr const char *kCmdToggleTopic = "ha/cmd/toggle";
+    static constexpr std::size_t kMaxTopicLength = 128;
     static esp_mqtt_client_handle_t s_client = nullptr;
     static volatile bool s_connected = false;
+    // Set after the first CONNECTED; later ones are reconnects.
+    static bool s_connected_once = false;
     static MessageHandler s_handler = nullptr;
 
     // Runtime MQTT connection parameters (backed by config_store or compile-time defaults)
@@ -31,14 +37,185 @@ namespace ha_mqtt
     static std::string s_host;
     static std::uint16_t s_port = 0;
 
-    // Simple subscription registry (re-subscribed on reconnect)
-    struct sub_item_t
+    // Topic filters set by the owner (router), re-sent in one SUBSCRIBE
+    // on every connect. The array is the caller's; nothing is copied.
+    static const esp_mqtt_topic_t *s_filters = nullptr;
+    static int s_filter_count = 0;
+
+    static void subscribe_filters()
+    {
+        if (!s_client || s_filter_count == 0)
+            return;
+        int mid = esp_mqtt_client_subscribe_multiple(s_client, s_filters, s_filter_count);
+        ESP_LOGI(TAG, "SUB %d filters (first %s) mid=%d", s_filter_count, s_filters[0].filter, mid);
+    }
+
+    // ---- fragment reassembly ----------------------------------------------
+    //
+    // esp-mqtt hands a message larger than its buffer over in several
+    // MQTT_EVENT_DATA events: the first carries the topic, all carry
+    // current_data_offset/total_data_len and the msg_id. Fragments are
+    // collected in a small pool of buffers allocated once; messages that
+    // fit the client buffer skip it and are passed on in place.
+    struct Reassembly
+    {
+        bool used;
+        int msg_id;
+        std::size_t total;
+        std::size_t received;
+        std::size_t topic_len;
+        char topic[kMaxTopicLength];
+        char *data; // app_config::kMqttMaxMessageBytes
+    };
+
+    static Reassembly s_reassembly[app_config::kMqttReassemblySlots] = {};
+
+    // Counted on the MQTT task, read by rx_stats() from any task.
+    struct RxCounters
     {
-        char topic[96];
-        int qos;
+        std::atomic<std::uint32_t> reassembled{0};
+        std::atomic<std::uint32_t> oversize{0};
+        std::atomic<std::uint32_t> topic_too_long{0};
+        std::atomic<std::uint32_t> incomplete{0};
     };
-    static sub_item_t s_subs[8];
-    static int s_subs_count = 0;
+    static RxCounters s_rx_stats;
+
+    static void count(std::atomic<std::uint32_t> &counter)
+    {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool alloc_reassembly_buffers()
+    {
+        for (Reassembly &r : s_reassembly)
+        {
+            if (r.data)
+                continue;
+            void *b = nullptr;
+#if CONFIG_SPIRAM
+            b = heap_caps_malloc(app_config::kMqttMaxMessageBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+            if (!b)
+                b = heap_caps_malloc(app_config::kMqttMaxMessageBytes, MALLOC_CAP_8BIT);
+            if (!b)
+                return false;
+            r.data = static_cast<char *>(b);
+        }
+        return true;
+    }
+
+    static void drop_partial_messages()
+    {
+        for (Reassembly &r : s_reassembly)
+        {
+            if (r.used)
+            {
+                r.used = false;
+                count(s_rx_stats.incomplete);
+            }
+        }
+    }
+
+    static void on_mqtt_data(const esp_mqtt_event_t &event)
+    {
+        if (!s_handler || event.data_len < 0 || event.current_data_offset < 0)
+            return;
+
+        const std::size_t len = static_cast<std::size_t>(event.data_len);
+        const std::size_t offset = static_cast<std::size_t>(event.current_data_offset);
+        const std::size_t total = event.total_data_len > 0 ? static_cast<std::size_t>(event.total_data_len) : len;
+        const std::string_view chunk = (event.data && len > 0) ? std::string_view(event.data, len) : std::string_view();
+
+        if (offset == 0)
+        {
+            if (!event.topic || event.topic_len <= 0)
+                return;
+            const std::string_view topic(event.topic, static_cast<std::size_t>(event.topic_len));
+
+            if (len >= total)
+            {
+                // Whole message in one event: handed over in place;
+                // esp-mqtt keeps the buffer for the duration of the call.
+                s_handler(topic, chunk);
+                return;
+            }
+            // Later fragments of a dropped message find no slot and are
+            // dropped too.
+            if (total > app_config::kMqttMaxMessageBytes)
+            {
+                count(s_rx_stats.oversize);
+                ESP_LOGW(TAG, "dropping %u byte message on %.*s (max %u)",
+                         static_cast<unsigned>(total),
+                         static_cast<int>(topic.size()),
+                         topic.data(),
+                         static_cast<unsigned>(app_config::kMqttMaxMessageBytes));
+                return;
+            }
+            if (topic.size() > kMaxTopicLength)
+            {
+                count(s_rx_stats.topic_too_long);
+                ESP_LOGW(TAG, "dropping fragmented message: %u byte topic (max %u) %.*s",
+                         static_cast<unsigned>(topic.size()),
+                         static_cast<unsigned>(kMaxTopicLength),
+                         static_cast<int>(topic.size()),
+                         topic.data());
+                return;
+            }
+
+            Reassembly *slot = nullptr;
+            for (Reassembly &r : s_reassembly)
+            {
+                if (!r.used && r.data)
+                {
+                    slot = &r;
+                    break;
+                }
+            }
+            if (!slot)
+            {
+                // Every slot holds a message whose rest never came (or the
+                // buffers could not be allocated): slot 0 gives way.
+                count(s_rx_stats.incomplete);
+                slot = &s_reassembly[0];
+                if (!slot->data)
+                    return;
+            }
+
+            slot->used = true;
+            slot->msg_id = event.msg_id;
+            slot->total = total;
+            slot->received = 0;
+            slot->topic_len = topic.size();
+            std::memcpy(slot->topic, topic.data(), topic.size());
+        }
+
+        Reassembly *slot = nullptr;
+        for (Reassembly &r : s_reassembly)
+        {
+            if (r.used && r.msg_id == event.msg_id && r.received == offset)
+            {
+                slot = &r;
+                break;
+            }
+        }
+        if (!slot)
+            return;
+
+        if (offset + chunk.size() > slot->total)
+        {
+            slot->used = false;
+            count(s_rx_stats.incomplete);
+            return;
+        }
+        std::memcpy(slot->data + offset, chunk.data(), chunk.size());
+        slot->received += chunk.size();
+        if (slot->received < slot->total)
+            return;
+
+        slot->used = false;
+        count(s_rx_stats.reassembled);
+        s_handler(std::string_view(slot->topic, slot->topic_len), std::string_view(slot->data, slot->total));
+    }
 
     static void publish_status(const char *status)
     {
@@ -59,14 +236,18 @@ namespace ha_mqtt
             ESP_LOGI(TAG, "Connected to broker");
             publish_status("online");
             // Re-subscribe on reconnect.
-            for (int i = 0; i < s_subs_count; ++i)
-            {
-                int mid = esp_mqtt_client_subscribe(s_client, s_subs[i].topic, s_subs[i].qos);
-                ESP_LOGI(TAG, "SUB %s qos=%d mid=%d", s_subs[i].topic, s_subs[i].qos, mid);
-            }
+            subscribe_filters();
+            // Retained states come back with the subscription, but areas
+            // and entities added or removed in HA meanwhile only with a
+            // re-bootstrap.
+            if (s_connected_once)
+                http_manager::request_state_refresh();
+            s_connected_once = true;
             break;
         case MQTT_EVENT_DISCONNECTED:
             s_connected = false;
+            // The rest of a fragmented message will not come.
+            drop_partial_messages();
             ESP_LOGW(TAG,
                      "Disconnected from broker (uri=%s host=%s port=%u)",
                      s_uri.c_str(),
@@ -81,18 +262,7 @@ namespace ha_mqtt
                      static_cast<unsigned>(s_port));
             break;
         case MQTT_EVENT_DATA:
-            if (s_handler && event->topic && event->topic_len > 0)
-            {
-                // esp-mqtt provides topic with explicit length, not null-terminated.
-                // Our handler contract expects a null-terminated topic string.
-                size_t tlen = static_cast<size_t>(event->topic_len);
-                char topic_buf[192];
-                if (tlen >= sizeof(topic_buf))
-                    tlen = sizeof(topic_buf) - 1;
-                std::memcpy(topic_buf, event->topic, tlen);
-                topic_buf[tlen] = '\0';
-                s_handler(topic_buf, event->data, event->data_len);
-            }
+            on_mqtt_data(*event);
             break;
         default:
             break;
@@ -186,6 +356,9 @@ namespace ha_mqtt
         cfg.buffer.size = 2048;
         cfg.network.reconnect_timeout_ms = 3000;
 
+        if (!alloc_reassembly_buffers())
+            ESP_LOGW(TAG, "no memory for reassembly buffers; messages over %d bytes are dropped", cfg.buffer.size);
+
         s_client = esp_mqtt_client_init(&cfg);
         if (!s_client)
             return ESP_ERR_NO_MEM;
@@ -217,25 +390,30 @@ namespace ha_mqtt
         return ESP_OK;
     }
 
+    RxStats rx_stats()
+    {
+        RxStats out;
+        out.reassembled = s_rx_stats.reassembled.load(std::memory_order_relaxed);
+        out.oversize = s_rx_stats.oversize.load(std::memory_order_relaxed);
+        out.topic_too_long = s_rx_stats.topic_too_long.load(std::memory_order_relaxed);
+        out.incomplete = s_rx_stats.incomplete.load(std::memory_order_relaxed);
+        return out;
+    }
+
     void set_message_handler(MessageHandler handler)
     {
         s_handler = handler;
     }
 
-    esp_err_t subscribe(const char *topic, int qos)
+    esp_err_t set_subscriptions(const esp_mqtt_topic_t *filters, int count)
     {
-        if (!topic || !*topic)
+        if (!filters || count <= 0)
             return ESP_ERR_INVALID_ARG;
-        if (s_subs_count < (int)(sizeof(s_subs) / sizeof(s_subs[0])))
-        {
-            std::strncpy(s_subs[s_subs_count].topic, topic, sizeof(s_subs[s_subs_count].topic) - 1);
-            s_subs[s_subs_count].topic[sizeof(s_subs[s_subs_count].topic) - 1] = '\0';
-            s_subs[s_subs_count].qos = qos;
-            ++s_subs_count;
-        }
+        s_filters = filters;
+        s_filter_count = count;
         if (s_client && s_connected)
         {
-            int mid = esp_mqtt_client_subscribe(s_client, topic, qos);
+            int mid = esp_mqtt_client_subscribe_multiple(s_client, s_filters, s_filter_count);
             return (mid >= 0) ? ESP_OK : ESP_FAIL;
         }
         return ESP_OK;
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <stdbool.h>
+#include <cstdint>
+#include <string_view>
 #include "esp_err.h"
+#include "mqtt_client.h"
 
 namespace ha_mqtt {
 
@@ -14,13 +17,30 @@ bool is_connected();
 // Publish a toggle command with payload = entity_id (plain text).
 esp_err_t publish_toggle(const char* entity_id);
 
-// Message handler type: topic (null-terminated), data pointer and length
-using MessageHandler = void(*)(const char* topic, const char* data, int len);
+// Message handler type: topic and payload, pointing into the MQTT
+// client's receive buffer (not null-terminated, valid during the call).
+using MessageHandler = void(*)(std::string_view topic, std::string_view data);
+
+// Messages larger than the client buffer arrive in fragments and are
+// reassembled (up to app_config::kMqttMaxMessageBytes) before the handler
+// sees them.
+struct RxStats
+{
+    std::uint32_t reassembled = 0;    // delivered from fragments
+    std::uint32_t oversize = 0;       // dropped: over kMqttMaxMessageBytes
+    std::uint32_t topic_too_long = 0; // dropped: fragmented, topic over 128 bytes
+    std::uint32_t incomplete = 0;     // dropped: missing or out-of-order fragment, disconnect, pool full
+};
+
+// Snapshot of the counters; safe to call from any task.
+RxStats rx_stats();
 
 // Set a global message handler invoked for every incoming MQTT message.
 void set_message_handler(MessageHandler handler);
 
-// Subscribe to a topic (single level). Will be re-subscribed after reconnect.
-esp_err_t subscribe(const char* topic, int qos);
+// Set the topic filters (wildcards allowed) to subscribe to, all in one
+// SUBSCRIBE packet, now if connected and again after every reconnect.
+// `filters` must stay valid (static); it replaces any earlier set.
+esp_err_t set_subscriptions(const esp_mqtt_topic_t* filters, int count);
 
 } // namespace ha_mqtt
@@ -9,6 +9,7 @@
 #include "wifi_manager.h"
 #include "http_utils.h"
 #include "state_manager.hpp"
+#include "app/state_cache.hpp"
 #include "config_server/config_store.hpp"
 #include "app/app_config.hpp"
 #include "app/app_state.hpp"
@@ -103,13 +104,14 @@ namespace http_manager
         }
 
         static const char *kBootstrapTemplateBody = R"json(
-{"template": "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE\n{% for area in areas() -%}\n{% for e in area_entities(area) -%}\n{% if e.startswith('light.') or e.startswith('switch.') or e.startswith('input_boolean.') %}\n{{ area }},{{ area_name(area) }},{{ e }},{{ states[e].name }},{{ states[e].state }}\n{% endif %}\n{% endfor %}\n{% endfor %}"})json";
+{"template": "AREA_ID,AREA_NAME,ENTITY_ID,ENTITY_NAME,STATE,ATTRIBUTES\n{% for area in areas() -%}\n{% for e in area_entities(area) -%}\n{% if e.split('.')[0] in ['light','switch','input_boolean','sensor','binary_sensor','cover','climate'] %}\n{{ area }},{{ area_name(area) }},{{ e }},{{ states[e].name }},{{ states[e].state }},{% for k in ['brightness','color_temp','temperature','current_temperature','current_position'] %}{% if states[e].attributes[k] is number %}{{ k }}={{ states[e].attributes[k] }};{% endif %}{% endfor %}\n{% endif %}\n{% endfor %}\n{% endfor %}"})json";
 
         // Weather template (used by screensaver).
         static const char *kWeatherTemplateBody = R"json(
 {"template":"Temperature,Condition,Year,Month,Day,Weekday,Hour,Minute,Second\n{% set w = states['weather.forecast_home_assistant'] %}\n{{ w.attributes.temperature if w else 'N/A' }},{{ w.state if w else 'N/A' }},{{ now().year }},{{ now().month }},{{ now().day }},{{ now().weekday() }},{{ now().strftime('%H') }},{{ now().strftime('%M') }},{{ now().strftime('%S') }}"})json";
 
         static TaskHandle_t s_weather_task = nullptr;
+        static TaskHandle_t s_refresh_task = nullptr;
 
         static bool ensure_wifi_connected()
         {
@@ -133,6 +135,22 @@ namespace http_manager
             return true;
         }
 
+        // http_send_stream() consumer for the bootstrap template response.
+        static esp_err_t on_bootstrap_chunk(const char *data, size_t len, int status_code, void * /*ctx*/)
+        {
+            if (s_cancel_bootstrap)
+            {
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (status_code < 200 || status_code >= 300)
+            {
+                // Error body (HTML/JSON), not CSV: drain without parsing.
+                return ESP_OK;
+            }
+            state::feed_csv(data, len);
+            return ESP_OK;
+        }
+
         static bool perform_bootstrap_request()
         {
             if (s_cancel_bootstrap)
@@ -143,7 +161,6 @@ namespace http_manager
 
             HaHttpConfig cfgs[4];
             const int cfg_count = build_http_configs(cfgs, 4);
-            char buf[2048];
 
             for (int i = 0; i < cfg_count; ++i)
             {
@@ -157,14 +174,17 @@ namespace http_manager
                 const char *token = (!cfgs[i].token.empty() && cfgs[i].token[0]) ? cfgs[i].token.c_str() : nullptr;
                 ESP_LOGI(TAG, "Bootstrap: trying HA server %d/%d at %s", i + 1, cfg_count, cfgs[i].url.c_str());
 
-                esp_err_t err = http_send("POST",
-                                          cfgs[i].url.c_str(),
-                                          kBootstrapTemplateBody,
-                                          "application/json",
-                                          token,
-                                          buf,
-                                          sizeof(buf),
-                                          &status);
+                // Response rows are parsed as they arrive; the body is never
+                // held in memory as a whole, so its size is not limited.
+                state::begin_csv();
+                esp_err_t err = http_send_stream("POST",
+                                                 cfgs[i].url.c_str(),
+                                                 kBootstrapTemplateBody,
+                                                 "application/json",
+                                                 token,
+                                                 &on_bootstrap_chunk,
+                                                 nullptr,
+                                                 &status);
                 if (err != ESP_OK)
                 {
                     ESP_LOGW(TAG, "Bootstrap HTTP error (server %d): %s", i + 1, esp_err_to_name(err));
@@ -175,16 +195,19 @@ namespace http_manager
                     ESP_LOGW(TAG, "Bootstrap HTTP status %d (server %d)", status, i + 1);
                     continue;
                 }
-                if (!state::init_from_csv(buf, std::strlen(buf)))
+                if (!state::end_csv())
                 {
-                    ESP_LOGW(TAG, "Failed to parse bootstrap CSV (server %d); proceeding with empty state", i + 1);
+                    ESP_LOGW(TAG, "Failed to parse bootstrap CSV (server %d); keeping current state", i + 1);
                 }
                 else
                 {
+                    const state::ModelPtr model = state::snapshot();
                     ESP_LOGI(TAG, "State initialized from server %d: %d areas, %d entities",
                              i + 1,
-                             (int)state::areas().size(),
-                             (int)state::entities().size());
+                             (int)model->areas.size(),
+                             (int)model->entities.size());
+                    // Next boot starts from this model (skipped if unchanged).
+                    (void)state_cache::save();
                 }
 
                 // Remember which HTTP endpoint worked last.
@@ -410,6 +433,31 @@ namespace http_manager
             vTaskDelete(nullptr);
         }
 
+        // Re-runs the bootstrap template periodically or when woken by
+        // request_state_refresh(). end_csv() reconciles the result with
+        // the current model and the room pages patch themselves.
+        static void state_refresh_task(void *arg)
+        {
+            (void)arg;
+            const TickType_t kRefreshIntervalTicks = pdMS_TO_TICKS(app_config::kStateRefreshIntervalMs);
+
+            for (;;)
+            {
+                (void)ulTaskNotifyTake(pdTRUE, kRefreshIntervalTicks);
+
+                if (s_cancel_bootstrap || !wifi_manager_is_connected())
+                {
+                    continue;
+                }
+
+                ESP_LOGI(TAG, "State refresh: re-running bootstrap");
+                if (!perform_bootstrap_request())
+                {
+                    ESP_LOGW(TAG, "State refresh failed; keeping current state");
+                }
+            }
+        }
+
     } // namespace
 
     bool bootstrap_state()
@@ -451,6 +499,23 @@ namespace http_manager
         }
     }
 
+    void start_state_refresh()
+    {
+        if (s_refresh_task == nullptr)
+        {
+            // Same HTTP + CSV streaming path as the initial bootstrap.
+            xTaskCreate(state_refresh_task, "state_refresh", 6144, nullptr, 2, &s_refresh_task);
+        }
+    }
+
+    void request_state_refresh()
+    {
+        if (s_refresh_task)
+        {
+            xTaskNotifyGive(s_refresh_task);
+        }
+    }
+
     bool get_last_successful_http_host(std::string &host, std::uint16_t &http_port)
     {
         if (s_last_http_host.empty() || s_last_http_port == 0)
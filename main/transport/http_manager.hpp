@@ -18,6 +18,15 @@ namespace http_manager
     // Updates state_manager::set_weather/set_clock() on successful polls.
     void start_weather_polling();
 
+    // Start background re-bootstrap (every kStateRefreshIntervalMs) so
+    // areas/entities added in HA show up without a reboot. Call after the
+    // initial bootstrap_state() succeeded.
+    void start_state_refresh();
+
+    // Wake the refresh task to re-bootstrap now (ha_mqtt calls it after a
+    // broker reconnect). No-op before start_state_refresh().
+    void request_state_refresh();
+
     // Return the last HA HTTP host/port that successfully responded
     // during bootstrap or weather polling. Returns false if no successful
     // HTTP request has been recorded yet.
@@ -10,9 +10,36 @@
 
 #include "wifi_manager.h"
 #include "http_utils.h"
+#include "deferred_log.hpp"
 
 static const char *TAG_HTTP = "http_utils";
 
+// Chunk size used when streaming the response body to the consumer.
+static const int kHttpReadChunk = 1024;
+
+struct http_buffer_ctx_t
+{
+    char *out;
+    size_t out_len;
+    size_t total;
+    size_t dropped;
+};
+
+// http_send() consumer: copy body into a fixed caller buffer.
+static esp_err_t http_copy_to_buffer(const char *data, size_t len, int /*status_code*/, void *ctx)
+{
+    http_buffer_ctx_t *buf = static_cast<http_buffer_ctx_t *>(ctx);
+    size_t room = (buf->out_len - 1) - buf->total;
+    size_t n = len < room ? len : room;
+    if (n > 0)
+    {
+        std::memcpy(buf->out + buf->total, data, n);
+        buf->total += n;
+    }
+    buf->dropped += len - n;
+    return ESP_OK;
+}
+
 esp_err_t http_send(const char *method,
                     const char *url,
                     const char *body,
@@ -21,6 +48,34 @@ esp_err_t http_send(const char *method,
                     char *out,
                     size_t out_len,
                     int *out_status_code_opt)
+{
+    if (!out || out_len == 0)
+    {
+        return http_send_stream(method, url, body, content_type_opt, auth_bearer_token_opt,
+                                nullptr, nullptr, out_status_code_opt);
+    }
+
+    http_buffer_ctx_t buf = {out, out_len, 0, 0};
+    out[0] = '\0';
+    esp_err_t err = http_send_stream(method, url, body, content_type_opt, auth_bearer_token_opt,
+                                     &http_copy_to_buffer, &buf, out_status_code_opt);
+    out[buf.total] = '\0';
+    if (buf.dropped > 0)
+    {
+        ESP_LOGW(TAG_HTTP, "http_send: response truncated, %d of %d bytes dropped (buffer %d)",
+                 (int)buf.dropped, (int)(buf.total + buf.dropped), (int)out_len);
+    }
+    return err;
+}
+
+esp_err_t http_send_stream(const char *method,
+                           const char *url,
+                           const char *body,
+                           const char *content_type_opt,
+                           const char *auth_bearer_token_opt,
+                           http_body_cb_t on_body,
+                           void *ctx,
+                           int *out_status_code_opt)
 {
     if (!method || !url)
     {
@@ -44,7 +99,8 @@ esp_err_t http_send(const char *method,
     cfg.buffer_size_tx = 1024;
     cfg.keep_alive_enable = true;
 
-    ESP_LOGI(TAG_HTTP, "http_send: preparing HTTP %s %s", method, url);
+    // Per-request traces go through the deferred log; errors stay direct.
+    DLOGI(deferred_log::Module::Http, "http_send: preparing HTTP %s %s", method, url);
 
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
     if (!client)
@@ -82,7 +138,7 @@ esp_err_t http_send(const char *method,
     }
 
     size_t body_len = body ? std::strlen(body) : 0;
-    ESP_LOGI(TAG_HTTP, "http_send: opening connection, body_len=%d", (int)body_len);
+    DLOGI(deferred_log::Module::Http, "http_send: opening connection, body_len=%d", (int)body_len);
 
     esp_err_t err = esp_http_client_open(client, (int)body_len);
     if (err != ESP_OK)
@@ -108,25 +164,38 @@ esp_err_t http_send(const char *method,
     if (out_status_code_opt)
         *out_status_code_opt = status;
 
-    if (out && out_len > 0)
+    esp_err_t result = ESP_OK;
+    if (on_body)
     {
-        int total = 0;
-        while (total < (int)out_len - 1)
+        char chunk[kHttpReadChunk];
+        size_t total = 0;
+        for (;;)
         {
-            int to_read = (int)out_len - 1 - total;
-            if (to_read <= 0)
+            int r = esp_http_client_read(client, chunk, sizeof(chunk));
+            if (r == 0)
                 break;
-            int r = esp_http_client_read(client, out + total, to_read > 1024 ? 1024 : to_read);
-            if (r <= 0)
+            if (r < 0)
+            {
+                ESP_LOGE(TAG_HTTP, "http_send: read failed after %d bytes", (int)total);
+                result = ESP_FAIL;
                 break;
-            total += r;
+            }
+            total += (size_t)r;
+            result = on_body(chunk, (size_t)r, status, ctx);
+            if (result != ESP_OK)
+            {
+                ESP_LOGW(TAG_HTTP, "http_send: consumer aborted after %d bytes: %s", (int)total, esp_err_to_name(result));
+                break;
+            }
         }
-        out[total] = '\0';
+        DLOGI(deferred_log::Module::Http, "HTTP %s %s -> %d (%d bytes)", method, url, status, (int)total);
+    }
+    else
+    {
+        DLOGI(deferred_log::Module::Http, "HTTP %s %s -> %d", method, url, status);
     }
-
-    ESP_LOGI(TAG_HTTP, "HTTP %s %s -> %d", method, url, status);
 
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
-    return ESP_OK;
+    return result;
 }
@@ -13,7 +13,8 @@ extern "C" {
 // - body: optional request body (may be NULL)
 // - content_type_opt: e.g., "application/json"; may be NULL
 // - auth_bearer_token_opt: if non-NULL, sends Authorization: Bearer <token>
-// - out/out_len: optional response buffer (may be NULL)
+// - out/out_len: optional response buffer (may be NULL); a body that does
+//   not fit is truncated and reported with a warning
 // - out_status_code_opt: optional HTTP status
 esp_err_t http_send(const char *method,
                     const char *url,
@@ -24,6 +25,24 @@ esp_err_t http_send(const char *method,
                     size_t out_len,
                     int *out_status_code_opt);
 
+// Receives response body chunks as they arrive. `status_code` is the HTTP
+// status of the response (already known when the first chunk is delivered).
+// Return ESP_OK to keep reading; any other value aborts the transfer and is
+// returned from http_send_stream().
+typedef esp_err_t (*http_body_cb_t)(const char *data, size_t len, int status_code, void *ctx);
+
+// Same as http_send(), but hands the response body to `on_body` chunk by
+// chunk instead of copying it into a fixed buffer, so the response size is
+// not limited by caller memory.
+esp_err_t http_send_stream(const char *method,
+                           const char *url,
+                           const char *body,
+                           const char *content_type_opt,
+                           const char *auth_bearer_token_opt,
+                           http_body_cb_t on_body,
+                           void *ctx,
+                           int *out_status_code_opt);
+
 #ifdef __cplusplus
 }
 #endif
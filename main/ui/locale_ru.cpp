@@ -29,7 +29,7 @@ namespace ui
             "Ноябрь",
             "Декабрь"};
 
-        const char *weather_condition_to_text(const std::string &cond)
+        const char *weather_condition_to_text(std::string_view cond)
         {
             if (cond == "clear")
                 return "Ясно";
@@ -65,7 +65,50 @@ namespace ui
                 return "Ветрено, переменная облачность";
             if (cond == "exceptional")
                 return "Необычная погода";
-            return cond.c_str();
+            return cond.data();
+        }
+
+        const char *entity_state_to_text(const state::EntityState &s)
+        {
+            switch (s.kind)
+            {
+            case state::StateKind::On:
+                return "Вкл";
+            case state::StateKind::Off:
+                return "Выкл";
+            case state::StateKind::Unavailable:
+                return "Недоступно";
+            case state::StateKind::Mode:
+                break;
+            default:
+                return "—";
+            }
+
+            switch (s.mode)
+            {
+            case state::StateMode::Heat:
+                return "Нагрев";
+            case state::StateMode::Cool:
+                return "Охлаждение";
+            case state::StateMode::HeatCool:
+                return "Нагрев/охлаждение";
+            case state::StateMode::Auto:
+                return "Авто";
+            case state::StateMode::Dry:
+                return "Осушение";
+            case state::StateMode::FanOnly:
+                return "Вентиляция";
+            case state::StateMode::Open:
+                return "Открыто";
+            case state::StateMode::Opening:
+                return "Открывается";
+            case state::StateMode::Closed:
+                return "Закрыто";
+            case state::StateMode::Closing:
+                return "Закрывается";
+            default:
+                return "—";
+            }
         }
 
     } // namespace locale_ru
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <string>
+#include "entity_state.hpp"
+
+#include <string_view>
 
 namespace ui
 {
@@ -10,7 +12,11 @@ namespace ui
         extern const char *kWeekdayNames[7];
         extern const char *kMonthNames[13];
 
-        const char *weather_condition_to_text(const std::string &cond);
+        // Unknown conditions are returned as is: `cond` must be NUL-terminated.
+        const char *weather_condition_to_text(std::string_view cond);
+
+        // Text of a non-numeric entity state ("Вкл", "Нагрев", "Закрыто", ...).
+        const char *entity_state_to_text(const state::EntityState &s);
 
     } // namespace locale_ru
 } // namespace ui
@@ -3,16 +3,17 @@
 #include "esp_log.h"
 #include "esp_lvgl_port.h"
 #include "esp_timer.h"
-#include "esp_event.h"
 #include "fonts.h"
 #include "icons.h"
 #include "state_manager.hpp"
 #include "switch.hpp"
 #include "screensaver.hpp"
+#include "app/app_config.hpp"
 #include "app/app_events.hpp"
 #include "app/app_state.hpp"
 #include "app/state_manager.hpp"
 
+#include <cstdint>
 #include <cstdio>
 
 namespace ui
@@ -22,8 +23,126 @@ namespace ui
         static const char *TAG_UI_ROOMS = "UI_ROOMS";
         static bool s_nav_handler_registered = false;
         static bool s_state_handler_registered = false;
-        static bool s_entity_handler_registered = false;
+        static bool s_model_handler_registered = false;
         static lv_timer_t *s_dht_timer = nullptr;
+        static lv_timer_t *s_state_timer = nullptr;
+
+        // Widget location per entity handle, so state updates find their
+        // widget without scanning every room.
+        struct WidgetRef
+        {
+            std::int16_t room = -1;
+            std::int16_t device = -1;
+        };
+        static std::vector<WidgetRef> s_widget_by_entity;
+
+        // Model the room pages were built from; keeps the area/entity
+        // names referenced by the widgets alive.
+        static state::ModelPtr s_model;
+
+        static lv_event_cb_t s_root_input_cb = nullptr;
+
+        static void build_switch(lv_obj_t *parent, const state::Model & /*model*/, const state::Entity &ent, DeviceWidget &w)
+        {
+            ui::controls::ui_add_switch_widget(parent, ent, w.label, w.control, w.ring);
+            if (w.control)
+            {
+                lv_obj_add_event_cb(w.control, ui::toggle::switch_event_cb, LV_EVENT_VALUE_CHANGED, nullptr);
+            }
+        }
+
+        static void update_switch(DeviceWidget &w, const state::Entity & /*ent*/, const state::EntityState &st)
+        {
+            ui::controls::set_switch_state(w.control, w.ring, st.is_active());
+        }
+
+        static void build_readout(lv_obj_t *parent, const state::Model &model, const state::Entity &ent, DeviceWidget &w)
+        {
+            ui::controls::ui_add_readout_widget(parent, model, ent, w.label, w.value, w.ring);
+        }
+
+        static void update_readout(DeviceWidget &w, const state::Entity &ent, const state::EntityState & /*st*/)
+        {
+            if (s_model)
+            {
+                ui::controls::set_readout_value(w.value, *s_model, ent);
+            }
+        }
+
+        // Widget builders and updaters, indexed by DomainWidget.
+        struct WidgetOps
+        {
+            void (*build)(lv_obj_t *parent, const state::Model &model, const state::Entity &ent, DeviceWidget &w);
+            void (*update)(DeviceWidget &w, const state::Entity &ent, const state::EntityState &st);
+        };
+
+        static constexpr WidgetOps kWidgetOps[] = {
+            {&build_switch, &update_switch},   // DomainWidget::Switch
+            {&build_readout, &update_readout}, // DomainWidget::Readout
+        };
+        static_assert(sizeof(kWidgetOps) / sizeof(kWidgetOps[0]) == static_cast<size_t>(state::DomainWidget::Readout) + 1,
+                      "kWidgetOps out of sync with DomainWidget");
+
+        // Caller holds the LVGL lock.
+        static void update_widget_locked(const state::Entity &e)
+        {
+            if (e.handle >= s_widget_by_entity.size())
+            {
+                return;
+            }
+
+            const WidgetRef ref = s_widget_by_entity[e.handle];
+            if (ref.room < 0 || ref.room >= static_cast<int>(s_room_pages.size()))
+            {
+                return;
+            }
+
+            DeviceWidget &w = s_room_pages[ref.room].devices[ref.device];
+            std::uint16_t generation = 0;
+            const state::EntityState st = e.state.load(generation);
+            if (generation != w.shown_generation)
+            {
+                kWidgetOps[static_cast<size_t>(w.kind)].update(w, e, st);
+                w.shown_generation = generation;
+            }
+        }
+
+        // Pulls state changes once per refresh period instead of reacting to
+        // every update event: a burst of MQTT messages costs one pass here,
+        // and the state side never waits for the LVGL lock. Runs in the
+        // LVGL task, so the lock is already held.
+        static void state_timer_cb(lv_timer_t * /*timer*/)
+        {
+            if (!s_model)
+            {
+                return;
+            }
+            state::drain_dirty(*s_model, [](const state::Entity &e)
+                               { update_widget_locked(e); });
+        }
+
+        // Compare every widget with its entity's current generation. Used
+        // after a model swap: changes still marked in the old model's dirty
+        // set are not carried over, and the reconciled model only marks
+        // entities whose state differs from the bootstrap. Caller holds the
+        // LVGL lock.
+        static void refresh_all_widgets_locked()
+        {
+            if (!s_model)
+            {
+                return;
+            }
+            for (const RoomPage &page : s_room_pages)
+            {
+                for (const DeviceWidget &w : page.devices)
+                {
+                    if (const state::Entity *e = s_model->find(w.entity))
+                    {
+                        update_widget_locked(*e);
+                    }
+                }
+            }
+        }
 
         static void dht_timer_cb(lv_timer_t * /*timer*/)
         {
@@ -87,132 +206,306 @@ namespace ui
         int s_current_room_index = 0;
         int s_current_device_index = 0;
 
-        void ui_build_room_pages()
+        // Create the screen for one area with a tile per (live) entity.
+        static RoomPage build_room_page(const state::Model &model, const state::Area &area)
         {
-            s_room_pages.clear();
+            RoomPage page;
+            page.area_id = area.id;
+            page.area_name = area.name;
+
+            page.root = lv_obj_create(NULL);
+            lv_obj_set_size(page.root, LV_HOR_RES, LV_VER_RES);
+            lv_obj_set_style_bg_color(page.root, lv_color_hex(0x000000), 0);
+            lv_obj_set_style_border_width(page.root, 0, 0);
+            lv_obj_remove_flag(page.root, LV_OBJ_FLAG_SCROLLABLE);
+            if (s_root_input_cb)
+            {
+                lv_obj_add_event_cb(page.root, s_root_input_cb, LV_EVENT_GESTURE, nullptr);
+            }
 
-            const auto &areas = state::areas();
-            const auto &entities = state::entities();
+            page.tileview = lv_tileview_create(page.root);
+            lv_obj_add_event_cb(page.tileview, tileview_event_cb, LV_EVENT_VALUE_CHANGED, nullptr);
+            lv_obj_set_size(page.tileview, LV_PCT(100), LV_VER_RES);
+            lv_obj_align(page.tileview, LV_ALIGN_TOP_MID, 0, 0);
+            lv_obj_set_style_bg_opa(page.tileview, LV_OPA_TRANSP, 0);
+            lv_obj_set_style_border_width(page.tileview, 0, 0);
+            lv_obj_set_scrollbar_mode(page.tileview, LV_SCROLLBAR_MODE_OFF);
 
-            if (areas.empty())
+            for (const auto &ent : model.entities)
             {
-                ESP_LOGW(TAG_UI_ROOMS, "ui_build_room_pages: no areas defined");
-                return;
+                if (ent.removed || ent.area_id != area.id)
+                    continue;
+
+                if (!page.tileview)
+                    continue;
+
+                DeviceWidget w;
+                w.entity = ent.handle;
+                w.name = ent.name;
+                w.kind = state::domain_traits(ent.domain).widget;
+                // Read before the widget samples the state, so a change
+                // in between is re-applied by the refresh timer.
+                w.shown_generation = ent.state.generation();
+
+                int row = static_cast<int>(page.devices.size());
+                w.container = lv_tileview_add_tile(
+                    page.tileview,
+                    0,
+                    row,
+                    static_cast<lv_dir_t>(LV_DIR_TOP | LV_DIR_BOTTOM));
+                lv_obj_set_size(w.container, LV_PCT(100), LV_PCT(100));
+                lv_obj_set_style_bg_opa(w.container, LV_OPA_TRANSP, 0);
+                lv_obj_set_style_border_width(w.container, 0, 0);
+                lv_obj_remove_flag(w.container, LV_OBJ_FLAG_SCROLLABLE);
+                lv_obj_set_flex_flow(w.container, LV_FLEX_FLOW_COLUMN);
+                lv_obj_set_style_pad_row(w.container, 30, 0);   // 10 px
+                lv_obj_set_flex_align(
+                    w.container,
+                    LV_FLEX_ALIGN_CENTER,
+                    LV_FLEX_ALIGN_CENTER,
+                    LV_FLEX_ALIGN_CENTER);
+
+                kWidgetOps[static_cast<size_t>(w.kind)].build(w.container, model, ent, w);
+
+                page.devices.push_back(std::move(w));
             }
 
-            s_room_pages.reserve(areas.size());
+            page.title_label = lv_label_create(page.root);
+            lv_label_set_text(page.title_label, page.area_name.data());
+            lv_obj_set_style_text_color(page.title_label, lv_color_hex(0xFFFFFF), 0);
+            lv_obj_set_style_text_font(page.title_label, &Montserrat_50, 0);
+            lv_obj_align(page.title_label, LV_ALIGN_TOP_MID, 0, 30);
 
-            for (const auto &area : areas)
+            page.dht_label = lv_label_create(page.root);
+            lv_label_set_text(page.dht_label, "");
+            lv_obj_set_style_text_color(page.dht_label, lv_color_hex(0xFFFFFF), 0);
+            lv_obj_set_style_text_font(page.dht_label, &Montserrat_40, 0);
+            lv_obj_align(page.dht_label, LV_ALIGN_BOTTOM_MID, 0, -30);
+
+            return page;
+        }
+
+        static void rebuild_widget_index()
+        {
+            s_widget_by_entity.assign(s_model ? s_model->entities.size() : 0, WidgetRef{});
+            for (size_t room = 0; room < s_room_pages.size(); ++room)
             {
-                RoomPage page;
-                page.area_id = area.id;
-                page.area_name = area.name;
-
-                page.root = lv_obj_create(NULL);
-                lv_obj_set_size(page.root, LV_HOR_RES, LV_VER_RES);
-                lv_obj_set_style_bg_color(page.root, lv_color_hex(0x000000), 0);
-                lv_obj_set_style_border_width(page.root, 0, 0);
-                lv_obj_remove_flag(page.root, LV_OBJ_FLAG_SCROLLABLE);
-
-                page.tileview = lv_tileview_create(page.root);
-                lv_obj_add_event_cb(page.tileview, tileview_event_cb, LV_EVENT_VALUE_CHANGED, nullptr);
-                lv_obj_set_size(page.tileview, LV_PCT(100), LV_VER_RES);
-                lv_obj_align(page.tileview, LV_ALIGN_TOP_MID, 0, 0);
-                lv_obj_set_style_bg_opa(page.tileview, LV_OPA_TRANSP, 0);
-                lv_obj_set_style_border_width(page.tileview, 0, 0);
-                lv_obj_set_scrollbar_mode(page.tileview, LV_SCROLLBAR_MODE_OFF);
-
-                for (size_t i = 0; i < entities.size(); ++i)
+                const RoomPage &page = s_room_pages[room];
+                for (size_t dev = 0; dev < page.devices.size(); ++dev)
                 {
-                    const auto &ent = entities[i];
-                    if (ent.area_id != area.id)
-                        continue;
-
-                    if (!page.tileview)
-                        continue;
-
-                    DeviceWidget w;
-                    w.entity_id = ent.id;
-                    w.name = ent.name;
-
-                    int row = static_cast<int>(page.devices.size());
-                    w.container = lv_tileview_add_tile(
-                        page.tileview,
-                        0,
-                        row,
-                        static_cast<lv_dir_t>(LV_DIR_TOP | LV_DIR_BOTTOM));
-                    lv_obj_set_size(w.container, LV_PCT(100), LV_PCT(100));
-                    lv_obj_set_style_bg_opa(w.container, LV_OPA_TRANSP, 0);
-                    lv_obj_set_style_border_width(w.container, 0, 0);
-                    lv_obj_remove_flag(w.container, LV_OBJ_FLAG_SCROLLABLE);
-                    lv_obj_set_flex_flow(w.container, LV_FLEX_FLOW_COLUMN);
-                    lv_obj_set_style_pad_row(w.container, 30, 0);   // 10 px
-                    lv_obj_set_flex_align(
-                        w.container,
-                        LV_FLEX_ALIGN_CENTER,
-                        LV_FLEX_ALIGN_CENTER,
-                        LV_FLEX_ALIGN_CENTER);
-
-                    ui::controls::ui_add_switch_widget(
-                        w.container,
-                        ent,
-                        w.label,
-                        w.control,
-                        w.ring);
-
-                    page.devices.push_back(std::move(w));
+                    const state::EntityHandle h = page.devices[dev].entity;
+                    if (h < s_widget_by_entity.size())
+                    {
+                        s_widget_by_entity[h].room = static_cast<std::int16_t>(room);
+                        s_widget_by_entity[h].device = static_cast<std::int16_t>(dev);
+                    }
                 }
+            }
+        }
 
-                page.title_label = lv_label_create(page.root);
-                lv_label_set_text(page.title_label, page.area_name.c_str());
-                lv_obj_set_style_text_color(page.title_label, lv_color_hex(0xFFFFFF), 0);
-                lv_obj_set_style_text_font(page.title_label, &Montserrat_50, 0);
-                lv_obj_align(page.title_label, LV_ALIGN_TOP_MID, 0, 30);
+        // Move the room pages to the latest model after a re-bootstrap.
+        // Only pages whose entity set changed are rebuilt; renames are
+        // patched in place and untouched pages are kept as they are.
+        // Caller holds the LVGL lock.
+        static void apply_model_update()
+        {
+            const state::ModelPtr next = state::snapshot();
+            if (!s_model || next == s_model)
+            {
+                return;
+            }
 
-                page.dht_label = lv_label_create(page.root);
-                lv_label_set_text(page.dht_label, "");
-                lv_obj_set_style_text_color(page.dht_label, lv_color_hex(0xFFFFFF), 0);
-                lv_obj_set_style_text_font(page.dht_label, &Montserrat_40, 0);
-                lv_obj_align(page.dht_label, LV_ALIGN_BOTTOM_MID, 0, -30);
+            state::ModelDiff diff;
+            state::diff_models(*s_model, *next, diff);
 
-                s_room_pages.push_back(std::move(page));
+            // Areas whose entity list changed. Views point into the old or
+            // the new model; both stay alive until the end of this call.
+            std::vector<std::string_view> affected;
+            auto touch = [&affected](std::string_view area_id)
+            {
+                for (const auto &a : affected)
+                {
+                    if (a == area_id)
+                        return;
+                }
+                affected.push_back(area_id);
+            };
+            for (state::EntityHandle h : diff.entities_added)
+                touch(next->entities[h].area_id);
+            for (state::EntityHandle h : diff.entities_removed)
+                touch(s_model->entities[h].area_id);
+            for (state::EntityHandle h : diff.entities_moved)
+            {
+                touch(s_model->entities[h].area_id);
+                touch(next->entities[h].area_id);
             }
 
-            if (!s_nav_handler_registered)
+            std::string_view current_area;
+            if (s_current_room_index >= 0 && s_current_room_index < static_cast<int>(s_room_pages.size()))
             {
-                esp_event_handler_instance_t inst = nullptr;
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::NAVIGATE_ROOM,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+                current_area = s_room_pages[s_current_room_index].area_id;
+            }
+            lv_obj_t *active = lv_screen_active();
+
+            std::vector<RoomPage> pages;
+            pages.reserve(next->areas.size());
+            int new_current = 0;
+            bool current_rebuilt = false;
+            int kept = 0;
+            int rebuilt = 0;
+
+            for (const auto &area : next->areas)
+            {
+                RoomPage *old = nullptr;
+                for (auto &p : s_room_pages)
+                {
+                    if (p.root && p.area_id == area.id)
                     {
-                        if (base != APP_EVENTS || id != app_events::NAVIGATE_ROOM)
-                        {
-                            return;
-                        }
+                        old = &p;
+                        break;
+                    }
+                }
 
-                        const auto *payload = static_cast<const app_events::NavigateRoomPayload *>(event_data);
-                        if (!payload)
+                bool rebuild = (old == nullptr);
+                for (const auto &a : affected)
+                {
+                    if (a == area.id)
+                        rebuild = true;
+                }
+
+                if (area.id == current_area)
+                {
+                    new_current = static_cast<int>(pages.size());
+                    current_rebuilt = rebuild;
+                }
+
+                if (!rebuild)
+                {
+                    RoomPage page = std::move(*old);
+                    old->root = nullptr; // taken over, do not delete below
+
+                    // Re-point name views at the new model's strings.
+                    if (page.area_name != area.name && page.title_label)
+                    {
+                        lv_label_set_text(page.title_label, area.name.data());
+                    }
+                    page.area_id = area.id;
+                    page.area_name = area.name;
+                    for (auto &w : page.devices)
+                    {
+                        const state::Entity *e = next->find(w.entity);
+                        if (!e)
+                            continue;
+                        if (w.name != e->name && w.label)
                         {
-                            return;
+                            lv_label_set_text(w.label, e->name.data());
                         }
-                        int delta = payload->delta;
+                        w.name = e->name;
+                    }
+                    pages.push_back(std::move(page));
+                    ++kept;
+                }
+                else
+                {
+                    pages.push_back(build_room_page(*next, area));
+                    ++rebuilt;
+                }
+            }
+
+            // Pages left in the old list were replaced or their area is gone.
+            bool active_deleted = false;
+            for (auto &p : s_room_pages)
+            {
+                if (p.root && p.root == active)
+                {
+                    active_deleted = true;
+                }
+            }
+            if (active_deleted && !pages.empty())
+            {
+                lv_disp_load_scr(pages[new_current].root);
+            }
+            int deleted = 0;
+            for (auto &p : s_room_pages)
+            {
+                if (p.root)
+                {
+                    lv_obj_del(p.root);
+                    ++deleted;
+                }
+            }
+
+            s_room_pages = std::move(pages);
+            s_model = next;
+            s_current_room_index = s_room_pages.empty() ? 0 : new_current;
+            if (current_rebuilt || active_deleted)
+            {
+                s_current_device_index = 0;
+            }
+            rebuild_widget_index();
+            refresh_all_widgets_locked();
+
+            ESP_LOGI(TAG_UI_ROOMS, "model v%u: %d pages kept, %d rebuilt, %d deleted (+%d/-%d entities, %d renamed)",
+                     static_cast<unsigned>(next->version),
+                     kept,
+                     rebuilt,
+                     deleted,
+                     static_cast<int>(diff.entities_added.size()),
+                     static_cast<int>(diff.entities_removed.size()),
+                     static_cast<int>(diff.entities_renamed.size()));
+        }
+
+        void set_root_input_cb(lv_event_cb_t cb)
+        {
+            s_root_input_cb = cb;
+        }
+
+        void ui_build_room_pages()
+        {
+            s_room_pages.clear();
+
+            s_model = state::snapshot();
+            const auto &areas = s_model->areas;
+
+            if (areas.empty())
+            {
+                ESP_LOGW(TAG_UI_ROOMS, "ui_build_room_pages: no areas defined");
+                rebuild_widget_index();
+                return;
+            }
+
+            s_room_pages.reserve(areas.size());
+
+            for (const auto &area : areas)
+            {
+                s_room_pages.push_back(build_room_page(*s_model, area));
+            }
+            rebuild_widget_index();
+
+            if (!s_nav_handler_registered)
+            {
+                (void)app_events::subscribe<app_events::NAVIGATE_ROOM>(
+                    [](const app_events::NavigateRoomPayload &payload)
+                    {
+                        int delta = payload.delta;
 
                         lvgl_port_lock(-1);
 
+                        // A fast spin arrives as one event carrying the
+                        // summed delta; move by all of it in one animation.
                         if (delta > 0)
                         {
-                            show_room_relative(+1, LV_SCREEN_LOAD_ANIM_MOVE_LEFT);
+                            show_room_relative(delta, LV_SCREEN_LOAD_ANIM_MOVE_LEFT);
                         }
                         else if (delta < 0)
                         {
-                            show_room_relative(-1, LV_SCREEN_LOAD_ANIM_MOVE_RIGHT);
+                            show_room_relative(delta, LV_SCREEN_LOAD_ANIM_MOVE_RIGHT);
                         }
 
                         if (!s_room_pages.empty())
                         {
                             const RoomPage &page = s_room_pages[s_current_room_index];
-                            const char *room_name = page.area_name.c_str();
+                            const char *room_name = page.area_name.data();
                             ESP_LOGI(TAG_UI_ROOMS, "NAVIGATE_ROOM delta=%d | room=%d/%d %s",
                                      delta,
                                      s_current_room_index,
@@ -221,32 +514,16 @@ namespace ui
                         }
 
                         lvgl_port_unlock();
-                    },
-                    nullptr,
-                    &inst);
+                    });
                 s_nav_handler_registered = true;
             }
 
             if (!s_state_handler_registered)
             {
-                esp_event_handler_instance_t inst = nullptr;
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::APP_STATE_CHANGED,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+                (void)app_events::subscribe<app_events::APP_STATE_CHANGED>(
+                    [](const app_events::AppStateChangedPayload &payload)
                     {
-                        if (base != APP_EVENTS || id != app_events::APP_STATE_CHANGED || !event_data)
-                        {
-                            return;
-                        }
-
-                        const auto *payload = static_cast<const app_events::AppStateChangedPayload *>(event_data);
-                        if (!payload)
-                        {
-                            return;
-                        }
-
-                        AppState new_state = static_cast<AppState>(payload->new_state);
+                        AppState new_state = static_cast<AppState>(payload.new_state);
                         if (new_state != AppState::NormalAwake)
                         {
                             return;
@@ -271,43 +548,25 @@ namespace ui
                         }
 
                         lvgl_port_unlock();
-                    },
-                    nullptr,
-                    &inst);
+                    });
                 s_state_handler_registered = true;
             }
 
-            if (!s_entity_handler_registered)
+            if (!s_model_handler_registered)
             {
-                esp_event_handler_instance_t inst = nullptr;
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::ENTITY_STATE_CHANGED,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+                (void)app_events::subscribe<app_events::MODEL_UPDATED>(
+                    [](const app_events::EmptyPayload & /*payload*/)
                     {
-                        if (base != APP_EVENTS || id != app_events::ENTITY_STATE_CHANGED)
-                        {
-                            return;
-                        }
-
-                        const auto *payload = static_cast<const app_events::EntityStateChangedPayload *>(event_data);
-                        if (!payload)
-                        {
-                            return;
-                        }
-
-                        const state::Entity *ent = state::find_entity(payload->entity_id);
-                        if (!ent)
-                        {
-                            return;
-                        }
+                        lvgl_port_lock(-1);
+                        apply_model_update();
+                        lvgl_port_unlock();
+                    });
+                s_model_handler_registered = true;
+            }
 
-                        // Reuse existing UI update logic
-                        on_entity_state_changed(*ent);
-                    },
-                    nullptr,
-                    &inst);
-                s_entity_handler_registered = true;
+            if (!s_state_timer)
+            {
+                s_state_timer = lv_timer_create(state_timer_cb, app_config::kUiStateRefreshMs, nullptr);
             }
 
             if (!s_dht_timer)
@@ -360,9 +619,9 @@ namespace ui
             lv_scr_load_anim(scr, anim_type, 300, 0, false);
         }
 
-        bool get_current_entity_id(std::string &out_entity_id)
+        bool get_current_entity(state::EntityHandle &out_entity)
         {
-            out_entity_id.clear();
+            out_entity = state::kInvalidEntity;
 
             if (s_room_pages.empty())
             {
@@ -387,13 +646,13 @@ namespace ui
                 return false;
             }
 
-            out_entity_id = page.devices[static_cast<size_t>(s_current_device_index)].entity_id;
-            return !out_entity_id.empty();
+            out_entity = page.devices[static_cast<size_t>(s_current_device_index)].entity;
+            return out_entity != state::kInvalidEntity;
         }
 
-        bool find_entity_for_control(lv_obj_t *control, std::string &out_entity_id)
+        bool find_entity_for_control(lv_obj_t *control, state::EntityHandle &out_entity)
         {
-            out_entity_id.clear();
+            out_entity = state::kInvalidEntity;
 
             if (!control)
             {
@@ -406,8 +665,8 @@ namespace ui
                 {
                     if (w.control == control)
                     {
-                        out_entity_id = w.entity_id;
-                        return !out_entity_id.empty();
+                        out_entity = w.entity;
+                        return out_entity != state::kInvalidEntity;
                     }
                 }
             }
@@ -417,36 +676,8 @@ namespace ui
 
         void on_entity_state_changed(const state::Entity &e)
         {
-            if (s_room_pages.empty())
-            {
-                return;
-            }
-
-            bool updated = false;
             lvgl_port_lock(-1);
-            for (auto &page : s_room_pages)
-            {
-                if (page.area_id != e.area_id)
-                    continue;
-
-                for (auto &w : page.devices)
-                {
-                    if (w.entity_id != e.id)
-                        continue;
-
-                    if (w.control)
-                    {
-                        bool is_on = (e.state == "on" || e.state == "ON" ||
-                                      e.state == "true" || e.state == "TRUE" ||
-                                      e.state == "1");
-                        ui::controls::set_switch_state(w.control, is_on);
-                    }
-                    updated = true;
-                    break;
-                }
-                if (updated)
-                    break;
-            }
+            update_widget_locked(e);
             lvgl_port_unlock();
         }
 
@@ -1,33 +1,33 @@
 #pragma once
 
 #include "lvgl.h"
+#include "state_manager.hpp"
 
-#include <string>
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
-namespace state
-{
-    struct Entity;
-}
-
 namespace ui
 {
     namespace rooms
     {
         struct DeviceWidget
         {
-            std::string entity_id;
-            std::string name;
+            state::EntityHandle entity = state::kInvalidEntity;
+            std::string_view name; // view into state string arena
+            std::uint16_t shown_generation = 0xFFFF; // state generation last applied
             lv_obj_t *container = nullptr;
             lv_obj_t *label = nullptr;
+            state::DomainWidget kind = state::DomainWidget::Switch;
             lv_obj_t *control = nullptr; // e.g. lv_switch
+            lv_obj_t *value = nullptr;   // readout label
             lv_obj_t *ring = nullptr;    // ring arc around screen
         };
 
         struct RoomPage
         {
-            std::string area_id;
-            std::string area_name;
+            std::string_view area_id;
+            std::string_view area_name;
             lv_obj_t *root = nullptr;
             lv_obj_t *title_label = nullptr;
             lv_obj_t *dht_label = nullptr;
@@ -39,6 +39,10 @@ namespace ui
         extern int s_current_room_index;
         extern int s_current_device_index;
 
+        // Gesture handler attached to every room screen, including pages
+        // rebuilt after a model update. Set before ui_build_room_pages().
+        void set_root_input_cb(lv_event_cb_t cb);
+
         void ui_build_room_pages();
 
         // Show initial room screen (index 0) if any rooms exist
@@ -47,11 +51,11 @@ namespace ui
         // Move to room by relative offset (with wrap-around) and load it with animation
         void show_room_relative(int delta, lv_screen_load_anim_t anim_type);
 
-        // Get entity_id of the currently selected device in the current room
-        bool get_current_entity_id(std::string &out_entity_id);
+        // Get entity of the currently selected device in the current room
+        bool get_current_entity(state::EntityHandle &out_entity);
 
-        // Find entity_id for a given LVGL control (switch) on any room page
-        bool find_entity_for_control(lv_obj_t *control, std::string &out_entity_id);
+        // Find entity for a given LVGL control (switch) on any room page
+        bool find_entity_for_control(lv_obj_t *control, state::EntityHandle &out_entity);
 
         // Apply updated entity state to corresponding widgets on room pages
         void on_entity_state_changed(const state::Entity &e);
@@ -33,13 +33,11 @@ namespace ui
         static lv_timer_t *s_clock_timer = nullptr;
         static bool s_active = false;
         static bool s_backlight_off = false;
-        static esp_event_handler_instance_t s_app_state_handler = nullptr;
-        static esp_event_handler_instance_t s_weather_handler = nullptr;
-        static esp_event_handler_instance_t s_clock_handler = nullptr;
+        static bool s_handlers_registered = false;
 
         static void backlight_timer_cb(lv_timer_t *timer);
         static void clock_timer_cb(lv_timer_t *timer);
-        static void on_app_state_changed(const app_events::AppStateChangedPayload *payload);
+        static void on_app_state_changed(const app_events::AppStateChangedPayload &payload);
         static void on_weather_updated();
         static void on_clock_updated();
 
@@ -100,60 +98,24 @@ namespace ui
             ui_build_screensaver();
             ui_update_weather_and_clock();
 
-            if (s_app_state_handler == nullptr)
+            if (!s_handlers_registered)
             {
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::APP_STATE_CHANGED,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+                (void)app_events::subscribe<app_events::APP_STATE_CHANGED>(&on_app_state_changed);
+                (void)app_events::subscribe<app_events::WEATHER_UPDATED>(
+                    [](const app_events::EmptyPayload & /*payload*/)
                     {
-                        if (base != APP_EVENTS || id != app_events::APP_STATE_CHANGED || !event_data)
-                        {
-                            return;
-                        }
-                        const auto *p = static_cast<const app_events::AppStateChangedPayload *>(event_data);
-                        on_app_state_changed(p);
-                    },
-                    nullptr,
-                    &s_app_state_handler);
-            }
-
-            if (s_weather_handler == nullptr)
-            {
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::WEATHER_UPDATED,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void * /*event_data*/)
-                    {
-                        if (base != APP_EVENTS || id != app_events::WEATHER_UPDATED)
-                        {
-                            return;
-                        }
                         lvgl_port_lock(-1);
                         on_weather_updated();
                         lvgl_port_unlock();
-                    },
-                    nullptr,
-                    &s_weather_handler);
-            }
-
-            if (s_clock_handler == nullptr)
-            {
-                (void)esp_event_handler_instance_register(
-                    APP_EVENTS,
-                    app_events::CLOCK_UPDATED,
-                    [](void * /*arg*/, esp_event_base_t base, int32_t id, void * /*event_data*/)
+                    });
+                (void)app_events::subscribe<app_events::CLOCK_UPDATED>(
+                    [](const app_events::EmptyPayload & /*payload*/)
                     {
-                        if (base != APP_EVENTS || id != app_events::CLOCK_UPDATED)
-                        {
-                            return;
-                        }
                         lvgl_port_lock(-1);
                         on_clock_updated();
                         lvgl_port_unlock();
-                    },
-                    nullptr,
-                    &s_clock_handler);
+                    });
+                s_handlers_registered = true;
             }
 
             if (s_clock_timer == nullptr)
@@ -242,7 +204,7 @@ namespace ui
             {
                 std::snprintf(temp_buf, sizeof(temp_buf), "%.1f°C", w.temperature_c);
 
-                const std::string &cond = w.condition;
+                const std::string_view cond = w.condition;
                 cond_text = locale_ru::weather_condition_to_text(cond);
 
                 for (const auto &entry : kWeatherIconMap)
@@ -344,14 +306,9 @@ namespace ui
             lvgl_port_unlock();
         }
 
-        static void on_app_state_changed(const app_events::AppStateChangedPayload *payload)
+        static void on_app_state_changed(const app_events::AppStateChangedPayload &payload)
         {
-            if (!payload)
-            {
-                return;
-            }
-
-            AppState new_state = static_cast<AppState>(payload->new_state);
+            AppState new_state = static_cast<AppState>(payload.new_state);
             switch (new_state)
             {
             case AppState::NormalScreensaver:
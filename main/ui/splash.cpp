@@ -24,7 +24,7 @@ namespace ui
             if (lv_event_get_code(e) == LV_EVENT_CLICKED)
             {
                 std::int64_t now_us = esp_timer_get_time();
-                (void)app_events::post_request_config_mode(now_us, false);
+                (void)app_events::post<app_events::REQUEST_CONFIG_MODE>({now_us});
             }
         }
 
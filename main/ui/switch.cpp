@@ -3,39 +3,19 @@
 #include "esp_log.h"
 #include "esp_lvgl_port.h"
 #include "esp_timer.h"
-#include "esp_event.h"
 #include "app/app_events.hpp"
 #include "rooms.hpp"
+#include "locale_ru.hpp"
 #include "state_manager.hpp"
 #include "fonts.h"
 
-#include <vector>
-#include <utility>
+#include <cstdio>
 
 namespace ui
 {
     namespace controls
     {
-        static std::vector<std::pair<lv_obj_t *, lv_obj_t *>> s_switch_rings;
-        static lv_obj_t *find_ring_for_control(lv_obj_t *control)
-        {
-            if (!control)
-            {
-                return nullptr;
-            }
-
-            for (auto &entry : s_switch_rings)
-            {
-                if (entry.first == control)
-                {
-                    return entry.second;
-                }
-            }
-
-            return nullptr;
-        }
-
-        void set_switch_state(lv_obj_t *control, bool is_on)
+        void set_switch_state(lv_obj_t *control, lv_obj_t *ring, bool is_on)
         {
             if (!control)
             {
@@ -51,7 +31,6 @@ namespace ui
                 lv_obj_clear_state(control, LV_STATE_CHECKED);
             }
 
-            lv_obj_t *ring = find_ring_for_control(control);
             if (ring)
             {
                 lv_color_t color = is_on ? lv_color_hex(0x00FF00) : lv_color_hex(0xFF0000);
@@ -92,9 +71,7 @@ namespace ui
                 return;
             }
 
-            bool is_on = (ent.state == "on" || ent.state == "ON" ||
-                          ent.state == "true" || ent.state == "TRUE" ||
-                          ent.state == "1");
+            bool is_on = ent.state.load().is_active();
 
             // Create ring inside tile (same parent as label/switch)
             lv_obj_t *ring = lv_arc_create(parent);
@@ -117,7 +94,7 @@ namespace ui
 
             // Create label inside tile container so flex layout works
             lv_obj_t *label = lv_label_create(ring);
-            lv_label_set_text(label, ent.name.c_str());
+            lv_label_set_text(label, ent.name.data());
             lv_obj_set_style_text_color(label, lv_color_hex(0xE6E6E6), 0);
             lv_obj_set_style_text_font(label, &Montserrat_40, 0);
             lv_obj_align_to(label, ring, LV_ALIGN_CENTER, 0, -20);
@@ -128,13 +105,92 @@ namespace ui
             lv_obj_set_style_height(control, 70, LV_PART_MAIN);
             lv_obj_align_to(control, label, LV_ALIGN_OUT_BOTTOM_MID, 0, 30);
 
+            set_switch_state(control, ring, is_on);
 
-            s_switch_rings.emplace_back(control, ring);
+            out_label = label;
+            out_control = control;
+            out_ring = ring;
+        }
 
-            set_switch_state(control, is_on);
+        void set_readout_value(lv_obj_t *value, const state::Model &model, const state::Entity &ent)
+        {
+            if (!value)
+            {
+                return;
+            }
+
+            const state::EntityState st = ent.state.load();
+            char buf[48];
+            float current = 0.0f;
+            if (st.kind == state::StateKind::Numeric)
+            {
+                std::snprintf(buf, sizeof(buf), "%.1f", static_cast<double>(st.value));
+            }
+            else if (model.attribute(ent, state::AttrKey::CurrentTemperature, current))
+            {
+                // Climate: mode and room temperature.
+                std::snprintf(buf, sizeof(buf), "%s\n%.1f°C",
+                              ui::locale_ru::entity_state_to_text(st),
+                              static_cast<double>(current));
+            }
+            else
+            {
+                std::snprintf(buf, sizeof(buf), "%s", ui::locale_ru::entity_state_to_text(st));
+            }
+            lv_label_set_text(value, buf);
+        }
+
+        void ui_add_readout_widget(
+            lv_obj_t *parent,
+            const state::Model &model,
+            const state::Entity &ent,
+            lv_obj_t *&out_label,
+            lv_obj_t *&out_value,
+            lv_obj_t *&out_ring)
+        {
+            out_label = nullptr;
+            out_value = nullptr;
+            out_ring = nullptr;
+
+            if (!parent)
+            {
+                return;
+            }
+
+            // Same ring as the switch, in a neutral colour: nothing to toggle.
+            lv_obj_t *ring = lv_arc_create(parent);
+            lv_obj_remove_style_all(ring);
+            lv_obj_set_size(ring, LV_HOR_RES, LV_VER_RES);
+            lv_obj_center(ring);
+            lv_obj_clear_flag(ring, LV_OBJ_FLAG_CLICKABLE);
+            lv_obj_clear_flag(ring, LV_OBJ_FLAG_SCROLLABLE);
+            lv_obj_clear_flag(ring, LV_OBJ_FLAG_GESTURE_BUBBLE);
+
+            lv_arc_set_bg_angles(ring, 0, 360);
+            lv_arc_set_angles(ring, 0, 360);
+
+            lv_obj_set_style_arc_width(ring, 4, LV_PART_MAIN);
+            lv_obj_set_style_arc_opa(ring, LV_OPA_TRANSP, LV_PART_MAIN);
+
+            lv_obj_set_style_arc_width(ring, 4, LV_PART_INDICATOR);
+            lv_obj_set_style_arc_opa(ring, LV_OPA_COVER, LV_PART_INDICATOR);
+            lv_obj_set_style_arc_color(ring, lv_color_hex(0x606060), LV_PART_INDICATOR);
+
+            lv_obj_t *label = lv_label_create(ring);
+            lv_label_set_text(label, ent.name.data());
+            lv_obj_set_style_text_color(label, lv_color_hex(0xE6E6E6), 0);
+            lv_obj_set_style_text_font(label, &Montserrat_40, 0);
+            lv_obj_align_to(label, ring, LV_ALIGN_CENTER, 0, -40);
+
+            lv_obj_t *value = lv_label_create(ring);
+            lv_obj_set_style_text_color(value, lv_color_hex(0xFFFFFF), 0);
+            lv_obj_set_style_text_font(value, &Montserrat_50, 0);
+            lv_obj_set_style_text_align(value, LV_TEXT_ALIGN_CENTER, 0);
+            set_readout_value(value, model, ent);
+            lv_obj_align_to(value, label, LV_ALIGN_OUT_BOTTOM_MID, 0, 30);
 
             out_label = label;
-            out_control = control;
+            out_value = value;
             out_ring = ring;
         }
     } // namespace controls
@@ -144,7 +200,7 @@ namespace ui
         static const char *TAG_UI_TOGGLE = "UI_TOGGLE";
         static int64_t s_last_toggle_us = 0;
         static lv_obj_t *s_spinner = nullptr;
-        static std::string s_pending_toggle_entity;
+        static state::EntityHandle s_pending_toggle_entity = state::kInvalidEntity;
 
         static void ui_show_spinner(void)
         {
@@ -155,6 +211,14 @@ namespace ui
             }
             lv_obj_t *scr = lv_screen_active();
             s_spinner = lv_spinner_create(scr);
+            // The room screen may be rebuilt (model update) while a toggle
+            // is pending; forget the spinner if it goes away with it.
+            lv_obj_add_event_cb(
+                s_spinner,
+                [](lv_event_t * /*e*/)
+                { s_spinner = nullptr; },
+                LV_EVENT_DELETE,
+                nullptr);
             lv_obj_set_size(s_spinner, 50, 50);
             lv_obj_align(s_spinner, LV_ALIGN_BOTTOM_MID, 0, -10);
         }
@@ -181,21 +245,10 @@ namespace ui
             }
         }
 
-        static void on_toggle_result(void * /*arg*/, esp_event_base_t base, int32_t id, void *event_data)
+        static void on_toggle_result(const app_events::ToggleResultPayload &payload)
         {
-            if (base != APP_EVENTS || id != app_events::TOGGLE_RESULT)
-            {
-                return;
-            }
-
-            const auto *payload = static_cast<const app_events::ToggleResultPayload *>(event_data);
-            if (!payload)
-            {
-                return;
-            }
-
             // Only react for current pending entity (if any)
-            if (!s_pending_toggle_entity.empty() && s_pending_toggle_entity != payload->entity_id)
+            if (s_pending_toggle_entity != state::kInvalidEntity && s_pending_toggle_entity != payload.entity)
             {
                 return;
             }
@@ -205,14 +258,14 @@ namespace ui
             ui_hide_spinner();
             lvgl_port_unlock();
 
-            s_pending_toggle_entity.clear();
+            s_pending_toggle_entity = state::kInvalidEntity;
         }
 
-        void trigger_toggle_for_entity(const std::string &entity_id)
+        void trigger_toggle_for_entity(state::EntityHandle entity)
         {
-            if (entity_id.empty())
+            if (entity == state::kInvalidEntity)
             {
-                ESP_LOGW(TAG_UI_TOGGLE, "trigger_toggle_for_entity: empty entity_id");
+                ESP_LOGW(TAG_UI_TOGGLE, "trigger_toggle_for_entity: invalid entity");
                 return;
             }
 
@@ -221,18 +274,18 @@ namespace ui
             {
                 return;
             }
-            if (!s_pending_toggle_entity.empty())
+            if (s_pending_toggle_entity != state::kInvalidEntity)
             {
                 ESP_LOGW(TAG_UI_TOGGLE, "Toggle already in progress");
                 return;
             }
 
-            s_pending_toggle_entity = entity_id;
+            s_pending_toggle_entity = entity;
             ui_set_switches_enabled(false);
             ui_show_spinner();
 
             s_last_toggle_us = now;
-            (void)app_events::post_toggle_request(entity_id.c_str(), now, false);
+            (void)app_events::post<app_events::TOGGLE_REQUEST>({entity, now});
         }
 
         void switch_event_cb(lv_event_t *e)
@@ -249,19 +302,19 @@ namespace ui
                 ESP_LOGI(TAG_UI_TOGGLE, "Toggle ignored, control disabled");
                 return;
             }
-            if (!s_pending_toggle_entity.empty())
+            if (s_pending_toggle_entity != state::kInvalidEntity)
             {
                 ESP_LOGI(TAG_UI_TOGGLE, "Toggle in progress, ignoring switch");
                 return;
             }
-            std::string entity_id;
-            if (!ui::rooms::find_entity_for_control(sw, entity_id))
+            state::EntityHandle entity = state::kInvalidEntity;
+            if (!ui::rooms::find_entity_for_control(sw, entity))
             {
                 ESP_LOGW(TAG_UI_TOGGLE, "switch_event_cb: control without entity");
                 return;
             }
 
-            trigger_toggle_for_entity(entity_id);
+            trigger_toggle_for_entity(entity);
         }
 
         esp_err_t init()
@@ -272,13 +325,7 @@ namespace ui
                 return ESP_OK;
             }
 
-            esp_event_handler_instance_t inst = nullptr;
-            esp_err_t err = esp_event_handler_instance_register(
-                APP_EVENTS,
-                app_events::TOGGLE_RESULT,
-                &on_toggle_result,
-                nullptr,
-                &inst);
+            esp_err_t err = app_events::subscribe<app_events::TOGGLE_RESULT>(&on_toggle_result);
 
             if (err != ESP_OK)
             {
@@ -2,20 +2,15 @@
 
 #include "lvgl.h"
 #include "esp_err.h"
-
-#include <string>
-
-namespace state
-{
-    struct Entity;
-}
+#include "state_manager.hpp"
 
 namespace ui
 {
     namespace controls
     {
-        // Set logical on/off state for a LVGL switch-like control
-        void set_switch_state(lv_obj_t *control, bool is_on);
+        // Set logical on/off state for a LVGL switch-like control and colour
+        // its ring (the widget's own, from ui_add_switch_widget; may be null)
+        void set_switch_state(lv_obj_t *control, lv_obj_t *ring, bool is_on);
 
         // Enable or disable user interaction for a LVGL switch-like control
         void set_switch_enabled(lv_obj_t *control, bool enabled);
@@ -27,6 +22,18 @@ namespace ui
             lv_obj_t *&out_label,
             lv_obj_t *&out_control,
             lv_obj_t *&out_ring);
+
+        // Build a labeled read-only value (sensor, climate) inside parent
+        void ui_add_readout_widget(
+            lv_obj_t *parent,
+            const state::Model &model,
+            const state::Entity &ent,
+            lv_obj_t *&out_label,
+            lv_obj_t *&out_value,
+            lv_obj_t *&out_ring);
+
+        // Show the entity's current state in a readout value label
+        void set_readout_value(lv_obj_t *value, const state::Model &model, const state::Entity &ent);
     } // namespace controls
 
     namespace toggle
@@ -37,7 +44,7 @@ namespace ui
         // Handle LVGL switch event and trigger toggle over HA
         void switch_event_cb(lv_event_t *e);
 
-        // Trigger toggle for specific entity_id (with debouncing and connectivity checks)
-        void trigger_toggle_for_entity(const std::string &entity_id);
+        // Trigger toggle for specific entity (with debouncing and connectivity checks)
+        void trigger_toggle_for_entity(state::EntityHandle entity);
     } // namespace toggle
 } // namespace ui
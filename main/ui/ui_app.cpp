@@ -20,25 +20,11 @@ void ui_app_init(void)
 {
     lvgl_port_lock(0);
 
-    // Build UI room pages
+    // Build UI room pages; gesture and switch callbacks are attached per
+    // page so pages rebuilt after a model update get them too.
+    ui::rooms::set_root_input_cb(root_input_cb);
     ui_build_room_pages();
 
-    // Attach gesture and switch callbacks
-    for (auto &page : s_room_pages)
-    {
-        if (page.root)
-        {
-            lv_obj_add_event_cb(page.root, root_input_cb, LV_EVENT_GESTURE, nullptr);
-        }
-        for (auto &w : page.devices)
-        {
-            if (w.control)
-            {
-                lv_obj_add_event_cb(w.control, ui::toggle::switch_event_cb, LV_EVENT_VALUE_CHANGED, nullptr);
-            }
-        }
-    }
-
     // Initialize toggle handling (event bus subscriptions)
     (void)ui::toggle::init();
 
@@ -50,8 +36,8 @@ void ui_app_init(void)
 
     // Apply current state to widgets (bootstrap after MQTT)
     {
-        const auto &ents = state::entities();
-        for (const auto &e : ents)
+        const state::ModelPtr model = state::snapshot();
+        for (const auto &e : model->entities)
         {
             ui::rooms::on_entity_state_changed(e);
         }
@@ -98,7 +84,7 @@ static void root_input_cb(lv_event_t *e)
 
         if (gesture_code >= 0)
         {
-            (void)app_events::post_gesture(gesture_code, now_us, false);
+            (void)app_events::post<app_events::GESTURE>({gesture_code, now_us});
         }
     }
     else if (code == LV_EVENT_PRESSED)
@@ -106,7 +92,7 @@ static void root_input_cb(lv_event_t *e)
         lv_obj_t *target = static_cast<lv_obj_t *>(lv_event_get_target(e));
         if (target == s_screensaver_root)
         {
-            (void)app_events::post_request_wake(now_us, false);
+            (void)app_events::post<app_events::REQUEST_WAKE>({now_us});
         }
     }
 }